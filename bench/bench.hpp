@@ -0,0 +1,316 @@
+// bench.hpp
+// Micro-benchmark harness, header only. A benchmark times its loop over
+// state; what runs before or after the loop is not timed:
+//
+//   BENCH(GreeterGreet) {
+//       greeter_t *g = greeterCreate("Hello");
+//       for(auto _ : state) { bench::DoNotOptimize(greeterGreet(g, "Tom")); }
+//       greeterDestroy(&g);
+//   }
+//   BENCH_MAIN()
+//
+// Each benchmark is calibrated to the iterations that take --min-time,
+// run once more at that size as warmup, then sampled --samples times;
+// the median and the median absolute deviation (MAD) of the time per
+// iteration are reported. --json writes them with every sample and the
+// build and host they were measured on, for bench_compare.
+#ifndef BENCH_HPP_
+#define BENCH_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// the compiler flags of the benchmark, if the build passes them
+#ifndef BENCH_FLAGS
+#define BENCH_FLAGS ""
+#endif
+
+namespace bench {
+
+class State
+{
+  public:
+    class Iterator
+    {
+      public:
+        Iterator(State *state, uint64_t remaining) : state_(state), remaining_(remaining) {}
+        bool operator!=(const Iterator &) {
+            if(remaining_) { return true; }
+            state_->Stop();
+            return false;
+        }
+        void operator++() { --remaining_; }
+        // of a type marked unused, so that for(auto _ : state) does not warn
+        struct [[maybe_unused]] Value {};
+        Value operator*() const { return Value(); }
+
+      private:
+        State *state_;
+        uint64_t remaining_;
+    };
+
+    explicit State(uint64_t iterations) : iterations_(iterations) {}
+
+    uint64_t iterations() const { return iterations_; }
+    Iterator begin() {
+        started_ = true;
+        start_ = std::chrono::steady_clock::now();
+        return Iterator(this, iterations_);
+    }
+    Iterator end() { return Iterator(this, 0); }
+
+    bool Ran() const { return started_ && stopped_; }
+    double Seconds() const { return std::chrono::duration<double>(stop_ - start_).count(); }
+
+  private:
+    void Stop() {
+        stop_ = std::chrono::steady_clock::now();
+        stopped_ = true;
+    }
+
+    uint64_t iterations_;
+    bool started_ = false, stopped_ = false;
+    std::chrono::steady_clock::time_point start_, stop_;
+};
+
+// keeps the compiler from dropping a computation whose result is unused
+template<typename T>
+inline void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// keeps the compiler from dropping or reordering stores to memory
+inline void ClobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+
+typedef void (*Function)(State &state);
+
+struct Benchmark
+{
+    const char *name;
+    Function function;
+};
+
+inline std::vector<Benchmark> &Registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registrar
+{
+    Registrar(const char *name, Function function) { Registry().push_back({ name, function }); }
+};
+
+struct Options
+{
+    double minTime = 0.01; // s per sample
+    int samples = 15;
+    std::string filter;    // regex of benchmark names to run
+    std::string json;      // file to write the results to
+};
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations = 0;      // per sample
+    std::vector<double> samples;  // ns per iteration
+    double median = 0, mad = 0;   // ns per iteration
+};
+
+inline double Median(std::vector<double> values)
+{
+    if(values.empty()) { return 0; }
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if(values.size() % 2) { return upper; }
+    return (*std::max_element(values.begin(), values.begin() + mid) + upper) / 2;
+}
+
+// runs the benchmark for n iterations; negative if it has no state loop
+inline double RunOnce(const Benchmark &b, uint64_t n)
+{
+    State state(n);
+    b.function(state);
+    return state.Ran() ? state.Seconds() : -1;
+}
+
+inline bool Measure(const Benchmark &b, const Options &opt, Result *result)
+{
+    result->name = b.name;
+    uint64_t n = 1;
+    for(;;) {
+        double t = RunOnce(b, n);
+        if(t < 0) { return false; }
+        if(t >= opt.minTime || n >= 1000000000) { break; }
+        // aim a little past min time, growing at most tenfold per round
+        double grow = t > 0 ? opt.minTime * 1.2 / t : 10;
+        n = std::max(n + 1, static_cast<uint64_t>(n * std::min(grow, 10.0)));
+    }
+    RunOnce(b, n); // warmup at the calibrated size
+    result->iterations = n;
+    result->samples.clear();
+    for(int i = 0; i < opt.samples; ++i) { result->samples.push_back(RunOnce(b, n) * 1e9 / n); }
+    result->median = Median(result->samples);
+    std::vector<double> deviations;
+    for(double s : result->samples) { deviations.push_back(std::fabs(s - result->median)); }
+    result->mad = Median(deviations);
+    return true;
+}
+
+// the first line of path, or "unknown"
+inline std::string ReadLine(const char *path)
+{
+    std::ifstream in(path);
+    std::string line;
+    return std::getline(in, line) && ! line.empty() ? line : "unknown";
+}
+
+inline std::string CpuModel()
+{
+    std::ifstream in("/proc/cpuinfo");
+    for(std::string line; std::getline(in, line); ) {
+        if( ! line.compare(0, 10, "model name")) { return line.substr(line.find(':') + 2); }
+    }
+    return "unknown";
+}
+
+inline std::string JsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for(unsigned char c : s) {
+        if(c == '"' || c == '\\') { out += '\\'; }
+        if(c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        }
+        else { out += c; }
+    }
+    return out + "\"";
+}
+
+// The results with the context that decides whether two runs compare:
+// CPU, frequency governor (performance, or powersave scaling the clock
+// under load), kernel, compiler and flags.
+inline bool WriteJson(const std::string &path, const std::vector<Result> &results)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if( ! f) { return false; }
+    char date[32], host[256] = "unknown";
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    gethostname(host, sizeof(host) - 1);
+    struct utsname uts;
+    std::string kernel = uname(&uts) ? "unknown" : std::string(uts.sysname) + " " + uts.release;
+    fprintf(f, "{\n  \"context\": {\n");
+    fprintf(f, "    \"date\": %s,\n", JsonString(date).c_str());
+    fprintf(f, "    \"host\": %s,\n", JsonString(host).c_str());
+    fprintf(f, "    \"cpu\": %s,\n", JsonString(CpuModel()).c_str());
+    fprintf(f, "    \"cpus\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(f, "    \"governor\": %s,\n",
+            JsonString(ReadLine("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor")).c_str());
+    fprintf(f, "    \"kernel\": %s,\n", JsonString(kernel).c_str());
+    fprintf(f, "    \"compiler\": %s,\n", JsonString(__VERSION__).c_str());
+    fprintf(f, "    \"flags\": %s\n  },\n  \"benchmarks\": [", JsonString(BENCH_FLAGS).c_str());
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        fprintf(f, "%s\n    {\n      \"name\": %s,\n      \"iterations\": %llu,\n"
+                   "      \"median_ns\": %.3f,\n      \"mad_ns\": %.3f,\n      \"samples_ns\": [",
+                i ? "," : "", JsonString(r.name).c_str(), (unsigned long long)r.iterations, r.median, r.mad);
+        for(size_t j = 0; j < r.samples.size(); ++j) { fprintf(f, "%s%.3f", j ? ", " : "", r.samples[j]); }
+        fprintf(f, "]\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return ! fclose(f);
+}
+
+inline void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [--filter=regex] [--min-time=ms] [--samples=n] [--json=file] [--list]\n"
+        "  --filter=regex  run only the benchmarks whose names match\n"
+        "  --min-time=ms   calibrate each sample to at least ms (default: 10)\n"
+        "  --samples=n     timed samples per benchmark (default: 15)\n"
+        "  --json=file     also write the results, samples and context as JSON\n"
+        "  --list          print the benchmark names and exit\n", prog);
+}
+
+inline int Main(int argc, char *argv[])
+{
+    Options opt;
+    bool list = false;
+    for(int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if( ! strncmp(arg, "--filter=", 9)) { opt.filter = arg + 9; }
+        else if( ! strncmp(arg, "--min-time=", 11)) { opt.minTime = atof(arg + 11) / 1e3; }
+        else if( ! strncmp(arg, "--samples=", 10)) { opt.samples = atoi(arg + 10); }
+        else if( ! strncmp(arg, "--json=", 7)) { opt.json = arg + 7; }
+        else if( ! strcmp(arg, "--list")) { list = true; }
+        else {
+            Usage(argv[0]);
+            return strcmp(arg, "--help") ? 2 : 0;
+        }
+    }
+    if(opt.minTime <= 0 || opt.samples < 1) {
+        Usage(argv[0]);
+        return 2;
+    }
+    std::regex filter(opt.filter);
+    std::vector<Result> results;
+    int rc = 0;
+    if( ! list) {
+        printf("%-32s %12s %14s %12s %8s\n", "benchmark", "iterations", "median ns/op", "MAD ns/op", "MAD %");
+    }
+    for(const Benchmark &b : Registry()) {
+        if( ! std::regex_search(b.name, filter)) { continue; }
+        if(list) {
+            printf("%s\n", b.name);
+            continue;
+        }
+        Result r;
+        if( ! Measure(b, opt, &r)) {
+            fprintf(stderr, "%s: no timed loop over state\n", b.name);
+            rc = 1;
+            continue;
+        }
+        printf("%-32s %12llu %14.2f %12.2f %7.1f%%\n", r.name.c_str(), (unsigned long long)r.iterations,
+               r.median, r.mad, r.median > 0 ? r.mad * 100 / r.median : 0.0);
+        fflush(stdout);
+        results.push_back(r);
+    }
+    if( ! list && ! opt.json.empty() && ! WriteJson(opt.json, results)) {
+        perror(opt.json.c_str());
+        rc = 1;
+    }
+    return rc;
+}
+
+} // namespace bench
+
+#define BENCH(name) \
+    static void Bench_##name(bench::State &state); \
+    static bench::Registrar benchRegistrar_##name(#name, Bench_##name); \
+    static void Bench_##name(bench::State &state)
+
+#define BENCH_MAIN() \
+    int main(int argc, char *argv[]) { return bench::Main(argc, argv); }
+
+#endif // BENCH_HPP_
@@ -0,0 +1,82 @@
+// bench_compare.cpp
+// Compares two result files of greeter_bench --json, benchmark by
+// benchmark: a change is reported only if the Mann-Whitney U test finds
+// it significant at --alpha and the medians differ by more than
+// --threshold percent; a significant but smaller shift is not worth
+// acting on, and a large one that is not significant is noise.
+// Exits 1 if any benchmark regressed, for CI.
+#include "bench.hpp"
+#include "bench_compare.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char *kContext[] = { "cpu", "cpus", "governor", "kernel", "compiler", "flags" };
+
+void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [--alpha=p] [--threshold=percent] baseline.json contender.json\n"
+        "  --alpha=p            significance level (default: 0.01)\n"
+        "  --threshold=percent  smallest change of the median to report (default: 2)\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double alpha = 0.01, threshold = 2;
+    std::vector<const char *> files;
+    for(int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if( ! strncmp(arg, "--alpha=", 8)) { alpha = atof(arg + 8); }
+        else if( ! strncmp(arg, "--threshold=", 12)) { threshold = atof(arg + 12); }
+        else if(arg[0] == '-') {
+            Usage(argv[0]);
+            return strcmp(arg, "--help") ? 2 : 0;
+        }
+        else { files.push_back(arg); }
+    }
+    if(files.size() != 2 || alpha <= 0 || alpha >= 1 || threshold < 0) {
+        Usage(argv[0]);
+        return 2;
+    }
+    bench::ResultFile base, cont;
+    std::string error;
+    if( ! bench::LoadResults(files[0], &base, &error) || ! bench::LoadResults(files[1], &cont, &error)) {
+        fprintf(stderr, "bench_compare: %s\n", error.c_str());
+        return 2;
+    }
+    // timings from different machines or builds differ for reasons of their own
+    for(const char *key : kContext) {
+        if(base.context[key] != cont.context[key]) {
+            fprintf(stderr, "bench_compare: warning: %s differs: \"%s\" vs \"%s\"\n", key,
+                    base.context[key].c_str(), cont.context[key].c_str());
+        }
+    }
+
+    int regressions = 0;
+    printf("%-32s %14s %14s %9s %10s  %s\n", "benchmark", "base ns/op", "new ns/op", "change", "p", "verdict");
+    for(const std::string &name : base.names) {
+        auto it = cont.samples.find(name);
+        if(it == cont.samples.end()) {
+            printf("%-32s only in %s\n", name.c_str(), files[0]);
+            continue;
+        }
+        const std::vector<double> &a = base.samples[name], &b = it->second;
+        double before = bench::Median(a), after = bench::Median(b);
+        double change = before > 0 ? (after - before) * 100 / before : 0;
+        bench::MannWhitney test = bench::MannWhitneyU(b, a);
+        const char *verdict = "same";
+        if(test.p < alpha && std::fabs(change) > threshold) {
+            verdict = change > 0 ? "REGRESSION" : "improvement";
+            regressions += change > 0;
+        }
+        printf("%-32s %14.2f %14.2f %+8.1f%% %10.2g  %s\n", name.c_str(), before, after, change, test.p, verdict);
+    }
+    for(const std::string &name : cont.names) {
+        if( ! base.samples.count(name)) { printf("%-32s only in %s\n", name.c_str(), files[1]); }
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+// bench_compare.hpp
+// What bench_compare needs, header only so that tests can use it: a reader
+// of the JSON that bench.hpp writes, and the Mann-Whitney U test, which
+// asks whether the samples of one run tend to be larger than those of the
+// other without assuming they are normal: timings are not, with their
+// long tail of preempted samples.
+#ifndef BENCH_COMPARE_HPP_
+#define BENCH_COMPARE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// A JSON value; enough of JSON for bench results.
+struct Json
+{
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    double number = 0;
+    std::string string;
+    std::vector<Json> items;
+    std::map<std::string, Json> members;
+
+    const Json &operator[](const std::string &key) const {
+        static const Json none;
+        auto it = members.find(key);
+        return it == members.end() ? none : it->second;
+    }
+};
+
+class JsonParser
+{
+  public:
+    explicit JsonParser(const std::string &text) : s_(text) {}
+
+    // false on malformed JSON or trailing garbage
+    bool Parse(Json *value) {
+        return Value(value) && (Space(), pos_ == s_.size());
+    }
+
+  private:
+    void Space() {
+        while(pos_ < s_.size() && strchr(" \t\r\n", s_[pos_])) { ++pos_; }
+    }
+    bool Literal(const char *word) {
+        size_t len = strlen(word);
+        if(s_.compare(pos_, len, word)) { return false; }
+        pos_ += len;
+        return true;
+    }
+    bool Text(std::string *out) {
+        if(s_[pos_++] != '"') { return false; }
+        while(pos_ < s_.size() && s_[pos_] != '"') {
+            char c = s_[pos_++];
+            if(c != '\\') {
+                *out += c;
+                continue;
+            }
+            if(pos_ >= s_.size()) { return false; }
+            c = s_[pos_++];
+            switch(c) {
+                case 'n': *out += '\n'; break;
+                case 't': *out += '\t'; break;
+                case 'r': *out += '\r'; break;
+                case 'b': *out += '\b'; break;
+                case 'f': *out += '\f'; break;
+                case 'u': {
+                    // only the ASCII escapes that JsonString writes
+                    if(pos_ + 4 > s_.size()) { return false; }
+                    *out += static_cast<char>(strtol(s_.substr(pos_, 4).c_str(), nullptr, 16));
+                    pos_ += 4;
+                    break;
+                }
+                default: *out += c;
+            }
+        }
+        return pos_++ < s_.size();
+    }
+    bool Value(Json *v) {
+        Space();
+        if(pos_ >= s_.size()) { return false; }
+        char c = s_[pos_];
+        if(c == '{') {
+            v->type = Json::Object;
+            ++pos_;
+            Space();
+            if(pos_ < s_.size() && s_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            for(;;) {
+                std::string key;
+                Space();
+                if(pos_ >= s_.size() || ! Text(&key)) { return false; }
+                Space();
+                if(pos_ >= s_.size() || s_[pos_++] != ':' || ! Value(&v->members[key])) { return false; }
+                Space();
+                if(pos_ >= s_.size()) { return false; }
+                c = s_[pos_++];
+                if(c == '}') { return true; }
+                if(c != ',') { return false; }
+            }
+        }
+        if(c == '[') {
+            v->type = Json::Array;
+            ++pos_;
+            Space();
+            if(pos_ < s_.size() && s_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            for(;;) {
+                v->items.emplace_back();
+                if( ! Value(&v->items.back())) { return false; }
+                Space();
+                if(pos_ >= s_.size()) { return false; }
+                c = s_[pos_++];
+                if(c == ']') { return true; }
+                if(c != ',') { return false; }
+            }
+        }
+        if(c == '"') {
+            v->type = Json::String;
+            return Text(&v->string);
+        }
+        if(Literal("true") || Literal("false")) {
+            v->type = Json::Bool;
+            v->number = s_[pos_ - 2] == 'u';
+            return true;
+        }
+        if(Literal("null")) { return true; }
+        const char *start = s_.c_str() + pos_;
+        char *end;
+        v->type = Json::Number;
+        v->number = strtod(start, &end);
+        pos_ += end - start;
+        return end != start;
+    }
+
+    const std::string &s_;
+    size_t pos_ = 0;
+};
+
+// A result file of bench.hpp: its context, and the samples by benchmark.
+struct ResultFile
+{
+    std::map<std::string, std::string> context;
+    std::vector<std::string> names; // in the order they ran
+    std::map<std::string, std::vector<double>> samples;
+};
+
+inline bool LoadResults(const std::string &path, ResultFile *out, std::string *error)
+{
+    std::ifstream in(path);
+    if( ! in) {
+        *error = path + ": cannot open";
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string s = text.str();
+    Json root;
+    if( ! JsonParser(s).Parse(&root) || root.type != Json::Object) {
+        *error = path + ": not JSON";
+        return false;
+    }
+    for(const auto &m : root["context"].members) {
+        out->context[m.first] = m.second.type == Json::String ? m.second.string : std::to_string(int(m.second.number));
+    }
+    const Json &benchmarks = root["benchmarks"];
+    if(benchmarks.type != Json::Array) {
+        *error = path + ": no benchmarks";
+        return false;
+    }
+    for(const Json &b : benchmarks.items) {
+        const Json &name = b["name"], &samples = b["samples_ns"];
+        if(name.type != Json::String || samples.type != Json::Array) {
+            *error = path + ": benchmark without name or samples_ns";
+            return false;
+        }
+        out->names.push_back(name.string);
+        std::vector<double> &values = out->samples[name.string];
+        for(const Json &v : samples.items) { values.push_back(v.number); }
+    }
+    return true;
+}
+
+struct MannWhitney
+{
+    double u = 0; // of the first sample: how many pairs it wins
+    double z = 0; // positive when the first sample tends to be larger
+    double p = 1; // two-sided
+};
+
+// The normal approximation with tie and continuity correction, close to the
+// exact test from about 8 samples a side; bench takes 15 by default.
+inline MannWhitney MannWhitneyU(const std::vector<double> &a, const std::vector<double> &b)
+{
+    MannWhitney r;
+    double n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if( ! n1 || ! n2) { return r; }
+    std::vector<std::pair<double, int>> all;
+    for(double v : a) { all.push_back({ v, 0 }); }
+    for(double v : b) { all.push_back({ v, 1 }); }
+    std::sort(all.begin(), all.end());
+    // rank from 1, ties sharing the mean of their ranks
+    double rankSumA = 0, ties = 0;
+    for(size_t i = 0; i < all.size(); ) {
+        size_t j = i;
+        while(j < all.size() && all[j].first == all[i].first) { ++j; }
+        double rank = (i + 1 + j) / 2.0, t = j - i;
+        for(size_t k = i; k < j; ++k) { rankSumA += all[k].second ? 0 : rank; }
+        ties += t * t * t - t;
+        i = j;
+    }
+    r.u = rankSumA - n1 * (n1 + 1) / 2;
+    double mean = n1 * n2 / 2;
+    double sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+    if(sigma == 0) { return r; } // all equal
+    double d = r.u - mean;
+    r.z = (d - std::copysign(std::min(0.5, std::fabs(d)), d)) / sigma;
+    r.p = std::erfc(std::fabs(r.z) / std::sqrt(2.0));
+    return r;
+}
+
+} // namespace bench
+
+#endif // BENCH_COMPARE_HPP_
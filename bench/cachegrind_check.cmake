@@ -0,0 +1,109 @@
+# cachegrind_check.cmake
+#
+# cmake -DVALGRIND=<valgrind> -DDRIVER=<greeter_scenarios> -DSCENARIO=<name>
+#       -DBASELINE=<file> -DOUT_DIR=<dir> [-DTOLERANCE=<percent>] [-DUPDATE=ON]
+#       -P cachegrind_check.cmake
+#
+# Runs a scenario of the driver under Callgrind with cache simulation,
+# collecting only inside its scenario* functions, and compares the event
+# totals with the "<scenario> <event> <count>" lines of the baseline: an
+# event above count by more than TOLERANCE percent (default 2), plus a
+# slack of MISS_SLACK for the small cache-miss counts, is a regression and
+# fails. A scenario without baseline lines is not checked, and says so
+# with "cachegrind_check: no baseline", which CTest reports as skipped
+# rather than passed: record it on the build host with the
+# cachegrind_baseline target.
+# UPDATE=ON replaces the lines of the scenario with what was measured.
+# Unlike time, these counts do not depend on the load of the host; they
+# do on the compiler and C library, so the baseline is per build host.
+
+foreach(var VALGRIND DRIVER SCENARIO BASELINE OUT_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "cachegrind_check: ${var} is not set")
+    endif()
+endforeach()
+if(NOT DEFINED TOLERANCE)
+    set(TOLERANCE 2)
+endif()
+set(MISS_SLACK 16)
+set(EVENTS Ir I1mr D1mr D1mw ILmr DLmr DLmw) # compared; Dr and Dw follow Ir
+
+set(out ${OUT_DIR}/callgrind.${SCENARIO}.out)
+execute_process(
+    COMMAND ${VALGRIND} --tool=callgrind --cache-sim=yes --collect-atstart=no
+            --toggle-collect=scenario* --callgrind-out-file=${out}
+            ${DRIVER} ${SCENARIO}
+    RESULT_VARIABLE rc
+    ERROR_VARIABLE log
+)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "cachegrind_check: ${SCENARIO} failed (${rc}):\n${log}")
+endif()
+
+# "events: Ir Dr ..." names the columns of "totals: 123 45 ..."
+file(STRINGS ${out} lines REGEX "^(events|totals|summary):")
+foreach(line ${lines})
+    string(REGEX REPLACE "^[a-z]+: *" "" fields "${line}")
+    separate_arguments(fields)
+    if(line MATCHES "^events:")
+        set(names ${fields})
+    elseif(line MATCHES "^totals:" OR NOT values)
+        set(values ${fields})
+    endif()
+endforeach()
+if(NOT names OR NOT values)
+    message(FATAL_ERROR "cachegrind_check: no totals in ${out}")
+endif()
+
+set(measured "")
+foreach(event ${EVENTS})
+    list(FIND names ${event} i)
+    if(i GREATER_EQUAL 0)
+        list(GET values ${i} count)
+        set(measured_${event} ${count})
+        string(APPEND measured "${SCENARIO} ${event} ${count}\n")
+    endif()
+endforeach()
+message(STATUS "${SCENARIO}:\n${measured}")
+
+set(baseline "")
+if(EXISTS ${BASELINE})
+    file(STRINGS ${BASELINE} baseline)
+endif()
+
+if(UPDATE)
+    set(kept "")
+    foreach(line ${baseline})
+        if(NOT line MATCHES "^${SCENARIO} ")
+            string(APPEND kept "${line}\n")
+        endif()
+    endforeach()
+    file(WRITE ${BASELINE} "${kept}${measured}")
+    return()
+endif()
+
+set(failed "")
+set(found FALSE)
+foreach(line ${baseline})
+    if(line MATCHES "^${SCENARIO} ([A-Za-z0-9]+) ([0-9]+)$")
+        set(found TRUE)
+        set(event ${CMAKE_MATCH_1})
+        set(expected ${CMAKE_MATCH_2})
+        if(NOT DEFINED measured_${event})
+            continue()
+        endif()
+        math(EXPR allowed "${expected} + ${expected} * ${TOLERANCE} / 100")
+        if(NOT event STREQUAL "Ir")
+            math(EXPR allowed "${allowed} + ${MISS_SLACK}")
+        endif()
+        if(measured_${event} GREATER allowed)
+            string(APPEND failed "  ${event}: ${measured_${event}}, baseline ${expected}, allowed ${allowed}\n")
+        endif()
+    endif()
+endforeach()
+if(NOT found)
+    message(FATAL_ERROR "cachegrind_check: no baseline for ${SCENARIO} in ${BASELINE}; "
+                        "record one with the cachegrind_baseline target")
+elseif(failed)
+    message(FATAL_ERROR "cachegrind_check: ${SCENARIO} regressed:\n${failed}")
+endif()
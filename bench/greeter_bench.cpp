@@ -0,0 +1,102 @@
+// greeter_bench.cpp
+#include "bench.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+extern "C" {
+#include "greeter.h"
+#include "greeter_capture.h"
+#include "hash.h"
+#include "logger.h"
+}
+
+// Sends the [LOG] lines of the real logger to /dev/null while in scope, so
+// that what is timed is the logger, not the terminal.
+class QuietStderr
+{
+  public:
+    QuietStderr() {
+        fflush(stderr);
+        saved_ = dup(STDERR_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDERR_FILENO);
+        close(null);
+    }
+    ~QuietStderr() {
+        fflush(stderr);
+        dup2(saved_, STDERR_FILENO);
+        close(saved_);
+    }
+
+  private:
+    int saved_;
+};
+
+BENCH(GreeterCreate)
+{
+    std::vector<greeter_t *> greeters(state.iterations());
+    size_t i = 0;
+    for(auto _ : state) { greeters[i++] = greeterCreate("Hello"); }
+    for(greeter_t *g : greeters) { greeterDestroy(&g); }
+}
+
+BENCH(GreeterDestroy)
+{
+    std::vector<greeter_t *> greeters(state.iterations());
+    for(greeter_t *&g : greeters) { g = greeterCreate("Hello"); }
+    size_t i = 0;
+    for(auto _ : state) { greeterDestroy(&greeters[i++]); }
+}
+
+BENCH(GreeterGreet)
+{
+    QuietStderr quiet;
+    greeter_t *g = greeterCreate("Hello");
+    for(auto _ : state) { bench::DoNotOptimize(greeterGreet(g, "Tom")); }
+    greeterDestroy(&g);
+}
+
+BENCH(GreeterGreetCaptured)
+{
+    QuietStderr quiet;
+    greeter_t *g = greeterCreate("Hello");
+    greeterCaptureStart("/dev/null");
+    for(auto _ : state) { bench::DoNotOptimize(greeterGreet(g, "Tom")); }
+    greeterCaptureStop();
+    greeterDestroy(&g);
+}
+
+BENCH(GreeterGreetLongName)
+{
+    QuietStderr quiet;
+    greeter_t *g = greeterCreate("Hello");
+    for(auto _ : state) { bench::DoNotOptimize(greeterGreet(g, "Hubert Blaine Wolfeschlegelsteinhausenbergerdorff")); }
+    greeterDestroy(&g);
+}
+
+BENCH(LoggerWriteLog)
+{
+    QuietStderr quiet;
+    for(auto _ : state) { bench::DoNotOptimize(loggerWriteLog("Hello, Tom!")); }
+}
+
+// What keyed hashing costs over the fastest unkeyed hash (std::hash, as
+// hash_string() uses), per key size: the choice per table.
+template<hash_algo_t algo, size_t len>
+static void HashBytes(bench::State &state)
+{
+    std::string key(len, 'x');
+    size_t i = 0;
+    for(auto _ : state) {
+        key[0] = (char)i++;
+        bench::DoNotOptimize(hash_bytes(algo, key.data(), len));
+    }
+}
+
+BENCH(HashStd8) { HashBytes<HASH_STD, 8>(state); }
+BENCH(HashKeyed8) { HashBytes<HASH_KEYED, 8>(state); }
+BENCH(HashStd64) { HashBytes<HASH_STD, 64>(state); }
+BENCH(HashKeyed64) { HashBytes<HASH_KEYED, 64>(state); }
+BENCH(HashStd1024) { HashBytes<HASH_STD, 1024>(state); }
+BENCH(HashKeyed1024) { HashBytes<HASH_KEYED, 1024>(state); }
+
+BENCH_MAIN()
@@ -0,0 +1,67 @@
+// greeter_scenarios.c
+// Fixed greeter and logger workloads for instruction counting under
+// Callgrind; see cachegrind_check.cmake. Only the scenario* functions are
+// counted, so process startup and argument parsing are not.
+#include "greeter.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ROUNDS 1000
+
+__attribute__((noinline)) static void scenarioCreateDestroy(void)
+{
+    for(int i = 0; i < ROUNDS; ++i) {
+        greeter_t *g = greeterCreate("Hello");
+        greeterDestroy(&g);
+    }
+}
+
+__attribute__((noinline)) static void scenarioGreet(greeter_t *g)
+{
+    for(int i = 0; i < ROUNDS; ++i) { greeterGreet(g, "Tom"); }
+}
+
+__attribute__((noinline)) static void scenarioGreetLong(greeter_t *g)
+{
+    for(int i = 0; i < ROUNDS; ++i) { greeterGreet(g, "Hubert Blaine Wolfeschlegelsteinhausenbergerdorff"); }
+}
+
+__attribute__((noinline)) static void scenarioFormat(greeter_t *g)
+{
+    char out[64];
+    for(int i = 0; i < ROUNDS; ++i) {
+        greeterFormat(g, "Tom", 3, out, sizeof(out));
+        __asm__ volatile("" : : "r"(out) : "memory");
+    }
+}
+
+__attribute__((noinline)) static void scenarioLogger(void)
+{
+    for(int i = 0; i < ROUNDS; ++i) { loggerWriteLog("Hello, Tom!"); }
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc != 2) {
+        fprintf(stderr, "usage: %s create_destroy | greet | greet_long | format | logger\n", argv[0]);
+        return 2;
+    }
+    // the logger writes to stderr: count the writes, not the terminal
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+
+    greeter_t *g = greeterCreate("Hello");
+    int rc = 0;
+    if( ! strcmp(argv[1], "create_destroy")) { scenarioCreateDestroy(); }
+    else if( ! strcmp(argv[1], "greet")) { scenarioGreet(g); }
+    else if( ! strcmp(argv[1], "greet_long")) { scenarioGreetLong(g); }
+    else if( ! strcmp(argv[1], "format")) { scenarioFormat(g); }
+    else if( ! strcmp(argv[1], "logger")) { scenarioLogger(); }
+    else { rc = 2; }
+    greeterDestroy(&g);
+    return rc;
+}
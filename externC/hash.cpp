@@ -1,7 +1,105 @@
 // hash.cpp
-extern "C" {
-#include "hash.h"
-}
+#include "hash.hpp"
 #include <string>
+#include <string_view>
+#include <random>
+#include <cmath>
+#include <sys/random.h>
 
 size_t hash_string(const char *str) { return std::hash<std::string>{}(str); }
+
+uint64_t hash_bytes64(const void *data, size_t len)
+{
+    return hash::hash64({static_cast<const char *>(data), len});
+}
+
+uint64_t hash_string64(const char *str) { return hash::hash64(str); }
+
+static uint64_t keyWord(const uint8_t *key)
+{
+    uint64_t w = 0;
+    for(int i = 0; i < 8; ++i) { w |= (uint64_t)key[i] << (8 * i); }
+    return w;
+}
+
+uint64_t hash_siphash13(const void *data, size_t len, const uint8_t key[16])
+{
+    return hash::siphash<1, 3>(data, len, keyWord(key), keyWord(key + 8));
+}
+
+namespace {
+
+struct ProcessKey
+{
+    uint64_t k0, k1;
+
+    ProcessKey() {
+        uint8_t key[16];
+        if(getrandom(key, sizeof(key), 0) != (ssize_t)sizeof(key)) {
+            std::random_device rd; // no getrandom(): fall back to the C++ runtime
+            for(auto &b : key) { b = (uint8_t)rd(); }
+        }
+        k0 = keyWord(key);
+        k1 = keyWord(key + 8);
+    }
+};
+
+} // namespace
+
+uint64_t hash_keyed64(const void *data, size_t len)
+{
+    static const ProcessKey key; // drawn on first use, thread-safe
+    return hash::siphash<1, 3>(data, len, key.k0, key.k1);
+}
+
+uint64_t hash_bytes(hash_algo_t algo, const void *data, size_t len)
+{
+    switch(algo) {
+        case HASH_STD:
+            return std::hash<std::string_view>{}({static_cast<const char *>(data), len});
+        case HASH_STABLE: return hash_bytes64(data, len);
+        case HASH_KEYED:  return hash_keyed64(data, len);
+    }
+    return 0;
+}
+
+int32_t jump_consistent_hash(uint64_t key, int32_t num_buckets)
+{
+    int64_t b = -1, j = 0;
+    while(j < num_buckets) {
+        b = j;
+        key = key * 2862933555777941757ULL + 1;
+        j = (int64_t)((b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+    }
+    return (int32_t)b;
+}
+
+int32_t jump_consistent_hash_string(const char *str, int32_t num_buckets)
+{
+    return jump_consistent_hash(hash_string64(str), num_buckets);
+}
+
+int32_t rendezvous_hash(uint64_t key, const uint64_t *shard_ids,
+                        const double *weights, int32_t num_shards)
+{
+    int32_t best = -1;
+    double bestScore = 0;
+    for(int32_t i = 0; i < num_shards; ++i) {
+        double w = weights ? weights[i] : 1.0;
+        if(w <= 0) { continue; }
+        uint64_t h = hash::fmix64(key ^ hash::fmix64(shard_ids[i] + 0x9e3779b97f4a7c15ULL));
+        double u = ((h >> 11) + 0.5) * (1.0 / 9007199254740992.0); // uniform in (0, 1)
+        double score = -w / std::log(u);
+        if(best < 0 || score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+int32_t rendezvous_hash_string(const char *str, const uint64_t *shard_ids,
+                               const double *weights, int32_t num_shards)
+{
+    return rendezvous_hash(hash_string64(str), shard_ids, weights, num_shards);
+}
@@ -3,7 +3,51 @@
 #define HASH_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 size_t hash_string(const char *str);
 
+// Stable 64-bit hash: FNV-1a finalized with MurmurHash3's fmix64.
+// Unlike hash_string() (std::hash, implementation defined) its value is
+// the same everywhere, so it can be precomputed at compile time: see
+// hash64() in hash.hpp for C++ and hash_literals.cmake for C.
+uint64_t hash_bytes64(const void *data, size_t len);
+uint64_t hash_string64(const char *str);
+
+// SipHash-1-3 of the bytes under a 128-bit key. hash_keyed64() uses a
+// random key drawn once per process, so colliding names cannot be crafted
+// in advance: use it for tables keyed by untrusted input.
+uint64_t hash_siphash13(const void *data, size_t len, const uint8_t key[16]);
+uint64_t hash_keyed64(const void *data, size_t len);
+
+typedef enum hash_algo_t
+{
+    HASH_STD,    // std::hash, as hash_string(): fastest, implementation defined
+    HASH_STABLE, // hash_bytes64(): same value everywhere and at compile time
+    HASH_KEYED,  // hash_keyed64(): DoS resistant, differs between processes
+
+} hash_algo_t;
+
+uint64_t hash_bytes(hash_algo_t algo, const void *data, size_t len);
+
+// Jump consistent hash (Lamping, Veach): shard of key in [0, num_buckets),
+// or -1 if there are none. Growing num_buckets by one moves only about
+// 1/num_buckets of the keys, all of them into the new bucket. The string
+// wrapper shards on hash_string64(), so placement agrees between processes.
+int32_t jump_consistent_hash(uint64_t key, int32_t num_buckets);
+int32_t jump_consistent_hash_string(const char *str, int32_t num_buckets);
+
+// Weighted rendezvous (highest random weight) hash: index of the shard that
+// wins key, or -1 if there are none. Shards are named by stable ids, so any
+// of them can be removed and only its own keys move. Shard i receives
+// weights[i] / sum(weights) of the keys; weights may be NULL for equal.
+int32_t rendezvous_hash(uint64_t key, const uint64_t *shard_ids,
+                        const double *weights, int32_t num_shards);
+int32_t rendezvous_hash_string(const char *str, const uint64_t *shard_ids,
+                               const double *weights, int32_t num_shards);
+
+// Precomputed hash_string64() of a key listed for hashgen, e.g.
+// HASH_LIT(Hello) for "Hello" (non-alphanumerics map to '_').
+#define HASH_LIT(ident) HASH_LIT_##ident
+
 #endif // HASH_H_
@@ -0,0 +1,82 @@
+// hash.hpp
+#ifndef HASH_HPP_
+#define HASH_HPP_
+
+extern "C" {
+#include "hash.h"
+}
+#include <string_view>
+
+namespace hash {
+
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME  = 0x00000100000001b3ULL;
+
+constexpr uint64_t fnv1a64(std::string_view s, uint64_t h = FNV_OFFSET)
+{
+    for(char c : s) {
+        h = (h ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+    return h;
+}
+
+constexpr uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+// constexpr twin of hash_string64() / hash_bytes64()
+constexpr uint64_t hash64(std::string_view s) { return fmix64(fnv1a64(s)); }
+
+constexpr uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+// SipHash-C-D by Aumasson and Bernstein; hash_siphash13() is siphash<1, 3>
+template<int C, int D>
+uint64_t siphash(const void *data, size_t len, uint64_t k0, uint64_t k1)
+{
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    auto round = [&]() {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    };
+    auto p = static_cast<const unsigned char *>(data);
+    auto word = [](const unsigned char *b, size_t n) {
+        uint64_t m = 0;
+        for(size_t i = 0; i < n; ++i) { m |= (uint64_t)b[i] << (8 * i); }
+        return m;
+    };
+    size_t tail = len & 7;
+    for(const unsigned char *end = p + len - tail; p != end; p += 8) {
+        uint64_t m = word(p, 8);
+        v3 ^= m;
+        for(int i = 0; i < C; ++i) { round(); }
+        v0 ^= m;
+    }
+    uint64_t m = word(p, tail) | ((uint64_t)len << 56);
+    v3 ^= m;
+    for(int i = 0; i < C; ++i) { round(); }
+    v0 ^= m;
+    v2 ^= 0xff;
+    for(int i = 0; i < D; ++i) { round(); }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+namespace literals {
+
+// switch(hash_string64(key)) { case "Hello"_h64: ... }
+constexpr uint64_t operator""_h64(const char *s, size_t n) { return hash64({s, n}); }
+
+} // namespace literals
+} // namespace hash
+
+#endif // HASH_HPP_
@@ -0,0 +1,22 @@
+# hash_literals.cmake
+#
+# hash_literals(<out header> <keys file>)
+#   Generates a header with HASH_LIT_<key> constants (see hash.h) for every
+#   line of <keys file>. Add the header to a target's sources to build it.
+
+if(NOT TARGET hashgen)
+    add_executable( hashgen
+        ${CMAKE_CURRENT_LIST_DIR}/hashgen.c
+        ${CMAKE_CURRENT_LIST_DIR}/hash.cpp
+    )
+    target_include_directories( hashgen PRIVATE ${CMAKE_CURRENT_LIST_DIR} )
+endif()
+
+function(hash_literals HEADER KEYS)
+    add_custom_command(
+        OUTPUT ${HEADER}
+        COMMAND hashgen ${KEYS} ${HEADER}
+        DEPENDS hashgen ${KEYS}
+        COMMENT "Generating hash literals ${HEADER}"
+    )
+endfunction()
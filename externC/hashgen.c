@@ -0,0 +1,53 @@
+// hashgen.c
+// Build-time tool: reads a key list (one key per line) and writes a C
+// header defining HASH_LIT_<ident> as hash_string64(key) for every key,
+// so C code can compare against hashes of known literals for free.
+#include "hash.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+static void guardName(const char *path, char *out, size_t cap)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t i = 0;
+    for(; base[i] && i + 2 < cap; ++i) {
+        out[i] = isalnum((unsigned char)base[i]) ? toupper((unsigned char)base[i]) : '_';
+    }
+    out[i++] = '_';
+    out[i] = '\0';
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc != 3) {
+        fprintf(stderr, "usage: %s <keys.txt> <out.h>\n", argv[0]);
+        return 2;
+    }
+    FILE *in = fopen(argv[1], "r");
+    if( ! in) { perror(argv[1]); return 1; }
+    FILE *out = fopen(argv[2], "w");
+    if( ! out) { perror(argv[2]); fclose(in); return 1; }
+
+    char guard[256];
+    guardName(argv[2], guard, sizeof(guard));
+    fprintf(out, "// generated by hashgen from %s, do not edit\n", argv[1]);
+    fprintf(out, "#ifndef %s\n#define %s\n\n#include <stdint.h>\n\n", guard, guard);
+
+    char key[1024];
+    while(fgets(key, sizeof(key), in)) {
+        key[strcspn(key, "\r\n")] = '\0';
+        if( ! key[0] || key[0] == '#') { continue; }
+        fprintf(out, "#define HASH_LIT_");
+        for(const char *c = key; *c; ++c) {
+            fputc(isalnum((unsigned char)*c) ? *c : '_', out);
+        }
+        fprintf(out, " UINT64_C(0x%016" PRIx64 ") // \"%s\"\n", hash_string64(key), key);
+    }
+    fprintf(out, "\n#endif // %s\n", guard);
+
+    fclose(in);
+    return fclose(out) ? 1 : 0;
+}
@@ -1,12 +1,25 @@
 // main.c
 #include "hash.h"
+#include "keys_hash.h"
 #include <stdio.h>
 #include <stdint.h>
 
+static const char *language(const char *greeting)
+{
+    switch(hash_string64(greeting)) { // known keys are not hashed at runtime
+        case HASH_LIT(Hello):   return "English";
+        case HASH_LIT(Hola):    return "Spanish";
+        case HASH_LIT(Bonjour): return "French";
+        case HASH_LIT(Ciao):    return "Italian";
+        default:                return "unknown";
+    }
+}
+
 int main(void)
 {
     const char *s = "Hello, C plus C++!";
     size_t h = hash_string(s);
     printf("Hash of '%s' is %zu\n", s, h);
+    printf("'Bonjour' is %s\n", language("Bonjour"));
     return 0;
 }
@@ -0,0 +1,24 @@
+# mph.cmake
+#
+# mph_generate(<prefix> <words file> <out dir>)
+#   Generates <out dir>/<prefix>_mph.c and <prefix>_mph.h holding a minimal
+#   perfect hash over the keys of <words file> (see mphgen.c). Sets
+#   <prefix>_MPH_SOURCES in the caller's scope to add to a target.
+
+if(NOT TARGET mphgen)
+    add_executable( mphgen
+        ${CMAKE_CURRENT_LIST_DIR}/mphgen.c
+    )
+endif()
+
+function(mph_generate PREFIX WORDS OUTDIR)
+    set(SRC ${OUTDIR}/${PREFIX}_mph.c)
+    set(HDR ${OUTDIR}/${PREFIX}_mph.h)
+    add_custom_command(
+        OUTPUT ${SRC} ${HDR}
+        COMMAND mphgen ${WORDS} ${PREFIX} ${SRC} ${HDR}
+        DEPENDS mphgen ${WORDS}
+        COMMENT "Generating perfect hash ${PREFIX}_mph.c"
+    )
+    set(${PREFIX}_MPH_SOURCES ${SRC} ${HDR} PARENT_SCOPE)
+endfunction()
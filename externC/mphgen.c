@@ -0,0 +1,219 @@
+// mphgen.c
+// Build-time tool: reads a word list and emits a C source and header with
+// a minimal perfect hash over its keys (hash and displace). A lookup costs
+// one string hash, one table read and one key compare.
+//
+// Input: one entry per line, "key" or "key<TAB>value"; '#' starts a comment.
+// Output: <prefix>Index(key, len) returning the slot of key or -1, plus
+//         <prefix>Keys[] and <prefix>Values[] indexed by slot.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#define MAX_KEYS 65536
+#define MAX_TRIES (1u << 20)
+
+typedef struct
+{
+    char *key;
+    char *value;
+    size_t len;
+    uint64_t hash;
+
+} entry_t;
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t size;
+    uint32_t *members;
+
+} bucket_t;
+
+// emitted verbatim into the generated source as well
+static uint64_t mphHash(const char *key, size_t len, uint64_t seed)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for(size_t i = 0; i < len; ++i) {
+        h = (h ^ (unsigned char)key[i]) * 0x00000100000001b3ULL;
+    }
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint32_t mphSlot(uint64_t h, uint32_t disp, uint32_t n)
+{
+    return (uint32_t)(((h ^ disp) * 0x9e3779b97f4a7c15ULL) >> 32) % n;
+}
+
+static int bySizeDesc(const void *a, const void *b)
+{
+    const bucket_t *x = a, *y = b;
+    return (x->size < y->size) - (x->size > y->size);
+}
+
+// tries to place every bucket; returns 0 on success
+static int build(entry_t *e, uint32_t n, uint32_t nb, uint64_t seed,
+                 uint32_t *disp, int32_t *slots)
+{
+    bucket_t *buckets = calloc(nb, sizeof(bucket_t));
+    uint32_t *members = malloc(n * sizeof(uint32_t));
+    uint32_t *fill = calloc(nb, sizeof(uint32_t));
+    uint32_t *tmp = malloc(n * sizeof(uint32_t));
+    int rc = 0;
+
+    for(uint32_t i = 0; i < n; ++i) {
+        e[i].hash = mphHash(e[i].key, e[i].len, seed);
+        buckets[(e[i].hash >> 32) % nb].size++;
+    }
+    for(uint32_t b = 0, off = 0; b < nb; off += buckets[b++].size) {
+        buckets[b].id = b;
+        buckets[b].members = members + off;
+    }
+    for(uint32_t i = 0; i < n; ++i) {
+        uint32_t b = (e[i].hash >> 32) % nb;
+        buckets[b].members[fill[b]++] = i;
+    }
+    qsort(buckets, nb, sizeof(bucket_t), bySizeDesc);
+
+    for(uint32_t i = 0; i < n; ++i) { slots[i] = -1; }
+    for(uint32_t b = 0; b < nb && buckets[b].size; ++b) {
+        bucket_t *bk = &buckets[b];
+        uint32_t d = 0;
+        for(; d < MAX_TRIES; ++d) {
+            uint32_t k = 0;
+            for(; k < bk->size; ++k) {
+                tmp[k] = mphSlot(e[bk->members[k]].hash, d, n);
+                if(slots[tmp[k]] >= 0) { break; }
+                uint32_t j = 0;
+                while(j < k && tmp[j] != tmp[k]) { ++j; }
+                if(j < k) { break; }
+            }
+            if(k == bk->size) { break; }
+        }
+        if(d == MAX_TRIES) { rc = -1; break; }
+        disp[bk->id] = d;
+        for(uint32_t k = 0; k < bk->size; ++k) {
+            slots[tmp[k]] = (int32_t)bk->members[k];
+        }
+    }
+
+    free(tmp);
+    free(fill);
+    free(members);
+    free(buckets);
+    return rc;
+}
+
+static void emitString(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for(; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if(c == '"' || c == '\\') { fprintf(out, "\\%c", c); }
+        else if(c < 0x20 || c >= 0x7f) { fprintf(out, "\\%03o", c); }
+        else { fputc(c, out); }
+    }
+    fputc('"', out);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc != 5) {
+        fprintf(stderr, "usage: %s <words.txt> <prefix> <out.c> <out.h>\n", argv[0]);
+        return 2;
+    }
+    const char *prefix = argv[2];
+    FILE *in = fopen(argv[1], "r");
+    if( ! in) { perror(argv[1]); return 1; }
+
+    static entry_t e[MAX_KEYS];
+    uint32_t n = 0;
+    char line[1024];
+    while(fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if( ! line[0] || line[0] == '#') { continue; }
+        if(n == MAX_KEYS) { fprintf(stderr, "%s: too many keys\n", argv[1]); return 1; }
+        char *tab = strchr(line, '\t');
+        if(tab) { *tab = '\0'; }
+        e[n].key = strdup(line);
+        e[n].value = tab ? strdup(tab + 1) : NULL;
+        e[n].len = strlen(line);
+        for(uint32_t i = 0; i < n; ++i) {
+            if(e[i].len == e[n].len && ! memcmp(e[i].key, e[n].key, e[n].len)) {
+                fprintf(stderr, "%s: duplicate key '%s'\n", argv[1], e[n].key);
+                return 1;
+            }
+        }
+        ++n;
+    }
+    fclose(in);
+    if( ! n) { fprintf(stderr, "%s: no keys\n", argv[1]); return 1; }
+
+    uint32_t nb = n / 4 + 1;
+    uint32_t *disp = calloc(nb, sizeof(uint32_t));
+    int32_t *slots = malloc(n * sizeof(int32_t));
+    uint64_t seed = 0;
+    while(build(e, n, nb, seed, disp, slots)) {
+        if(++seed == 1000) { fprintf(stderr, "%s: no perfect hash found\n", argv[1]); return 1; }
+    }
+
+    FILE *out = fopen(argv[4], "w");
+    if( ! out) { perror(argv[4]); return 1; }
+    fprintf(out, "// generated by mphgen from %s, do not edit\n", argv[1]);
+    fprintf(out, "#ifndef %s_MPH_H_\n#define %s_MPH_H_\n\n", prefix, prefix);
+    fprintf(out, "#include <stddef.h>\n\n");
+    fprintf(out, "enum { %sCount = %" PRIu32 " };\n\n", prefix, n);
+    fprintf(out, "extern const char *const %sKeys[%sCount];\n", prefix, prefix);
+    fprintf(out, "extern const char *const %sValues[%sCount];\n\n", prefix, prefix);
+    fprintf(out, "// slot of key in %sKeys/%sValues, or -1 if it is not in the list\n", prefix, prefix);
+    fprintf(out, "int %sIndex(const char *key, size_t len);\n\n", prefix);
+    fprintf(out, "#endif // %s_MPH_H_\n", prefix);
+    if(fclose(out)) { perror(argv[4]); return 1; }
+
+    out = fopen(argv[3], "w");
+    if( ! out) { perror(argv[3]); return 1; }
+    const char *hdr = strrchr(argv[4], '/');
+    fprintf(out, "// generated by mphgen from %s, do not edit\n", argv[1]);
+    fprintf(out, "#include \"%s\"\n#include <stdint.h>\n#include <string.h>\n\n", hdr ? hdr + 1 : argv[4]);
+    fprintf(out, "const char *const %sKeys[%sCount] = {\n", prefix, prefix);
+    for(uint32_t i = 0; i < n; ++i) {
+        fprintf(out, "    "); emitString(out, e[slots[i]].key); fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\nconst char *const %sValues[%sCount] = {\n", prefix, prefix);
+    for(uint32_t i = 0; i < n; ++i) {
+        fprintf(out, "    ");
+        if(e[slots[i]].value) { emitString(out, e[slots[i]].value); } else { fprintf(out, "NULL"); }
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\nstatic const uint16_t keyLen[%sCount] = {", prefix);
+    for(uint32_t i = 0; i < n; ++i) {
+        fprintf(out, "%s%zu", i ? ", " : " ", e[slots[i]].len);
+    }
+    fprintf(out, " };\n\nstatic const uint32_t disp[%" PRIu32 "] = {", nb);
+    for(uint32_t b = 0; b < nb; ++b) {
+        fprintf(out, "%s%" PRIu32, b ? ", " : " ", disp[b]);
+    }
+    fprintf(out, " };\n\n");
+    fprintf(out,
+        "int %sIndex(const char *key, size_t len)\n"
+        "{\n"
+        "    uint64_t h = UINT64_C(0x%016" PRIx64 ");\n"
+        "    for(size_t i = 0; i < len; ++i) {\n"
+        "        h = (h ^ (unsigned char)key[i]) * UINT64_C(0x00000100000001b3);\n"
+        "    }\n"
+        "    h ^= h >> 33; h *= UINT64_C(0xff51afd7ed558ccd);\n"
+        "    h ^= h >> 33; h *= UINT64_C(0xc4ceb9fe1a85ec53);\n"
+        "    h ^= h >> 33;\n"
+        "    uint32_t d = disp[(h >> 32) %% %" PRIu32 "];\n"
+        "    uint32_t slot = (uint32_t)(((h ^ d) * UINT64_C(0x9e3779b97f4a7c15)) >> 32) %% %sCount;\n"
+        "    if(len != keyLen[slot] || memcmp(key, %sKeys[slot], len)) { return -1; }\n"
+        "    return (int)slot;\n"
+        "}\n",
+        prefix, (uint64_t)(0xcbf29ce484222325ULL ^ seed), nb, prefix, prefix);
+    return fclose(out) ? 1 : 0;
+}
@@ -1,8 +1,62 @@
 // logger.c
 #include "logger.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define PREFIX "[LOG] "
+#define PREFIX_LEN (sizeof(PREFIX) - 1)
+
+typedef struct
+{
+    char *buf;
+    size_t len, cap;
+
+} buffer_t;
+
+static __thread buffer_t buffer;
 
 int loggerWriteLog(const char *message)
 {
-    return fprintf(stderr, "[LOG] %s\n", message);
+    size_t len = strlen(message), line = PREFIX_LEN + len + 1;
+    if( ! buffer.buf) { return fprintf(stderr, PREFIX "%s\n", message); }
+    if(buffer.len + line > buffer.cap) { loggerFlush(); }
+    if(line > buffer.cap) { return fprintf(stderr, PREFIX "%s\n", message); }
+    char *p = buffer.buf + buffer.len;
+    memcpy(p, PREFIX, PREFIX_LEN);
+    memcpy(p + PREFIX_LEN, message, len);
+    p[line - 1] = '\n';
+    buffer.len += line;
+    return (int)line;
+}
+
+int loggerBufferStart(size_t cap)
+{
+    loggerBufferStop();
+    if( ! (buffer.buf = malloc(cap))) { return -1; }
+    buffer.cap = cap;
+    return 0;
+}
+
+int loggerFlush(void)
+{
+    size_t off = 0;
+    while(off < buffer.len) {
+        ssize_t n = write(STDERR_FILENO, buffer.buf + off, buffer.len - off);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n <= 0) { break; } // as lossy as fprintf() to stderr
+        off += n;
+    }
+    int rc = off < buffer.len ? -1 : 0;
+    buffer.len = 0;
+    return rc;
+}
+
+void loggerBufferStop(void)
+{
+    loggerFlush();
+    free(buffer.buf);
+    buffer = (buffer_t){ 0 };
 }
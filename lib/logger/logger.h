@@ -2,6 +2,19 @@
 #ifndef LOGGER_H_
 #define LOGGER_H_
 
+#include <stddef.h>
+
 int loggerWriteLog(const char *message);
 
+// Buffers the lines the calling thread logs, up to cap bytes, until
+// loggerFlush() writes them out at once: a thread logging many lines per
+// pass of its event loop makes one write(2) instead of one per line. A
+// line that does not fit flushes the buffer first. 0, or -1 if out of
+// memory, in which case lines go out one by one as before.
+int loggerBufferStart(size_t cap);
+// Writes out the lines the calling thread buffered; 0, or -1 on error.
+int loggerFlush(void);
+// Flushes, then logs the calling thread's lines one by one again.
+void loggerBufferStop(void);
+
 #endif // LOGGER_H_
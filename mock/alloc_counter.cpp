@@ -0,0 +1,74 @@
+// alloc_counter.cpp
+#include "alloc_counter.hpp"
+#include <cstring>
+
+// glibc's allocator, under the names it exports for interposers
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+// zero-initialized, so taking it never allocates
+static thread_local AllocCounts counts;
+
+AllocCounts AllocCountsOfThread()
+{
+    return counts;
+}
+
+static void Count(size_t size)
+{
+    ++counts.allocs;
+    counts.bytes += size;
+}
+
+extern "C" {
+
+void *malloc(size_t size) noexcept
+{
+    Count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) noexcept
+{
+    Count(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    Count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) noexcept
+{
+    if(ptr) { ++counts.frees; }
+    __libc_free(ptr);
+}
+
+char *strdup(const char *s) noexcept
+{
+    size_t size = strlen(s) + 1;
+    char *copy = static_cast<char *>(__libc_malloc(size));
+    if(copy) { memcpy(copy, s, size); }
+    Count(size);
+    return copy;
+}
+
+char *strndup(const char *s, size_t n) noexcept
+{
+    size_t len = strnlen(s, n);
+    char *copy = static_cast<char *>(__libc_malloc(len + 1));
+    if(copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    Count(len + 1);
+    return copy;
+}
+
+} // extern "C"
@@ -0,0 +1,61 @@
+// alloc_counter.hpp
+#ifndef ALLOC_COUNTER_HPP_
+#define ALLOC_COUNTER_HPP_
+
+#include <gtest/gtest.h>
+#include <cstdint>
+
+// Linking alloc_counter.cpp into a test executable interposes malloc,
+// calloc, realloc, free, strdup and strndup for the whole process, and
+// counts the calls and bytes of each thread; operator new counts too, as
+// it allocates with malloc.
+struct AllocCounts
+{
+    uint64_t allocs; // malloc, calloc, realloc, strdup and strndup calls
+    uint64_t bytes;  // requested by them
+    uint64_t frees;
+};
+
+// the counts of the calling thread so far
+AllocCounts AllocCountsOfThread();
+
+// the counts of the calling thread since construction
+class AllocScope
+{
+  public:
+    AllocScope() : start_(AllocCountsOfThread()) {}
+    AllocCounts Delta() const {
+        AllocCounts now = AllocCountsOfThread();
+        return { now.allocs - start_.allocs, now.bytes - start_.bytes, now.frees - start_.frees };
+    }
+
+  private:
+    AllocCounts start_;
+};
+
+// Checks what the statements of a block allocate on this thread:
+//   EXPECT_NO_ALLOC({ greeterGreet(g, "x"); });
+//   EXPECT_ALLOC_COUNT_LE(2, { g = greeterCreate("Hello"); });
+#define EXPECT_NO_ALLOC(...) \
+    do { \
+        AllocScope allocScope_; \
+        __VA_ARGS__; \
+        AllocCounts allocDelta_ = allocScope_.Delta(); \
+        EXPECT_EQ(allocDelta_.allocs, 0u) << "allocated " << allocDelta_.bytes << " bytes"; \
+    } while(0)
+
+#define EXPECT_ALLOC_COUNT_LE(max, ...) \
+    do { \
+        AllocScope allocScope_; \
+        __VA_ARGS__; \
+        EXPECT_LE(allocScope_.Delta().allocs, static_cast<uint64_t>(max)); \
+    } while(0)
+
+#define EXPECT_ALLOC_BYTES_LE(max, ...) \
+    do { \
+        AllocScope allocScope_; \
+        __VA_ARGS__; \
+        EXPECT_LE(allocScope_.Delta().bytes, static_cast<uint64_t>(max)); \
+    } while(0)
+
+#endif // ALLOC_COUNTER_HPP_
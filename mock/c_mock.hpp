@@ -0,0 +1,100 @@
+// c_mock.hpp
+#ifndef C_MOCK_HPP_
+#define C_MOCK_HPP_
+
+#include <gmock/gmock.h>
+#include <atomic>
+#include <cstdint>
+#include <tuple>
+#include <dlfcn.h>
+#include "single.hpp"
+
+// Mocks of C functions, declared instead of written by hand as
+// logger_mock.hpp and logger_mock.cpp are. With the C declaration in
+// scope, one line per function in a test:
+//
+//   C_MOCK(int, loggerWriteLog, (const char *));
+//
+//   TEST(GreeterTest, Logs) {
+//       CMock<loggerWriteLog> logger;
+//       EXPECT_CALL(logger, loggerWriteLog(StrEq("Hi, Bob!")));
+//       ...
+//
+// C_MOCK defines the function: a trampoline to the CMock of the calling
+// thread, scoped as ThreadSingle. While there is no CMock the call goes
+// to the next definition of the function, as in the logger library if it
+// is linked (with --no-as-needed: the mock leaves nothing for it to
+// resolve), else returns R(): no gMock, only a relaxed count of the calls
+// and a few loads. Mocks that more than one file uses are declared
+// with C_MOCK_DECLARE in a header and defined once with C_MOCK_DEFINE.
+// Up to 8 parameters, of any types.
+
+template<auto F>
+class CMock;
+
+#define C_MOCK(R, fn, params) \
+    C_MOCK_DECLARE(R, fn, params); \
+    C_MOCK_DEFINE(R, fn, params)
+
+#define C_MOCK_DECLARE(R, fn, params) \
+    template<> \
+    class CMock<fn> : public ThreadSingle<CMock<fn>> \
+    { \
+      public: \
+        typedef decltype(&::fn) Function; \
+        typedef std::tuple<C_MOCK_EXPAND params> Params; \
+        explicit CMock(SingleScope scope = SingleScope::Process) : ThreadSingle(scope) {} \
+        MOCK_METHOD(R, fn, params); \
+        /* calls of the function, mocked or not */ \
+        static uint64_t Calls() { return calls_.load(std::memory_order_relaxed); } \
+        static void ResetCalls() { calls_.store(0, std::memory_order_relaxed); } \
+        static void Count() { calls_.fetch_add(1, std::memory_order_relaxed); } \
+        /* the definition that C_MOCK replaces, or nullptr */ \
+        static Function Real() { \
+            static const Function real = reinterpret_cast<Function>(dlsym(RTLD_NEXT, #fn)); \
+            return real; \
+        } \
+      private: \
+        inline static std::atomic<uint64_t> calls_{ 0 }; \
+    }
+
+#define C_MOCK_DEFINE(R, fn, params) \
+    extern "C" R fn(C_MOCK_PARAMS(C_MOCK_COUNT params, fn)) { \
+        CMock<fn>::Count(); \
+        if(CMock<fn> *mock = CMock<fn>::FindInstance()) { return mock->fn(C_MOCK_NAMES(C_MOCK_COUNT params)); } \
+        if(CMock<fn>::Function real = CMock<fn>::Real()) { return real(C_MOCK_NAMES(C_MOCK_COUNT params)); } \
+        return R(); \
+    } \
+    static_assert(true, "")
+
+// what follows is how: the parameters get the types of Params by index
+#define C_MOCK_EXPAND(...) __VA_ARGS__
+#define C_MOCK_CAT(a, b) C_MOCK_CAT_(a, b)
+#define C_MOCK_CAT_(a, b) a##b
+#define C_MOCK_COUNT(...) C_MOCK_COUNT_(__VA_OPT__(__VA_ARGS__, ) 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define C_MOCK_COUNT_(a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+
+#define C_MOCK_PARAMS(n, fn) C_MOCK_CAT(C_MOCK_PARAMS_, n)(fn)
+#define C_MOCK_PARAM(i, fn) std::tuple_element_t<i, CMock<fn>::Params> a##i
+#define C_MOCK_PARAMS_0(fn)
+#define C_MOCK_PARAMS_1(fn) C_MOCK_PARAM(0, fn)
+#define C_MOCK_PARAMS_2(fn) C_MOCK_PARAMS_1(fn), C_MOCK_PARAM(1, fn)
+#define C_MOCK_PARAMS_3(fn) C_MOCK_PARAMS_2(fn), C_MOCK_PARAM(2, fn)
+#define C_MOCK_PARAMS_4(fn) C_MOCK_PARAMS_3(fn), C_MOCK_PARAM(3, fn)
+#define C_MOCK_PARAMS_5(fn) C_MOCK_PARAMS_4(fn), C_MOCK_PARAM(4, fn)
+#define C_MOCK_PARAMS_6(fn) C_MOCK_PARAMS_5(fn), C_MOCK_PARAM(5, fn)
+#define C_MOCK_PARAMS_7(fn) C_MOCK_PARAMS_6(fn), C_MOCK_PARAM(6, fn)
+#define C_MOCK_PARAMS_8(fn) C_MOCK_PARAMS_7(fn), C_MOCK_PARAM(7, fn)
+
+#define C_MOCK_NAMES(n) C_MOCK_CAT(C_MOCK_NAMES_, n)
+#define C_MOCK_NAMES_0
+#define C_MOCK_NAMES_1 a0
+#define C_MOCK_NAMES_2 C_MOCK_NAMES_1, a1
+#define C_MOCK_NAMES_3 C_MOCK_NAMES_2, a2
+#define C_MOCK_NAMES_4 C_MOCK_NAMES_3, a3
+#define C_MOCK_NAMES_5 C_MOCK_NAMES_4, a4
+#define C_MOCK_NAMES_6 C_MOCK_NAMES_5, a5
+#define C_MOCK_NAMES_7 C_MOCK_NAMES_6, a6
+#define C_MOCK_NAMES_8 C_MOCK_NAMES_7, a7
+
+#endif // C_MOCK_HPP_
@@ -0,0 +1,78 @@
+// logger_fake.cpp
+#include "logger_fake.hpp"
+#include <algorithm>
+#include <cstring>
+
+LoggerFake::LoggerFake(size_t arenaBytes, size_t maxMessages, SingleScope scope)
+    : ThreadSingle(scope), arenaBytes_(arenaBytes), maxMessages_(maxMessages),
+      arena_(new char[arenaBytes]), index_(new Entry[maxMessages]) {
+}
+
+// Reserves the bytes, only if they fit so that shorter messages still can,
+// then the index entry, whose order is the order of the calls; a message
+// dropped for either leaves no hole in the index.
+int LoggerFake::LoggerWriteLog(const char *message) {
+    size_t length = strlen(message);
+    size_t offset = used_.load(std::memory_order_relaxed);
+    do {
+        if(length > arenaBytes_ - offset) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+    } while( ! used_.compare_exchange_weak(offset, offset + length, std::memory_order_relaxed));
+    size_t slot = messages_.fetch_add(1, std::memory_order_relaxed);
+    if(slot >= maxMessages_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    memcpy(&arena_[offset], message, length);
+    index_[slot] = { offset, length };
+    return static_cast<int>(length) + 7;
+}
+
+size_t LoggerFake::Size() const {
+    return std::min(messages_.load(std::memory_order_acquire), maxMessages_);
+}
+
+size_t LoggerFake::Dropped() const {
+    return dropped_.load(std::memory_order_acquire);
+}
+
+std::string_view LoggerFake::Message(size_t i) const {
+    if(i >= Size()) { return std::string_view(); }
+    return std::string_view(&arena_[index_[i].offset], index_[i].length);
+}
+
+size_t LoggerFake::Count(std::string_view message) const {
+    size_t count = 0, n = Size();
+    for(size_t i = 0; i < n; ++i) { count += Message(i) == message; }
+    return count;
+}
+
+size_t LoggerFake::CountContaining(std::string_view part) const {
+    size_t count = 0, n = Size();
+    for(size_t i = 0; i < n; ++i) { count += Message(i).find(part) != std::string_view::npos; }
+    return count;
+}
+
+bool LoggerFake::ContainsInOrder(std::initializer_list<std::string_view> messages) const {
+    auto next = messages.begin();
+    for(size_t i = 0, n = Size(); i < n && next != messages.end(); ++i) {
+        if(Message(i) == *next) { ++next; }
+    }
+    return next == messages.end();
+}
+
+void LoggerFake::Clear() {
+    used_.store(0, std::memory_order_release);
+    messages_.store(0, std::memory_order_release);
+    dropped_.store(0, std::memory_order_release);
+}
+
+extern "C" {
+
+int loggerWriteLog(const char *message) {
+    return LoggerFake::GetInstance().LoggerWriteLog(message);
+}
+
+} // extern "C"
@@ -0,0 +1,57 @@
+// logger_fake.hpp
+#ifndef LOGGER_FAKE_HPP_
+#define LOGGER_FAKE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
+#include "single.hpp"
+extern "C" {
+#include "logger.h"
+}
+
+// Records what loggerWriteLog() is called with, for tests that log too
+// much for LoggerMock: a call costs two atomic updates and a copy instead of
+// gMock's expectation matching, from any number of threads at once.
+// Messages go into an arena allocated up front, indexed by offset in the
+// order of the calls; what does not fit is dropped and counted, and that
+// call returns -1. Query, or Clear(), after the logging threads are joined.
+// Link logger_fake.cpp instead of logger_mock.cpp; scopes as LoggerMock.
+class LoggerFake : public ThreadSingle<LoggerFake>
+{
+  public:
+    explicit LoggerFake(size_t arenaBytes = 64 << 20, size_t maxMessages = 1 << 20,
+                        SingleScope scope = SingleScope::Process);
+
+    // as the logger: the length of "[LOG] message\n"
+    int LoggerWriteLog(const char *message);
+
+    size_t Size() const;    // messages recorded
+    size_t Dropped() const; // messages that did not fit
+    std::string_view Message(size_t i) const;
+
+    size_t Count(std::string_view message) const;
+    size_t CountContaining(std::string_view part) const;
+    bool Contains(std::string_view message) const { return Count(message) > 0; }
+    // whether the messages were logged in this order, maybe among others
+    bool ContainsInOrder(std::initializer_list<std::string_view> messages) const;
+
+    void Clear();
+
+  private:
+    struct Entry
+    {
+        size_t offset, length;
+    };
+
+    const size_t arenaBytes_, maxMessages_;
+    std::unique_ptr<char[]> arena_;
+    std::unique_ptr<Entry[]> index_;
+    std::atomic<size_t> used_{ 0 };     // bytes of the arena
+    std::atomic<size_t> messages_{ 0 }; // entries of the index, dropped included
+    std::atomic<size_t> dropped_{ 0 };
+};
+
+#endif  // LOGGER_FAKE_HPP_
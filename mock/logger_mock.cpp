@@ -1,7 +1,7 @@
 // logger_mock.cpp
 #include "logger_mock.hpp"
 
-LoggerMock::LoggerMock() { // change default behavior of methods if needed:
+LoggerMock::LoggerMock(SingleScope scope) : ThreadSingle(scope) { // change default behavior of methods if needed:
     ON_CALL(*this, LoggerWriteLog).WillByDefault(::testing::Return(42));
 }
 
@@ -8,10 +8,13 @@ extern "C" {
 #include "logger.h"
 }
 
-class LoggerMock : public Single<LoggerMock>
+// loggerWriteLog() calls the LoggerMock of the calling thread, if it made
+// one with SingleScope::Thread, else the one made with the default scope.
+class LoggerMock : public ThreadSingle<LoggerMock>
 {
   public:
-    LoggerMock(); // constructor: if gMock's default behavior is not good enough
+    // constructor: if gMock's default behavior is not good enough
+    explicit LoggerMock(SingleScope scope = SingleScope::Process);
     MOCK_METHOD(int, LoggerWriteLog, (const char *message));
 };
 
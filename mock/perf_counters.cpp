@@ -0,0 +1,104 @@
+// perf_counters.cpp
+#include "perf_counters.hpp"
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const uint64_t kEvents[] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+// the others join the group of the first, to be counted over the same time
+static int Open(uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+}
+
+PerfCounters::PerfCounters()
+{
+    for(int i = 0; i < 4; ++i) { fds_[i] = Open(kEvents[i], i ? fds_[0] : -1); }
+    if(fds_[0] < 0) {
+        error_ = std::string("hardware performance counters unavailable: ") + strerror(errno);
+        for(int &fd : fds_) {
+            if(fd >= 0) { close(fd); }
+            fd = -1;
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for(int fd : fds_) {
+        if(fd >= 0) { close(fd); }
+    }
+}
+
+void PerfCounters::Start()
+{
+    if( ! Available()) { return; }
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// A counter the PMU had no room for while enabled, as when the NMI
+// watchdog or another process holds them, reads 0 having never run: not
+// counted, rather than 0. One that ran part of the time is scaled up.
+PerfCounts PerfCounters::Stop()
+{
+    uint64_t values[4] = { PERF_NOT_COUNTED, PERF_NOT_COUNTED, PERF_NOT_COUNTED, PERF_NOT_COUNTED };
+    if(Available()) {
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for(int i = 0; i < 4; ++i) {
+            uint64_t buf[3]; // value, time enabled, time running
+            if(fds_[i] < 0 || read(fds_[i], buf, sizeof(buf)) != sizeof(buf) || ! buf[2]) { continue; }
+            values[i] = buf[2] < buf[1] ? (uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+        }
+    }
+    return { values[0], values[1], values[2], values[3] };
+}
+
+bool PerfCountersUsable(std::string *error)
+{
+    PerfCounters perf;
+    if( ! perf.Available()) {
+        *error = perf.Error();
+        return false;
+    }
+    perf.Start();
+    if(perf.Stop().instructions == PERF_NOT_COUNTED) {
+        *error = "hardware performance counters not counting";
+        return false;
+    }
+    return true;
+}
+
+void PerfRecord(const std::string &name, PerfCounters &perf)
+{
+    PerfCounts c = perf.Stop();
+    const std::pair<const char *, uint64_t> counts[] = {
+        { ".instructions", c.instructions },
+        { ".cycles", c.cycles },
+        { ".cache_misses", c.cacheMisses },
+        { ".branch_misses", c.branchMisses },
+    };
+    for(const auto &count : counts) {
+        if(count.second != PERF_NOT_COUNTED) {
+            ::testing::Test::RecordProperty(name + count.first, std::to_string(count.second));
+        }
+    }
+}
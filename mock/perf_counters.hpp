@@ -0,0 +1,72 @@
+// perf_counters.hpp
+#ifndef PERF_COUNTERS_HPP_
+#define PERF_COUNTERS_HPP_
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+
+#define PERF_NOT_COUNTED UINT64_MAX // a counter the CPU or kernel lacks, or never ran
+
+struct PerfCounts
+{
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t cacheMisses;
+    uint64_t branchMisses;
+};
+
+// Hardware counters of the calling thread in user space, via
+// perf_event_open(2). Unavailable in most containers and VMs, and with
+// kernel.perf_event_paranoid above 2; checks are skipped then.
+class PerfCounters
+{
+  public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool Available() const { return fds_[0] >= 0; }
+    const std::string &Error() const { return error_; } // why not available
+
+    void Start();
+    PerfCounts Stop();
+
+  private:
+    int fds_[4];
+    std::string error_;
+};
+
+// Unlike time, instructions retired barely vary from run to run:
+//   EXPECT_INSTRUCTIONS_LE(2000, { greeterFormat(g, "Tom", 3, out, sizeof(out)); });
+// Without counters, or if they were not counted, skips the rest of the
+// test: check PerfCountersUsable() before acquiring what it must release.
+#define EXPECT_INSTRUCTIONS_LE(max, ...) \
+    do { \
+        PerfCounters perf_; \
+        if( ! perf_.Available()) { GTEST_SKIP() << perf_.Error(); } \
+        perf_.Start(); \
+        __VA_ARGS__; \
+        uint64_t instructions_ = perf_.Stop().instructions; \
+        if(instructions_ == PERF_NOT_COUNTED) { GTEST_SKIP() << "instructions not counted"; } \
+        EXPECT_LE(instructions_, static_cast<uint64_t>(max)); \
+    } while(0)
+
+// Whether the counters open and count, with why not to error.
+bool PerfCountersUsable(std::string *error);
+
+// Records the counts of a block as name.instructions, name.cycles,
+// name.cache_misses and name.branch_misses properties of the test, which
+// --gtest_output=json writes to the report; nothing if unavailable.
+#define PERF_RECORD(name, ...) \
+    do { \
+        PerfCounters perf_; \
+        perf_.Start(); \
+        __VA_ARGS__; \
+        PerfRecord(name, perf_); \
+    } while(0)
+
+void PerfRecord(const std::string &name, PerfCounters &perf);
+
+#endif // PERF_COUNTERS_HPP_
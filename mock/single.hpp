@@ -2,6 +2,7 @@
 #ifndef SINGLE_HPP_
 #define SINGLE_HPP_
 
+#include <atomic>
 #include <stdexcept>
 
 template<typename T>
@@ -39,5 +40,75 @@ class Single
 template<typename T>
 T *Single<T>::instance = nullptr;
 
+// Who a ThreadSingle instance serves: every thread without an instance of
+// its own, or only the thread that constructed it.
+enum class SingleScope { Process, Thread };
+
+// Single with an instance per thread, so that threads can each have their
+// own mock with their own expectations. GetInstance returns the instance
+// of the calling thread, else the process instance: an instance made by a
+// test also serves the threads the code under test starts. One process
+// instance at a time, and one thread instance per thread; a thread
+// instance must be destroyed on its thread. Neither lookup takes a lock.
+template<typename T>
+class ThreadSingle
+{
+  private:
+    static std::atomic<T *> shared;
+    static thread_local T *local;
+    const SingleScope scope_;
+
+  public:
+    explicit ThreadSingle(SingleScope scope = SingleScope::Process) : scope_(scope) {
+        T *self = static_cast<T *>(this);
+        if(scope_ == SingleScope::Thread) {
+            if(local != nullptr) {
+                throw std::runtime_error("Single instance per thread only!!");
+            }
+            local = self;
+            return;
+        }
+        T *none = nullptr;
+        if( ! shared.compare_exchange_strong(none, self, std::memory_order_acq_rel)) {
+            throw std::runtime_error("Single instance usage only!!");
+        }
+    }
+
+    virtual ~ThreadSingle() {
+        T *self = static_cast<T *>(this);
+        if(scope_ == SingleScope::Thread) {
+            if(local == self) { local = nullptr; }
+            return;
+        }
+        shared.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel);
+    }
+
+    ThreadSingle(const ThreadSingle &) = delete;
+    ThreadSingle(ThreadSingle &&) = delete;
+    ThreadSingle &operator=(ThreadSingle) = delete;
+    ThreadSingle &operator=(ThreadSingle &&) = delete;
+
+    // the instance for the calling thread, or nullptr
+    static T *FindInstance() {
+        T *instance = local;
+        return instance != nullptr ? instance : shared.load(std::memory_order_acquire);
+    }
+
+    static T &GetInstance() {
+        T *instance = FindInstance();
+        if(instance == nullptr) {
+            throw std::runtime_error("Uninitialized singleton instance use!");
+        }
+        return *instance;
+    }
+};
+
+
+template<typename T>
+std::atomic<T *> ThreadSingle<T>::shared{ nullptr };
+
+template<typename T>
+thread_local T *ThreadSingle<T>::local = nullptr;
+
 
 #endif // SINGLE_HPP_
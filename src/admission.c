@@ -0,0 +1,120 @@
+// admission.c
+#include "admission.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+
+struct admission_t
+{
+    admission_options_t opt;
+    pthread_mutex_t lock;
+    double limit;
+    int inflight;
+    // CoDel: the smallest queue delay seen since intervalStart
+    uint64_t intervalStart;
+    uint64_t minDelay;
+    int overloaded;
+    uint64_t lastDecrease;
+    admission_stats_t stats;
+};
+
+admission_t *admissionCreate(const admission_options_t *opt)
+{
+    admission_t *self = calloc(1, sizeof(admission_t));
+    if( ! self) { return NULL; }
+    if(opt) { self->opt = *opt; }
+    if( ! self->opt.target) { self->opt.target = 5000000; }
+    if( ! self->opt.interval) { self->opt.interval = 100000000; }
+    if( ! self->opt.minLimit) { self->opt.minLimit = 1; }
+    if( ! self->opt.maxLimit) { self->opt.maxLimit = 1024; }
+    if( ! self->opt.initialLimit) { self->opt.initialLimit = 16; }
+    if(self->opt.maxLimit < self->opt.minLimit) { self->opt.maxLimit = self->opt.minLimit; }
+    self->limit = self->opt.initialLimit < self->opt.minLimit ? self->opt.minLimit
+                : self->opt.initialLimit > self->opt.maxLimit ? self->opt.maxLimit
+                : self->opt.initialLimit;
+    self->minDelay = UINT64_MAX;
+    pthread_mutex_init(&self->lock, NULL);
+    return self;
+}
+
+void admissionDestroy(admission_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    pthread_mutex_destroy(&(*self)->lock);
+    free(*self);
+    *self = NULL;
+}
+
+uint64_t admissionNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+admission_verdict_t admissionAcquire(admission_t *self, uint64_t queuedAt, uint64_t now)
+{
+    admission_verdict_t verdict = ADMISSION_ADMIT;
+    pthread_mutex_lock(&self->lock);
+    // threads read the clock before the lock, so one may come in with a now
+    // a moment before what another recorded; the intervals would wrap
+    if(now < self->intervalStart) { now = self->intervalStart; }
+    if(now < self->lastDecrease) { now = self->lastDecrease; }
+    uint64_t delay = now > queuedAt ? now - queuedAt : 0;
+    self->stats.queueDelaySum += delay;
+    if(delay > self->stats.queueDelayMax) { self->stats.queueDelayMax = delay; }
+
+    // a queue that never drained below target for an interval is standing
+    if( ! self->intervalStart) { self->intervalStart = now; }
+    if(delay < self->minDelay) { self->minDelay = delay; }
+    if(now - self->intervalStart >= self->opt.interval) {
+        self->overloaded = self->minDelay > self->opt.target;
+        self->minDelay = UINT64_MAX;
+        self->intervalStart = now;
+    }
+    if(self->overloaded && now - self->lastDecrease >= self->opt.interval) {
+        self->limit *= 0.9;
+        if(self->limit < self->opt.minLimit) { self->limit = self->opt.minLimit; }
+        self->lastDecrease = now;
+    }
+
+    if(delay > (self->overloaded ? self->opt.target : self->opt.interval)) {
+        verdict = ADMISSION_SHED_QUEUE;
+        ++self->stats.shedQueue;
+    }
+    else if(self->inflight >= (int)self->limit) {
+        verdict = ADMISSION_SHED_LIMIT;
+        ++self->stats.shedLimit;
+    }
+    else {
+        ++self->inflight;
+        ++self->stats.admitted;
+    }
+    pthread_mutex_unlock(&self->lock);
+    return verdict;
+}
+
+void admissionRelease(admission_t *self)
+{
+    pthread_mutex_lock(&self->lock);
+    assert(self->inflight > 0);
+    // grow only a limit in use, or it would drift up while idle
+    if( ! self->overloaded && self->inflight >= (int)self->limit) {
+        self->limit += 1 / self->limit;
+        if(self->limit > self->opt.maxLimit) { self->limit = self->opt.maxLimit; }
+    }
+    --self->inflight;
+    pthread_mutex_unlock(&self->lock);
+}
+
+void admissionStats(admission_t *self, admission_stats_t *stats)
+{
+    pthread_mutex_lock(&self->lock);
+    *stats = self->stats;
+    stats->limit = (int)self->limit;
+    stats->inflight = self->inflight;
+    stats->overloaded = self->overloaded;
+    pthread_mutex_unlock(&self->lock);
+}
@@ -0,0 +1,65 @@
+// admission.h
+// Admission control for the servers around greeter. A request is shed,
+// not served, when it waited in a queue for too long or when too many
+// requests are being served already:
+//   - queue delay, CoDel style: once the delay has stayed above target for
+//     a whole interval, requests queued for longer than target are shed;
+//     otherwise only those queued for longer than interval are
+//   - concurrency: at most limit requests in service; the limit grows by
+//     one per limit completions (additive increase) while not overloaded,
+//     and shrinks by a tenth (multiplicative decrease) at most once an
+//     interval while overloaded
+// Thread-safe; one instance may guard several servers. Times are
+// CLOCK_MONOTONIC nanoseconds, see admissionNow().
+#ifndef ADMISSION_H_
+#define ADMISSION_H_
+
+#include <stdint.h>
+
+typedef struct admission_t admission_t;
+
+typedef struct admission_options_t
+{
+    uint64_t target;   // ns; 0 for 5 ms
+    uint64_t interval; // ns; 0 for 100 ms
+    int initialLimit;  // 0 for 16
+    int minLimit;      // 0 for 1
+    int maxLimit;      // 0 for 1024
+
+} admission_options_t;
+
+typedef enum admission_verdict_t
+{
+    ADMISSION_ADMIT,
+    ADMISSION_SHED_QUEUE, // waited too long
+    ADMISSION_SHED_LIMIT, // over the concurrency limit
+
+} admission_verdict_t;
+
+typedef struct admission_stats_t
+{
+    uint64_t admitted;
+    uint64_t shedQueue;
+    uint64_t shedLimit;
+    uint64_t queueDelaySum; // ns, over every request seen
+    uint64_t queueDelayMax;
+    int limit;
+    int inflight;
+    int overloaded;
+
+} admission_stats_t;
+
+// opt may be NULL for the defaults
+admission_t *admissionCreate(const admission_options_t *opt);
+void admissionDestroy(admission_t **self);
+
+uint64_t admissionNow(void);
+
+// Decides on a request queued at queuedAt; an admitted one must be
+// released once served.
+admission_verdict_t admissionAcquire(admission_t *self, uint64_t queuedAt, uint64_t now);
+void admissionRelease(admission_t *self);
+
+void admissionStats(admission_t *self, admission_stats_t *stats);
+
+#endif // ADMISSION_H_
@@ -0,0 +1,436 @@
+// batch.c
+#include "batch.h"
+#include "batch_uring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DEFAULT_BUFFER_SIZE (4 << 20)
+#define CHUNK_SIZE (1 << 20)
+#define CHUNKS_PER_THREAD 4 // in flight, bounds reassembly memory
+
+typedef struct
+{
+    int fd; // buffers with no fd grow instead of being flushed
+    char *buf;
+    size_t len;
+    size_t cap;
+    uint64_t total;
+
+} output_t;
+
+typedef struct
+{
+    const batch_options_t *opt;
+    batch_stats_t *stats;
+    struct timespec start;
+    struct timespec lastReport;
+    int reported;
+
+} progress_t;
+
+static double secondsSince(const struct timespec *t)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+}
+
+static int writeAll(int fd, const char *p, size_t len)
+{
+    while(len) {
+        ssize_t n = write(fd, p, len);
+        if(n < 0) {
+            if(errno == EINTR) { continue; }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int outFlush(output_t *o)
+{
+    if(writeAll(o->fd, o->buf, o->len)) { return -1; }
+    o->total += o->len;
+    o->len = 0;
+    return 0;
+}
+
+// flushes the buffer, or grows it when that cannot make room
+static int outMakeRoom(output_t *o)
+{
+    if(o->fd >= 0 && o->len) { return outFlush(o); }
+    size_t cap = o->cap ? 2 * o->cap : 4096;
+    char *buf = realloc(o->buf, cap);
+    if( ! buf) { return -1; }
+    o->buf = buf;
+    o->cap = cap;
+    return 0;
+}
+
+static void report(progress_t *p, uint64_t bytesIn)
+{
+    if( ! p->opt->progress || secondsSince(&p->lastReport) < 1.0) { return; }
+    clock_gettime(CLOCK_MONOTONIC, &p->lastReport);
+    double s = secondsSince(&p->start);
+    fprintf(stderr, "\rbatch: %llu names, %.1f MB in, %.2f GB/s",
+            (unsigned long long)p->stats->names, bytesIn / 1e6, bytesIn / s / 1e9);
+    p->reported = 1;
+}
+
+// greets the complete lines of in[0..len), and the rest too if last
+static size_t greetLines(output_t *o, const greeter_t *g, const batch_options_t *opt,
+                         const char *in, size_t len, int last, progress_t *p)
+{
+    size_t done = 0;
+    for(;;) {
+        size_t used;
+        o->len += batchGreetLines(g, opt->framing, in + done, len - done, last,
+                                  o->buf + o->len, o->cap - o->len, &used, &p->stats->names);
+        done += used;
+        report(p, p->stats->bytesIn + done);
+        if(done == len || ( ! last && ! memchr(in + done, '\n', len - done))) { return done; }
+        if(outMakeRoom(o)) { return (size_t)-1; } // the next greeting did not fit
+    }
+}
+
+// A chunk is a newline-aligned slice of the input, greeted by one worker
+// into its own buffer and written out by the caller in input order.
+typedef struct
+{
+    const char *in;
+    size_t len;
+    output_t out;
+    batch_stats_t stats;
+    int status;
+    int done; // guarded by pool_t.lock
+
+} chunk_t;
+
+// Per-worker queue of chunk slots. Its owner and thieves both take from
+// the head: the oldest chunk is the one the writer waits for.
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t *slots;
+    size_t head;
+    size_t tail;
+
+} deque_t;
+
+typedef struct pool_t pool_t;
+
+typedef struct
+{
+    pool_t *pool;
+    size_t id;
+    greeter_t *greeter;
+    pthread_t thread;
+
+} worker_t;
+
+struct pool_t
+{
+    batch_options_t opt;
+    chunk_t *chunks; // ring of window slots
+    size_t window;
+    deque_t *deques;
+    worker_t *workers;
+    size_t threads;
+    size_t queued; // chunks in all deques, atomic
+    int shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+};
+
+static int dequeTake(deque_t *d, size_t window, size_t *slot)
+{
+    pthread_mutex_lock(&d->lock);
+    int found = d->head != d->tail;
+    if(found) { *slot = d->slots[d->head++ % window]; }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static int poolTake(pool_t *pool, size_t id, size_t *slot)
+{
+    for(size_t i = 0; i < pool->threads; ++i) { // own deque first, then steal
+        if(dequeTake(&pool->deques[(id + i) % pool->threads], pool->window, slot)) {
+            __atomic_fetch_sub(&pool->queued, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *workerRun(void *arg)
+{
+    worker_t *w = arg;
+    pool_t *pool = w->pool;
+    for(;;) {
+        size_t slot;
+        if( ! poolTake(pool, w->id, &slot)) {
+            pthread_mutex_lock(&pool->lock);
+            while( ! __atomic_load_n(&pool->queued, __ATOMIC_RELAXED) && ! pool->shutdown) {
+                pthread_cond_wait(&pool->work, &pool->lock);
+            }
+            int stop = pool->shutdown && ! __atomic_load_n(&pool->queued, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&pool->lock);
+            if(stop) { return NULL; }
+            continue;
+        }
+        chunk_t *c = &pool->chunks[slot];
+        progress_t quiet = { .opt = &pool->opt, .stats = &c->stats };
+        size_t n = greetLines(&c->out, w->greeter, &pool->opt, c->in, c->len, 1, &quiet);
+        c->status = (n == (size_t)-1) ? -1 : 0;
+
+        pthread_mutex_lock(&pool->lock);
+        c->done = 1;
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void poolDestroy(pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for(size_t i = 0; i < pool->threads; ++i) {
+        if(pool->workers[i].thread) { pthread_join(pool->workers[i].thread, NULL); }
+        greeterDestroy(&pool->workers[i].greeter);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].slots);
+    }
+    for(size_t i = 0; i < pool->window; ++i) { free(pool->chunks[i].out.buf); }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool->chunks);
+}
+
+static int poolCreate(pool_t *pool, const greeter_t *g, const batch_options_t *opt)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->opt = *opt;
+    pool->opt.progress = 0; // only the writer reports
+    pool->threads = opt->threads;
+    pool->window = opt->threads * CHUNKS_PER_THREAD;
+    pool->chunks = calloc(pool->window, sizeof(chunk_t));
+    pool->deques = calloc(pool->threads, sizeof(deque_t));
+    pool->workers = calloc(pool->threads, sizeof(worker_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    if( ! pool->chunks || ! pool->deques || ! pool->workers) {
+        pool->threads = pool->window = 0;
+        return -1;
+    }
+    for(size_t i = 0; i < pool->window; ++i) { pool->chunks[i].out.fd = -1; }
+
+    int rc = 0;
+    for(size_t i = 0; i < pool->threads; ++i) { // every deque exists before anyone steals
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].slots = malloc(pool->window * sizeof(size_t));
+        if( ! pool->deques[i].slots) { rc = -1; }
+    }
+    for(size_t i = 0; ! rc && i < pool->threads; ++i) {
+        worker_t *w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        w->greeter = greeterCreate(greeterGreeting(g)); // one greeter per worker
+        if( ! w->greeter || pthread_create(&w->thread, NULL, workerRun, w)) { rc = -1; }
+    }
+    return rc;
+}
+
+static void poolPush(pool_t *pool, size_t seq)
+{
+    size_t slot = seq % pool->window;
+    deque_t *d = &pool->deques[seq % pool->threads];
+    pthread_mutex_lock(&d->lock);
+    d->slots[d->tail++ % pool->window] = slot;
+    pthread_mutex_unlock(&d->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    __atomic_fetch_add(&pool->queued, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int greetParallel(output_t *o, const greeter_t *g, const batch_options_t *opt,
+                         const char *data, size_t size, progress_t *p)
+{
+    pool_t pool;
+    int rc = poolCreate(&pool, g, opt);
+    size_t pos = 0, dispatched = 0, written = 0;
+    while( ! rc && (pos < size || written < dispatched)) {
+        while(pos < size && dispatched - written < pool.window) {
+            size_t end = size - pos > CHUNK_SIZE ? pos + CHUNK_SIZE : size;
+            const char *nl = memchr(data + end - 1, '\n', size - end + 1);
+            end = nl ? (size_t)(nl - data) + 1 : size;
+
+            chunk_t *c = &pool.chunks[dispatched % pool.window];
+            c->in = data + pos;
+            c->len = end - pos;
+            c->out.len = 0;
+            memset(&c->stats, 0, sizeof(c->stats));
+            c->done = 0;
+            poolPush(&pool, dispatched++);
+            pos = end;
+        }
+
+        chunk_t *c = &pool.chunks[written++ % pool.window];
+        pthread_mutex_lock(&pool.lock);
+        while( ! c->done) { pthread_cond_wait(&pool.done, &pool.lock); }
+        pthread_mutex_unlock(&pool.lock);
+        if(c->status || writeAll(o->fd, c->out.buf, c->out.len)) { rc = -1; }
+        o->total += c->out.len;
+        p->stats->names += c->stats.names;
+        p->stats->bytesIn += c->len;
+        report(p, p->stats->bytesIn);
+    }
+    poolDestroy(&pool);
+    return rc;
+}
+
+static int greetMapped(output_t *o, const greeter_t *g, const batch_options_t *opt,
+                       int in, size_t size, progress_t *p)
+{
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in, 0);
+    if(data == MAP_FAILED) { return -1; }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+    int rc = 0;
+    if(opt->threads > 1) {
+        rc = greetParallel(o, g, opt, data, size, p);
+    }
+    else {
+        size_t done = greetLines(o, g, opt, data, size, 1, p);
+        if(done == (size_t)-1) { rc = -1; }
+        else { p->stats->bytesIn += done; }
+    }
+    munmap((void *)data, size);
+    return rc;
+}
+
+// reads in with pread() from offset on, or with read() if offset is -1
+static int greetStream(output_t *o, const greeter_t *g, const batch_options_t *opt,
+                       int in, off_t offset, size_t bufferSize, progress_t *p)
+{
+    size_t cap = bufferSize, len = 0;
+    char *buf = malloc(cap);
+    if( ! buf) { return -1; }
+    for(;;) {
+        if(len == cap) { // a line longer than the buffer
+            char *bigger = realloc(buf, cap * 2);
+            if( ! bigger) { break; }
+            buf = bigger;
+            cap *= 2;
+        }
+        ssize_t n = offset < 0 ? read(in, buf + len, cap - len)
+                               : pread(in, buf + len, cap - len, offset);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0) { break; }
+        if(offset >= 0) { offset += n; }
+        len += n;
+        size_t done = greetLines(o, g, opt, buf, len, n == 0, p);
+        if(done == (size_t)-1) { break; }
+        p->stats->bytesIn += done;
+        if(n == 0) {
+            free(buf);
+            return 0;
+        }
+        memmove(buf, buf + done, len - done);
+        len -= done;
+    }
+    free(buf);
+    return -1;
+}
+
+size_t batchGreetLines(const greeter_t *g, batch_framing_t framing,
+                       const char *in, size_t len, int last,
+                       char *out, size_t cap, size_t *consumed, uint64_t *names)
+{
+    const char *pos = in, *end = in + len;
+    size_t used = 0;
+    while(pos < end) {
+        const char *nl = memchr(pos, '\n', end - pos);
+        if( ! nl && ! last) { break; }
+        const char *eol = nl ?: end;
+        size_t n = eol - pos;
+        if(n && pos[n - 1] == '\r') { --n; }
+        size_t r = batchFrame(g, framing, pos, n, out + used, cap - used);
+        if(r > cap - used) { break; }
+        used += r;
+        ++*names;
+        pos = nl ? nl + 1 : end;
+    }
+    *consumed = pos - in;
+    return used;
+}
+
+size_t batchFrame(const greeter_t *g, batch_framing_t framing,
+                  const char *name, size_t len, char *out, size_t cap)
+{
+    size_t head = framing == BATCH_LENGTH ? 4 : 0;
+    size_t tail = framing == BATCH_LENGTH ? 0 : 1;
+    size_t n = greeterFormat(g, name, len, out + head, cap > head ? cap - head : 0);
+    if(head + n + tail > cap) { return head + n + tail; }
+    if(framing == BATCH_LENGTH) {
+        out[0] = (char)(n >> 24);
+        out[1] = (char)(n >> 16);
+        out[2] = (char)(n >> 8);
+        out[3] = (char)n;
+    }
+    else {
+        out[n] = framing == BATCH_NUL ? '\0' : '\n';
+    }
+    return head + n + tail;
+}
+
+int batchGreet(const greeter_t *g, int in, int out,
+               const batch_options_t *opt, batch_stats_t *stats)
+{
+    size_t bufferSize = opt->bufferSize ?: DEFAULT_BUFFER_SIZE;
+    output_t o = { .fd = out, .buf = malloc(bufferSize), .cap = bufferSize };
+    if( ! o.buf) { return -1; }
+    memset(stats, 0, sizeof(*stats));
+    progress_t p = { .opt = opt, .stats = stats };
+    clock_gettime(CLOCK_MONOTONIC, &p.start);
+    p.lastReport = p.start;
+
+    struct stat st;
+    int regular = fstat(in, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    int rc = 0;
+    stats->io = regular ? opt->io : BATCH_IO_MMAP;
+    if(stats->io == BATCH_IO_URING) {
+        rc = batchUringGreet(g, in, st.st_size, out, opt, stats);
+        if(rc == BATCH_URING_UNAVAILABLE) { stats->io = BATCH_IO_PREAD; }
+    }
+    if(stats->io == BATCH_IO_PREAD) {
+        rc = greetStream(&o, g, opt, in, 0, bufferSize, &p);
+    }
+    else if(stats->io == BATCH_IO_MMAP) {
+        rc = regular ? greetMapped(&o, g, opt, in, st.st_size, &p)
+                     : greetStream(&o, g, opt, in, -1, bufferSize, &p);
+    }
+    if( ! rc) { rc = outFlush(&o); }
+    free(o.buf);
+
+    stats->bytesOut += o.total;
+    stats->seconds = secondsSince(&p.start);
+    if(p.reported) { fputc('\n', stderr); }
+    return rc;
+}
@@ -0,0 +1,66 @@
+// batch.h
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "greeter.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum batch_framing_t
+{
+    BATCH_LINES,  // greeting '\n'
+    BATCH_NUL,    // greeting '\0'
+    BATCH_LENGTH, // 32-bit big-endian length, then greeting
+
+} batch_framing_t;
+
+typedef enum batch_io_t
+{
+    BATCH_IO_MMAP,  // map regular files, read() anything else
+    BATCH_IO_PREAD, // pread() regular files in buffer sized chunks
+    BATCH_IO_URING, // io_uring, or BATCH_IO_PREAD where it is unavailable
+
+} batch_io_t;
+
+typedef struct batch_options_t
+{
+    batch_framing_t framing;
+    size_t bufferSize; // output (and stdin) buffer, 0 for the default
+    int progress;      // report progress on stderr
+    size_t threads;    // BATCH_IO_MMAP workers for regular files, 0 or 1 for none
+    batch_io_t io;
+    unsigned queueDepth; // BATCH_IO_URING reads in flight, 0 for the default
+
+} batch_options_t;
+
+typedef struct batch_stats_t
+{
+    uint64_t names;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    double seconds;
+    batch_io_t io; // the engine that did the work
+
+} batch_stats_t;
+
+// Writes one framed greeting of the len long name to out. Returns the
+// record length; nothing is written if that exceeds cap.
+size_t batchFrame(const greeter_t *g, batch_framing_t framing,
+                  const char *name, size_t len, char *out, size_t cap);
+
+// Greets the complete lines of in[0..len), and a last unterminated one if
+// last is set, into out while they fit in cap. Returns the bytes written;
+// *consumed is set to the input used and *names is increased by its lines.
+size_t batchGreetLines(const greeter_t *g, batch_framing_t framing,
+                       const char *in, size_t len, int last,
+                       char *out, size_t cap, size_t *consumed, uint64_t *names);
+
+// Greets every newline-delimited name read from in (memory-mapped if it is
+// a regular file) and writes the framed greetings to out in input order.
+// Regular files are split into chunks for opt->threads workers, each with
+// a greeter of its own, or read as opt->io selects. Greetings are not
+// logged. Returns 0, or -1 with errno set on an I/O error.
+int batchGreet(const greeter_t *g, int in, int out,
+               const batch_options_t *opt, batch_stats_t *stats);
+
+#endif // BATCH_H_
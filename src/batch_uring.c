@@ -0,0 +1,410 @@
+// batch_uring.c
+// io_uring engine for batchGreet() on the raw system calls, so that no
+// liburing is needed at build time.
+#include "batch_uring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define DEFAULT_QUEUE_DEPTH 8
+#define DEFAULT_CHUNK_SIZE (1 << 20)
+
+enum { OP_READ, OP_WRITE };
+
+typedef struct
+{
+    int fd;
+    unsigned entries;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    unsigned sqLocalTail;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqMap, *cqMap;
+    size_t sqMapSize, cqMapSize, sqesSize;
+
+} uring_t;
+
+typedef struct
+{
+    char *buf;
+    size_t len;  // bytes read
+    int ready;
+
+} slot_t;
+
+typedef struct
+{
+    uring_t ring;
+    int fixed;          // buffers are registered
+    int in, out;
+    size_t size;        // of the input
+    size_t chunk;       // read size
+    size_t outCap;
+    unsigned depth;
+    slot_t *slots;      // depth input buffers, seq % depth
+    char **outBufs;     // depth output buffers
+    size_t *outLens;
+    unsigned *outFree;  // stack of free output buffers
+    unsigned freeCount;
+    unsigned *ready;    // FIFO of filled output buffers waiting for a write
+    unsigned readyCount;
+    unsigned writing;   // writes of the chain in flight
+    unsigned reading;   // reads in flight
+    int cur;            // output buffer being filled, or -1
+    char *carry;        // a line spanning chunks
+    size_t carryLen, carryCap;
+    const greeter_t *g;
+    const batch_options_t *opt;
+    batch_stats_t *stats;
+
+} engine_t;
+
+static int uringSetup(uring_t *r, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if(r->fd < 0) { return -1; }
+
+    r->entries = p.sq_entries;
+    r->sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single && r->cqMapSize > r->sqMapSize) { r->sqMapSize = r->cqMapSize; }
+    r->sqMap = mmap(NULL, r->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    r->fd, IORING_OFF_SQ_RING);
+    r->cqMap = single ? r->sqMap
+                      : mmap(NULL, r->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             r->fd, IORING_OFF_CQ_RING);
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if(r->sqMap == MAP_FAILED || r->cqMap == MAP_FAILED || r->sqes == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+
+    char *sq = r->sqMap, *cq = r->cqMap;
+    r->sqHead = (unsigned *)(sq + p.sq_off.head);
+    r->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    r->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(sq + p.sq_off.array);
+    r->cqHead = (unsigned *)(cq + p.cq_off.head);
+    r->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    r->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sqLocalTail = *r->sqTail;
+    return 0;
+}
+
+static void uringDestroy(uring_t *r)
+{
+    munmap(r->sqes, r->sqesSize);
+    if(r->cqMap != r->sqMap) { munmap(r->cqMap, r->cqMapSize); }
+    munmap(r->sqMap, r->sqMapSize);
+    close(r->fd);
+}
+
+static struct io_uring_sqe *uringSqe(uring_t *r)
+{
+    unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+    if(r->sqLocalTail - head >= r->entries) { return NULL; }
+    unsigned i = r->sqLocalTail++ & *r->sqMask;
+    r->sqArray[i] = i;
+    memset(&r->sqes[i], 0, sizeof(struct io_uring_sqe));
+    return &r->sqes[i];
+}
+
+// submits the queued entries and waits for at least wait completions
+static int uringEnter(uring_t *r, unsigned wait)
+{
+    unsigned submit = r->sqLocalTail - *r->sqTail;
+    __atomic_store_n(r->sqTail, r->sqLocalTail, __ATOMIC_RELEASE);
+    while(submit || wait) {
+        int n = syscall(__NR_io_uring_enter, r->fd, submit, wait,
+                        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0) { return -1; }
+        submit -= n;
+        wait = 0;
+    }
+    return 0;
+}
+
+static int uringReap(uring_t *r, struct io_uring_cqe *cqe)
+{
+    unsigned head = *r->cqHead;
+    if(head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE)) { return 0; }
+    *cqe = r->cqes[head & *r->cqMask];
+    __atomic_store_n(r->cqHead, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void prepRw(engine_t *e, struct io_uring_sqe *sqe, int write, int fd,
+                   char *buf, size_t len, uint64_t off, unsigned bufIndex, unsigned id)
+{
+    sqe->opcode = e->fixed ? (write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED)
+                           : (write ? IORING_OP_WRITE : IORING_OP_READ);
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->buf_index = bufIndex;
+    sqe->user_data = ((uint64_t)write << 32) | id;
+}
+
+static int writeAll(int fd, const char *p, size_t len)
+{
+    while(len) {
+        ssize_t n = write(fd, p, len);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0) { return -1; }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// queues every filled output buffer as one chain of linked writes, which
+// the kernel runs in order; a new chain starts only when the last is done
+static void submitWrites(engine_t *e)
+{
+    if(e->writing || ! e->readyCount) { return; }
+    for(unsigned i = 0; i < e->readyCount; ++i) {
+        unsigned b = e->ready[i];
+        struct io_uring_sqe *sqe = uringSqe(&e->ring);
+        prepRw(e, sqe, 1, e->out, e->outBufs[b], e->outLens[b], (uint64_t)-1, e->depth + b, b);
+        if(i + 1 < e->readyCount) { sqe->flags |= IOSQE_IO_LINK; }
+    }
+    e->writing = e->readyCount;
+    e->readyCount = 0;
+}
+
+static int complete(engine_t *e, const struct io_uring_cqe *cqe)
+{
+    unsigned id = (unsigned)cqe->user_data;
+    if(cqe->user_data >> 32 == OP_READ) {
+        slot_t *s = &e->slots[id];
+        --e->reading;
+        if(cqe->res < 0) { errno = -cqe->res; return -1; }
+        s->len = cqe->res;
+        s->ready = 1;
+        return 0;
+    }
+    // a short write breaks the chain: finish it and the cancelled rest here
+    --e->writing;
+    e->outFree[e->freeCount++] = id;
+    size_t done = cqe->res == -ECANCELED ? 0 : (size_t)cqe->res;
+    if(cqe->res < 0 && cqe->res != -ECANCELED) { errno = -cqe->res; return -1; }
+    if(done < e->outLens[id] && writeAll(e->out, e->outBufs[id] + done, e->outLens[id] - done)) {
+        return -1;
+    }
+    e->stats->bytesOut += e->outLens[id];
+    return 0;
+}
+
+// waits for one completion, or handles those already there
+static int waitAny(engine_t *e)
+{
+    submitWrites(e);
+    struct io_uring_cqe cqe;
+    if( ! uringReap(&e->ring, &cqe)) {
+        if(uringEnter(&e->ring, 1)) { return -1; }
+        if( ! uringReap(&e->ring, &cqe)) { return 0; }
+    }
+    do {
+        if(complete(e, &cqe)) { return -1; }
+    } while(uringReap(&e->ring, &cqe));
+    return 0;
+}
+
+static void flushCurrent(engine_t *e)
+{
+    if(e->cur >= 0 && e->outLens[e->cur]) {
+        e->ready[e->readyCount++] = e->cur;
+        e->cur = -1;
+    }
+}
+
+// a greeting larger than an output buffer is written once all before it are
+static int greetHuge(engine_t *e, const char *in, size_t len, int last, size_t *consumed)
+{
+    flushCurrent(e);
+    while(e->writing || e->readyCount) {
+        if(waitAny(e)) { return -1; }
+    }
+    char *buf = NULL;
+    size_t cap = len + 4096, n = 0;
+    while( ! n) { // emit() found a complete line, so this ends
+        char *bigger = realloc(buf, cap *= 2);
+        if( ! bigger) { break; }
+        buf = bigger;
+        n = batchGreetLines(e->g, e->opt->framing, in, len, last, buf, cap, consumed, &e->stats->names);
+    }
+    int rc = (buf && n) ? writeAll(e->out, buf, n) : -1;
+    if( ! rc) { e->stats->bytesOut += n; }
+    free(buf);
+    return rc;
+}
+
+// greets the complete lines of in[0..len) (all if last) into output buffers
+static int emit(engine_t *e, const char *in, size_t len, int last, size_t *consumed)
+{
+    size_t done = 0;
+    for(;;) {
+        if(e->cur < 0) {
+            while( ! e->freeCount) {
+                if(waitAny(e)) { return -1; }
+            }
+            e->cur = e->outFree[--e->freeCount];
+            e->outLens[e->cur] = 0;
+        }
+        size_t used, *outLen = &e->outLens[e->cur];
+        *outLen += batchGreetLines(e->g, e->opt->framing, in + done, len - done, last,
+                                   e->outBufs[e->cur] + *outLen, e->outCap - *outLen,
+                                   &used, &e->stats->names);
+        done += used;
+        if(done == len || ( ! last && ! memchr(in + done, '\n', len - done))) { break; }
+        if( ! used && ! *outLen) {
+            if(greetHuge(e, in + done, len - done, last, &used)) { return -1; }
+            done += used;
+        }
+        else {
+            flushCurrent(e);
+        }
+    }
+    *consumed = done;
+    return 0;
+}
+
+static int carryAppend(engine_t *e, const char *p, size_t len)
+{
+    if(e->carryLen + len > e->carryCap) {
+        size_t cap = 2 * (e->carryLen + len);
+        char *carry = realloc(e->carry, cap);
+        if( ! carry) { return -1; }
+        e->carry = carry;
+        e->carryCap = cap;
+    }
+    memcpy(e->carry + e->carryLen, p, len);
+    e->carryLen += len;
+    return 0;
+}
+
+// greets the lines of one chunk, joining the line carried from the last
+static int process(engine_t *e, slot_t *s, int last)
+{
+    const char *p = s->buf;
+    size_t len = s->len, used;
+    if(e->carryLen) {
+        const char *nl = memchr(p, '\n', len);
+        size_t head = nl ? (size_t)(nl - p) + 1 : len;
+        if(carryAppend(e, p, head)) { return -1; }
+        p += head;
+        len -= head;
+        if(nl || last) {
+            if(emit(e, e->carry, e->carryLen, 1, &used)) { return -1; }
+            e->carryLen = 0;
+        }
+    }
+    if(emit(e, p, len, last, &used)) { return -1; }
+    return carryAppend(e, p + used, len - used);
+}
+
+static void engineDestroy(engine_t *e)
+{
+    for(unsigned i = 0; i < e->depth; ++i) {
+        if(e->slots) { free(e->slots[i].buf); }
+        if(e->outBufs) { free(e->outBufs[i]); }
+    }
+    free(e->slots);
+    free(e->outBufs);
+    free(e->outLens);
+    free(e->outFree);
+    free(e->ready);
+    free(e->carry);
+    uringDestroy(&e->ring);
+}
+
+static int engineCreate(engine_t *e)
+{
+    e->slots = calloc(e->depth, sizeof(slot_t));
+    e->outBufs = calloc(e->depth, sizeof(char *));
+    e->outLens = calloc(e->depth, sizeof(size_t));
+    e->outFree = calloc(e->depth, sizeof(unsigned));
+    e->ready = calloc(e->depth, sizeof(unsigned));
+    if( ! e->slots || ! e->outBufs || ! e->outLens || ! e->outFree || ! e->ready) { return -1; }
+
+    struct iovec *iov = calloc(2 * e->depth, sizeof(struct iovec));
+    if( ! iov) { return -1; }
+    int rc = 0;
+    for(unsigned i = 0; i < e->depth; ++i) {
+        rc |= posix_memalign((void **)&e->slots[i].buf, 4096, e->chunk);
+        rc |= posix_memalign((void **)&e->outBufs[i], 4096, e->outCap);
+        iov[i] = (struct iovec){ e->slots[i].buf, e->chunk };
+        iov[e->depth + i] = (struct iovec){ e->outBufs[i], e->outCap };
+        e->outFree[e->freeCount++] = i;
+    }
+    // pinned buffers save a page walk per I/O; without them plain reads do
+    e->fixed = ! rc && ! syscall(__NR_io_uring_register, e->ring.fd, IORING_REGISTER_BUFFERS,
+                                 iov, 2 * e->depth);
+    free(iov);
+    return rc ? -1 : 0;
+}
+
+int batchUringGreet(const greeter_t *g, int in, size_t size, int out,
+                    const batch_options_t *opt, batch_stats_t *stats)
+{
+    engine_t e = {
+        .in = in, .out = out, .size = size, .cur = -1,
+        .depth = opt->queueDepth ?: DEFAULT_QUEUE_DEPTH,
+        .chunk = opt->bufferSize ?: DEFAULT_CHUNK_SIZE,
+        .g = g, .opt = opt, .stats = stats,
+    };
+    e.outCap = 2 * e.chunk;
+    if(uringSetup(&e.ring, 2 * e.depth)) { return BATCH_URING_UNAVAILABLE; }
+    int rc = engineCreate(&e);
+
+    size_t chunks = (size + e.chunk - 1) / e.chunk, issued = 0;
+    for(size_t seq = 0; ! rc && seq < chunks; ++seq) {
+        for(; issued < chunks && issued < seq + e.depth; ++issued) { // keep depth reads in flight
+            slot_t *s = &e.slots[issued % e.depth];
+            uint64_t off = (uint64_t)issued * e.chunk;
+            size_t len = size - off < e.chunk ? size - off : e.chunk;
+            s->ready = 0;
+            ++e.reading;
+            prepRw(&e, uringSqe(&e.ring), 0, in, s->buf, len, off, issued % e.depth, issued % e.depth);
+        }
+        slot_t *s = &e.slots[seq % e.depth];
+        while( ! rc && ! s->ready) { rc = waitAny(&e); }
+        if(rc) { break; }
+
+        uint64_t off = (uint64_t)seq * e.chunk;
+        size_t want = size - off < e.chunk ? size - off : e.chunk;
+        while(s->len < want) { // short read: the file shrank, or a signal
+            ssize_t n = pread(in, s->buf + s->len, want - s->len, off + s->len);
+            if(n <= 0) { break; }
+            s->len += n;
+        }
+        stats->bytesIn += s->len;
+        rc = process(&e, s, seq + 1 == chunks);
+    }
+    if( ! rc) { flushCurrent(&e); }
+    while( ! rc && (e.writing || e.readyCount)) { rc = waitAny(&e); }
+    while(e.writing || e.reading) { // after an error: no I/O into freed buffers
+        struct io_uring_cqe cqe;
+        if(uringEnter(&e.ring, 1)) { break; }
+        while(uringReap(&e.ring, &cqe)) {
+            if(cqe.user_data >> 32 == OP_WRITE) { --e.writing; } else { --e.reading; }
+        }
+    }
+    engineDestroy(&e);
+    return rc;
+}
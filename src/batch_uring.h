@@ -0,0 +1,16 @@
+// batch_uring.h
+#ifndef BATCH_URING_H_
+#define BATCH_URING_H_
+
+#include "batch.h"
+
+#define BATCH_URING_UNAVAILABLE 1
+
+// batchGreet() of the size long regular file in through io_uring: reads of
+// registered buffers at opt->queueDepth, writes linked in output order.
+// Returns 0, -1 on an I/O error or BATCH_URING_UNAVAILABLE, having done
+// nothing, if the kernel does not provide io_uring.
+int batchUringGreet(const greeter_t *g, int in, size_t size, int out,
+                    const batch_options_t *opt, batch_stats_t *stats);
+
+#endif // BATCH_URING_H_
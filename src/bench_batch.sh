@@ -0,0 +1,34 @@
+#!/bin/sh
+# bench_batch.sh -- module_m -s scaling over worker threads
+#
+# usage: bench_batch.sh [module_m] [names file] [names count]
+# Generates the names file if it does not exist, then prints the best of
+# three runs for 1 to 32 threads, writing greetings to /dev/null.
+set -e
+
+MODULE_M=${1:-build/module_m}
+NAMES=${2:-/tmp/module_m_names.txt}
+COUNT=${3:-20000000}
+
+if [ ! -f "$NAMES" ]; then
+    echo "generating $COUNT names into $NAMES" >&2
+    awk -v n="$COUNT" 'BEGIN {
+        split("Alice Bob Clarice Dave Eve Zoltán Ágnes Joe Siri Leo", first, " ")
+        split("Smith Nagy Kovács Black White Müller Rossi Dubois", last, " ")
+        srand(42)
+        for(i = 0; i < n; ++i) {
+            printf "%s %s %d\n", first[int(rand() * 10) + 1], last[int(rand() * 8) + 1], i
+        }
+    }' > "$NAMES"
+fi
+
+printf "%-8s %10s %10s %8s\n" threads seconds "GB/s out" speedup
+base=
+for j in 1 2 4 8 16 32; do
+    # summary: "module_m: engine, N names, I bytes in, O bytes out, S s, R GB/s out"
+    best=$(for run in 1 2 3; do
+        "$MODULE_M" -s -j "$j" "$NAMES" 2>&1 >/dev/null | tail -n 1 | awk '{ print $11, $8 }'
+    done | sort -n | head -n 1)
+    base=${base:-${best% *}}
+    echo "$j $best $base" | awk '{ printf "%-8d %10.3f %10.2f %7.2fx\n", $1, $2, $3 / $2 / 1e9, $4 / $2 }'
+done
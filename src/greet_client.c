@@ -0,0 +1,134 @@
+// greet_client.c
+#include "greet_client.h"
+#include "greet_proto.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define BUFFER_SIZE 65536
+
+struct greet_client_t
+{
+    int fd;
+    char out[BUFFER_SIZE];
+    size_t outLen;
+    char in[BUFFER_SIZE];
+    size_t inOff, inLen;
+    char greeting[BUFFER_SIZE]; // the last response, NUL-terminated
+};
+
+static greet_client_t *clientConnect(int domain, const struct sockaddr *addr, socklen_t len)
+{
+    greet_client_t *self = malloc(sizeof(greet_client_t));
+    if( ! self) { return NULL; }
+    self->outLen = self->inOff = self->inLen = 0;
+    self->fd = socket(domain, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(self->fd < 0 || connect(self->fd, addr, len)) {
+        if(self->fd >= 0) { close(self->fd); }
+        free(self);
+        return NULL;
+    }
+    if(domain == AF_INET) {
+        int one = 1;
+        setsockopt(self->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return self;
+}
+
+greet_client_t *greetClientConnect(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if( ! path || strlen(path) >= sizeof(addr.sun_path)) { return NULL; }
+    strcpy(addr.sun_path, path);
+    return clientConnect(AF_UNIX, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+greet_client_t *greetClientConnectTcp(const char *host, int port)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    if( ! host || inet_pton(AF_INET, host, &addr.sin_addr) != 1) { return NULL; }
+    return clientConnect(AF_INET, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+void greetClientClose(greet_client_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    close((*self)->fd);
+    free(*self);
+    *self = NULL;
+}
+
+int greetClientFlush(greet_client_t *self)
+{
+    size_t off = 0;
+    while(off < self->outLen) {
+        ssize_t n = send(self->fd, self->out + off, self->outLen - off, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0) { return -1; }
+        off += n;
+    }
+    self->outLen = 0;
+    return 0;
+}
+
+int greetClientSend(greet_client_t *self, const char *name)
+{
+    size_t len = name ? strlen(name) : 0;
+    if(len > GREET_PROTO_MAX_NAME) { return -1; }
+    if(self->outLen + GREET_PROTO_HEADER + len > sizeof(self->out) && greetClientFlush(self)) {
+        return -1;
+    }
+    greetProtoPutU32(self->out + self->outLen, len);
+    memcpy(self->out + self->outLen + GREET_PROTO_HEADER, name, len);
+    self->outLen += GREET_PROTO_HEADER + len;
+    return 0;
+}
+
+// makes at least need bytes of input available
+static int fill(greet_client_t *self, size_t need)
+{
+    if(self->inOff + need > sizeof(self->in)) {
+        memmove(self->in, self->in + self->inOff, self->inLen - self->inOff);
+        self->inLen -= self->inOff;
+        self->inOff = 0;
+    }
+    while(self->inLen - self->inOff < need) {
+        ssize_t n = recv(self->fd, self->in + self->inLen, sizeof(self->in) - self->inLen, 0);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n <= 0) { return -1; }
+        self->inLen += n;
+    }
+    return 0;
+}
+
+int greetClientRecv(greet_client_t *self, const char **greeting)
+{
+    if(fill(self, GREET_PROTO_HEADER)) { return -1; }
+    uint32_t len = greetProtoGetU32(self->in + self->inOff);
+    if(len < 1 || len > sizeof(self->greeting) || fill(self, GREET_PROTO_HEADER + len)) { return -1; }
+    const char *p = self->in + self->inOff + GREET_PROTO_HEADER;
+    memcpy(self->greeting, p + 1, len - 1);
+    self->greeting[len - 1] = '\0';
+    self->inOff += GREET_PROTO_HEADER + len;
+    *greeting = self->greeting;
+    return (unsigned char)p[0];
+}
+
+const char *greetClientGreet(greet_client_t *self, const char *name)
+{
+    const char *greeting;
+    if( ! self || greetClientSend(self, name) || greetClientFlush(self)) { return NULL; }
+    switch(greetClientRecv(self, &greeting)) {
+        case GREET_OK: return greeting;
+        case GREET_OVERLOADED: errno = EAGAIN; return NULL;
+        default: return NULL;
+    }
+}
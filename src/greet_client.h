@@ -0,0 +1,26 @@
+// greet_client.h
+#ifndef GREET_CLIENT_H_
+#define GREET_CLIENT_H_
+
+#include <stddef.h>
+
+typedef struct greet_client_t greet_client_t;
+
+greet_client_t *greetClientConnect(const char *path);
+// Connects to a per-core greeterd on IPv4 host:port.
+greet_client_t *greetClientConnectTcp(const char *host, int port);
+void greetClientClose(greet_client_t **self);
+
+// Asks greeterd to greet name, like greeterGreet(). The result lives until
+// the next call; NULL on an I/O or server error, with errno EAGAIN if the
+// server shed the request as overloaded.
+const char *greetClientGreet(greet_client_t *self, const char *name);
+
+// Pipelining: queue any number of requests, flush, then receive the
+// responses in order. greetClientRecv() returns the greet_status_t and
+// sets *greeting as greetClientGreet() does, or returns -1.
+int greetClientSend(greet_client_t *self, const char *name);
+int greetClientFlush(greet_client_t *self);
+int greetClientRecv(greet_client_t *self, const char **greeting);
+
+#endif // GREET_CLIENT_H_
@@ -0,0 +1,244 @@
+// greet_handoff.c
+#define _GNU_SOURCE // accept4, memfd_create
+#include "greet_handoff.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+struct greet_handoff_t
+{
+    char *path;
+    int listenFd;
+    int bound;  // the socket file is ours to unlink
+    int stopFd;
+};
+
+// the payload of the one message a successor receives; the listeners are
+// followed by the snapshot memfd, if any, in its SCM_RIGHTS
+typedef struct handoff_message_t
+{
+    uint32_t listeners;
+    uint32_t snapshot;
+
+} handoff_message_t;
+
+typedef union handoff_control_t
+{
+    struct cmsghdr align;
+    char buf[CMSG_SPACE((GREET_HANDOFF_MAX_FDS + 1) * sizeof(int))];
+
+} handoff_control_t;
+
+greet_handoff_t *greetHandoffCreate(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if( ! path || strlen(path) >= sizeof(addr.sun_path)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+
+    greet_handoff_t *self = calloc(1, sizeof(greet_handoff_t));
+    if( ! self) { return NULL; }
+    self->path = strdup(path);
+    self->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    self->bound = self->listenFd >= 0 && ! bind(self->listenFd, (struct sockaddr *)&addr, sizeof(addr));
+    if( ! self->path || self->stopFd < 0 || ! self->bound || listen(self->listenFd, 1)) {
+        int err = errno;
+        greetHandoffDestroy(&self);
+        errno = err;
+        return NULL;
+    }
+    return self;
+}
+
+// has the snapshot written straight to a memfd
+static int snapshotCreate(greet_handoff_snapshot_fn *snapshot, void *arg)
+{
+    int mem = memfd_create("greet_handoff", MFD_CLOEXEC);
+    if(mem < 0) { return -1; }
+    void *buf = MAP_FAILED;
+    if( ! ftruncate(mem, GREET_HANDOFF_MAX_SNAPSHOT)) {
+        buf = mmap(NULL, GREET_HANDOFF_MAX_SNAPSHOT, PROT_READ | PROT_WRITE, MAP_SHARED, mem, 0);
+    }
+    if(buf == MAP_FAILED) {
+        close(mem);
+        return -1;
+    }
+    size_t len = snapshot(arg, buf);
+    munmap(buf, GREET_HANDOFF_MAX_SNAPSHOT);
+    if(len > GREET_HANDOFF_MAX_SNAPSHOT || ftruncate(mem, len)) {
+        close(mem);
+        return -1;
+    }
+    return mem;
+}
+
+// passes the listeners and a memfd holding the snapshot over conn
+static int handoffSend(int conn, const int *fds, int n, greet_handoff_snapshot_fn *snapshot, void *arg)
+{
+    int mem = -1;
+    if(snapshot && (mem = snapshotCreate(snapshot, arg)) < 0) { return -1; }
+    handoff_message_t m = { .listeners = n, .snapshot = mem >= 0 };
+    int count = n + (mem >= 0);
+    struct iovec iov = { &m, sizeof(m) };
+    handoff_control_t control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = CMSG_SPACE(count * sizeof(int)) };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, n * sizeof(int));
+    if(mem >= 0) { memcpy(CMSG_DATA(cmsg) + n * sizeof(int), &mem, sizeof(int)); }
+    ssize_t sent = sendmsg(conn, &msg, MSG_NOSIGNAL);
+    if(mem >= 0) { close(mem); }
+    return sent == sizeof(m) ? 0 : -1;
+}
+
+int greetHandoffAccept(greet_handoff_t *self, const int *fds, int n, greet_handoff_snapshot_fn *snapshot, void *arg)
+{
+    if(n < 1 || n > GREET_HANDOFF_MAX_FDS) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct pollfd pfds[2] = { { self->listenFd, POLLIN, 0 }, { self->stopFd, POLLIN, 0 } };
+    while(1) {
+        pfds[0].fd = self->listenFd;
+        if(poll(pfds, 2, -1) < 0) {
+            if(errno == EINTR) { continue; }
+            return -1;
+        }
+        if(pfds[1].revents) { return 1; }
+        int conn = accept4(self->listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if(conn < 0 || handoffSend(conn, fds, n, snapshot, arg)) {
+            if(conn >= 0) { close(conn); }
+            continue;
+        }
+        // wait for the successor to serve the listeners, or to give up
+        pfds[0].fd = conn;
+        char ack = 0;
+        ssize_t r = 0;
+        while(1) {
+            if(poll(pfds, 2, -1) < 0 && errno != EINTR) { break; }
+            if(pfds[1].revents) {
+                close(conn);
+                return 1;
+            }
+            if(pfds[0].revents) {
+                r = read(conn, &ack, 1);
+                if(r >= 0 || errno != EINTR) { break; }
+            }
+        }
+        close(conn);
+        if(r == 1) {
+            self->bound = 0;
+            return 0;
+        }
+    }
+}
+
+void greetHandoffStop(greet_handoff_t *self)
+{
+    uint64_t one = 1;
+    ssize_t n = write(self->stopFd, &one, sizeof(one));
+    (void)n;
+}
+
+void greetHandoffDestroy(greet_handoff_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    if((*self)->listenFd >= 0) { close((*self)->listenFd); }
+    if((*self)->bound) { unlink((*self)->path); }
+    if((*self)->stopFd >= 0) { close((*self)->stopFd); }
+    free((*self)->path);
+    free(*self);
+    *self = NULL;
+}
+
+// reads up to *len bytes of the snapshot in mem
+static int snapshotRead(int mem, void *snapshot, size_t *len)
+{
+    struct stat st;
+    if(fstat(mem, &st)) { return -1; }
+    size_t size = (size_t)st.st_size < *len ? (size_t)st.st_size : *len;
+    char *p = snapshot;
+    for(size_t off = 0; off < size; ) {
+        ssize_t r = pread(mem, p + off, size - off, off);
+        if(r <= 0) { return -1; }
+        off += r;
+    }
+    *len = size;
+    return 0;
+}
+
+int greetHandoffReceive(const char *path, int *fds, int *n, void *snapshot, size_t *len)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if( ! path || strlen(path) >= sizeof(addr.sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int conn = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(conn < 0) { return -1; }
+    if(connect(conn, (struct sockaddr *)&addr, sizeof(addr))) {
+        int err = errno;
+        close(conn);
+        errno = err;
+        return -1;
+    }
+
+    handoff_message_t m = { 0 };
+    struct iovec iov = { &m, sizeof(m) };
+    handoff_control_t control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+    ssize_t r;
+    while((r = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+    struct cmsghdr *cmsg = r == sizeof(m) ? CMSG_FIRSTHDR(&msg) : NULL;
+    int received[GREET_HANDOFF_MAX_FDS + 1], count = 0;
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(received, CMSG_DATA(cmsg), count * sizeof(int));
+    }
+    int err = r < 0 ? errno : EPROTO;
+    size_t size = 0;
+    int ok = m.listeners > 0 && m.listeners <= (uint32_t)*n && m.snapshot <= 1
+          && count == (int)(m.listeners + m.snapshot) && ! (msg.msg_flags & MSG_CTRUNC);
+    if(ok && m.snapshot) {
+        size = *len;
+        ok = ! snapshotRead(received[m.listeners], snapshot, &size);
+        err = errno;
+    }
+    if(ok && m.snapshot) { close(received[m.listeners]); }
+    if( ! ok) {
+        for(int i = 0; i < count; ++i) { close(received[i]); }
+        close(conn);
+        errno = err;
+        return -1;
+    }
+    memcpy(fds, received, m.listeners * sizeof(int));
+    *n = m.listeners;
+    *len = size;
+    return conn;
+}
+
+int greetHandoffCommit(int conn)
+{
+    char ack = 1;
+    ssize_t w = send(conn, &ack, 1, MSG_NOSIGNAL);
+    close(conn);
+    return w == 1 ? 0 : -1;
+}
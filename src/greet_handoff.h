@@ -0,0 +1,45 @@
+// greet_handoff.h
+// Zero-downtime restart: a running server hands its listening sockets to
+// a successor over SCM_RIGHTS on a control Unix socket, along with an
+// opaque snapshot of warm state in a memfd. The kernel keeps queueing
+// connections on the listeners throughout, so none are refused:
+//   successor                          predecessor
+//   greetHandoffReceive()  ----------> greetHandoffAccept() sends fds
+//   greetServerCreate() on the fds
+//   greetHandoffCommit()   ----------> returns 0: greetServerDrain()
+// If the successor goes away before committing, the predecessor keeps
+// serving and waits for the next one.
+#ifndef GREET_HANDOFF_H_
+#define GREET_HANDOFF_H_
+
+#include <stddef.h>
+
+#define GREET_HANDOFF_MAX_FDS 256
+#define GREET_HANDOFF_MAX_SNAPSHOT (1 << 20)
+
+typedef struct greet_handoff_t greet_handoff_t;
+
+// Writes the snapshot, taken at the time of the handoff, to buf of
+// GREET_HANDOFF_MAX_SNAPSHOT bytes, mapped from the memfd passed along;
+// returns its length.
+typedef size_t greet_handoff_snapshot_fn(void *arg, void *buf);
+
+// Listens for successors on the control socket path. NULL with errno set.
+greet_handoff_t *greetHandoffCreate(const char *path);
+// Waits for a successor and hands it the n listeners in fds and what
+// snapshot, if not NULL, writes. Returns 0 once it has taken over, after
+// which the control socket path is left to it, 1 if stopped, -1 on failure.
+int greetHandoffAccept(greet_handoff_t *self, const int *fds, int n, greet_handoff_snapshot_fn *snapshot, void *arg);
+// Makes greetHandoffAccept() return; safe from other threads and signal handlers.
+void greetHandoffStop(greet_handoff_t *self);
+void greetHandoffDestroy(greet_handoff_t **self);
+
+// Takes over from the server listening for successors on path: stores up
+// to *n listeners to fds and up to *len bytes of snapshot to snapshot,
+// updating both counts. Returns the connection to pass to
+// greetHandoffCommit() once the listeners are served, or -1 with errno set.
+int greetHandoffReceive(const char *path, int *fds, int *n, void *snapshot, size_t *len);
+// Tells the predecessor to drain, and closes conn. 0 or -1.
+int greetHandoffCommit(int conn);
+
+#endif // GREET_HANDOFF_H_
@@ -0,0 +1,149 @@
+// greet_http.c
+#include "greet_http.h"
+#include <string.h>
+#include <strings.h>
+
+// headers that do not change between responses, status line and all
+#define HEADERS(status, extra) { "HTTP/1.1 " status "\r\nServer: greeterd\r\n" extra \
+    "Content-Type: text/plain; charset=utf-8\r\nContent-Length: ", \
+    sizeof("HTTP/1.1 " status "\r\nServer: greeterd\r\n" extra \
+           "Content-Type: text/plain; charset=utf-8\r\nContent-Length: ") - 1 }
+static const struct { const char *text; size_t len; } statusHeaders[] = {
+    [GREET_HTTP_OK] = HEADERS("200 OK", ""),
+    [GREET_HTTP_BAD_REQUEST] = HEADERS("400 Bad Request", ""),
+    [GREET_HTTP_NOT_FOUND] = HEADERS("404 Not Found", ""),
+    [GREET_HTTP_METHOD_NOT_ALLOWED] = HEADERS("405 Method Not Allowed", "Allow: GET\r\n"),
+    [GREET_HTTP_SERVICE_UNAVAILABLE] = HEADERS("503 Service Unavailable", "Retry-After: 1\r\n"),
+};
+#define KEEP_ALIVE_END "\r\n\r\n"
+#define CLOSE_END "\r\nConnection: close\r\n\r\n"
+
+static int headerIs(const char *line, size_t len, const char *name, const char **value, size_t *valueLen)
+{
+    size_t n = strlen(name);
+    if(len <= n || line[n] != ':' || strncasecmp(line, name, n)) { return 0; }
+    const char *v = line + n + 1, *end = line + len;
+    while(v < end && (*v == ' ' || *v == '\t')) { ++v; }
+    while(end > v && (end[-1] == ' ' || end[-1] == '\t')) { --end; }
+    *value = v;
+    *valueLen = end - v;
+    return 1;
+}
+
+static int tokenIs(const char *value, size_t len, const char *token)
+{
+    return len == strlen(token) && ! strncasecmp(value, token, len);
+}
+
+int greetHttpParse(greet_http_parser_t *p, const char *buf, size_t len, greet_http_request_t *req)
+{
+    // find the blank line ending the head, from where the last call stopped
+    size_t from = p->scanned, end = 0;
+    for(size_t i = from; i + 3 < len; ++i) {
+        const char *cr = memchr(buf + i, '\r', len - 3 - i);
+        if( ! cr) { break; }
+        i = cr - buf;
+        if( ! memcmp(cr, "\r\n\r\n", 4)) {
+            end = i + 4;
+            break;
+        }
+    }
+    if( ! end) {
+        p->scanned = len > 3 ? len - 3 : 0;
+        return len > GREET_HTTP_MAX_HEAD ? GREET_HTTP_MALFORMED : GREET_HTTP_INCOMPLETE;
+    }
+    p->scanned = 0;
+    if(end > GREET_HTTP_MAX_HEAD) { return GREET_HTTP_MALFORMED; }
+
+    // request line: method SP target SP HTTP/1.x CRLF
+    const char *line = buf, *eol = memchr(buf, '\r', end);
+    const char *sp1 = memchr(line, ' ', eol - line);
+    const char *sp2 = sp1 ? memchr(sp1 + 1, ' ', eol - sp1 - 1) : NULL;
+    if( ! sp2 || sp1 == line || sp2 == sp1 + 1 || eol - sp2 - 1 != 8 || memcmp(sp2 + 1, "HTTP/1.", 7)) {
+        return GREET_HTTP_MALFORMED;
+    }
+    char minor = sp2[8];
+    if(minor != '0' && minor != '1') { return GREET_HTTP_MALFORMED; }
+    req->method = line;
+    req->methodLen = sp1 - line;
+    req->path = sp1 + 1;
+    const char *q = memchr(req->path, '?', sp2 - req->path);
+    req->pathLen = (q ? q : sp2) - req->path;
+    req->query = q ? q + 1 : sp2;
+    req->queryLen = sp2 - req->query;
+    req->keepAlive = minor == '1';
+    req->length = end;
+
+    // headers: only those deciding the connection's fate are looked at
+    for(line = eol + 2; line < buf + end - 2; line = eol + 2) {
+        eol = memchr(line, '\r', buf + end - line);
+        if(eol[1] != '\n') { return GREET_HTTP_MALFORMED; }
+        const char *value;
+        size_t valueLen, lineLen = eol - line;
+        if(headerIs(line, lineLen, "Connection", &value, &valueLen)) {
+            if(tokenIs(value, valueLen, "close")) { req->keepAlive = 0; }
+            if(tokenIs(value, valueLen, "keep-alive")) { req->keepAlive = 1; }
+        }
+        else if(headerIs(line, lineLen, "Content-Length", &value, &valueLen)) {
+            if( ! tokenIs(value, valueLen, "0")) { return GREET_HTTP_MALFORMED; } // no bodies here
+        }
+        else if(headerIs(line, lineLen, "Transfer-Encoding", &value, &valueLen)) {
+            return GREET_HTTP_MALFORMED;
+        }
+    }
+    return 1;
+}
+
+static int hexValue(char c)
+{
+    if(c >= '0' && c <= '9') { return c - '0'; }
+    if(c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if(c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+int greetHttpQueryParam(const char *query, size_t len, const char *key, char *out, size_t cap)
+{
+    size_t keyLen = strlen(key);
+    const char *p = query, *end = query + len;
+    while(p < end) {
+        const char *amp = memchr(p, '&', end - p);
+        const char *next = amp ? amp : end;
+        if((size_t)(next - p) > keyLen && p[keyLen] == '=' && ! memcmp(p, key, keyLen)) {
+            size_t n = 0;
+            for(p += keyLen + 1; p < next; ++p, ++n) {
+                if(n + 1 >= cap) { return -2; }
+                if(*p == '%') {
+                    int hi = next - p > 2 ? hexValue(p[1]) : -1, lo = hi >= 0 ? hexValue(p[2]) : -1;
+                    if(lo < 0) { return -2; }
+                    out[n] = (char)(hi << 4 | lo);
+                    p += 2;
+                }
+                else {
+                    out[n] = *p == '+' ? ' ' : *p;
+                }
+            }
+            out[n] = '\0';
+            return (int)n;
+        }
+        p = next + 1;
+    }
+    return -1;
+}
+
+size_t greetHttpResponse(greet_http_status_t status, int keepAlive,
+                         const char *body, size_t len, char *out, size_t cap)
+{
+    char digits[20];
+    size_t nd = 0;
+    for(size_t v = len; nd == 0 || v; v /= 10) { digits[sizeof(digits) - ++nd] = '0' + v % 10; }
+    const char *tail = keepAlive ? KEEP_ALIVE_END : CLOSE_END;
+    size_t tailLen = keepAlive ? sizeof(KEEP_ALIVE_END) - 1 : sizeof(CLOSE_END) - 1;
+    size_t headLen = statusHeaders[status].len, total = headLen + nd + tailLen + len;
+    if(total > cap) { return total; }
+    memcpy(out, statusHeaders[status].text, headLen);
+    memcpy(out + headLen, digits + sizeof(digits) - nd, nd);
+    memcpy(out + headLen + nd, tail, tailLen);
+    memcpy(out + headLen + nd + tailLen, body, len);
+    return total;
+}
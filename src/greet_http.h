@@ -0,0 +1,60 @@
+// greet_http.h
+// Just enough HTTP/1.1 for GET /greet?name=...: an incremental parser that
+// points into the caller's buffer instead of copying, and responses built
+// from preformatted header blocks.
+#ifndef GREET_HTTP_H_
+#define GREET_HTTP_H_
+
+#include <stddef.h>
+
+#define GREET_HTTP_MAX_HEAD 8192 // longer request heads are rejected
+
+typedef struct greet_http_request_t
+{
+    // slices of the parsed buffer, valid as long as it is
+    const char *method;
+    size_t methodLen;
+    const char *path;   // without the query
+    size_t pathLen;
+    const char *query;  // after '?', if any
+    size_t queryLen;
+    int keepAlive;      // the connection may carry further requests
+    size_t length;      // bytes of the request, head and all
+
+} greet_http_request_t;
+
+typedef struct greet_http_parser_t
+{
+    size_t scanned; // bytes known not to end the head, so not scanned twice
+
+} greet_http_parser_t;
+
+enum { GREET_HTTP_INCOMPLETE = 0, GREET_HTTP_MALFORMED = -1 };
+
+// Parses the request at the start of buf, of which len bytes have arrived.
+// Returns 1 with req filled in, GREET_HTTP_INCOMPLETE to be called again
+// with more bytes, or GREET_HTTP_MALFORMED. The parser is reset by a
+// complete request.
+int greetHttpParse(greet_http_parser_t *p, const char *buf, size_t len, greet_http_request_t *req);
+
+// Percent-decodes the value of key in a query into out, NUL-terminated.
+// Returns its length, -1 if key is missing, or -2 if the value is
+// malformed or longer than cap - 1.
+int greetHttpQueryParam(const char *query, size_t len, const char *key, char *out, size_t cap);
+
+typedef enum greet_http_status_t
+{
+    GREET_HTTP_OK,
+    GREET_HTTP_BAD_REQUEST,
+    GREET_HTTP_NOT_FOUND,
+    GREET_HTTP_METHOD_NOT_ALLOWED,
+    GREET_HTTP_SERVICE_UNAVAILABLE, // overloaded
+
+} greet_http_status_t;
+
+// Writes a text/plain response of body to out. Returns its length, or the
+// length it needs when over cap, in which case nothing is written.
+size_t greetHttpResponse(greet_http_status_t status, int keepAlive,
+                         const char *body, size_t len, char *out, size_t cap);
+
+#endif // GREET_HTTP_H_
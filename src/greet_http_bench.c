@@ -0,0 +1,183 @@
+// greet_http_bench.c
+// Loopback benchmark of the HTTP endpoint: keeps a GET /greet in flight on
+// each of 1, 64 and 1024 keep-alive connections from one epoll loop, and
+// reports requests per second and latency percentiles. Serves from the
+// same process in per-core mode unless pointed at a running greeterd.
+#define _GNU_SOURCE // memmem
+#include "greet_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+static const char request[] = "GET /greet?name=bench HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+typedef struct
+{
+    int fd;
+    uint64_t sent; // ns, of the request in flight
+    char in[512];
+    size_t inLen;
+
+} client_t;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void *serverRun(void *arg)
+{
+    greetServerRun(arg);
+    return NULL;
+}
+
+static int byValue(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// the length of the complete response at the start of in, 0 if incomplete
+static size_t responseLength(const char *in, size_t len)
+{
+    const char *end = memmem(in, len, "\r\n\r\n", 4);
+    const char *cl = end ? memmem(in, end - in, "Content-Length: ", 16) : NULL;
+    if( ! cl) { return 0; }
+    size_t total = end + 4 - in + strtoul(cl + 16, NULL, 10);
+    return total <= len ? total : 0;
+}
+
+static int sendRequest(client_t *c)
+{
+    c->sent = nowNs();
+    return send(c->fd, request, sizeof(request) - 1, MSG_NOSIGNAL) == sizeof(request) - 1 ? 0 : -1;
+}
+
+// runs the connections for the given time; returns 0 or -1
+static int run(const struct sockaddr_in *addr, int connections, double seconds)
+{
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    client_t *clients = calloc(connections, sizeof(client_t));
+    size_t cap = 1 << 20, count = 0;
+    uint64_t *latencies = malloc(cap * sizeof(uint64_t));
+    if(epoll < 0 || ! clients || ! latencies) { return -1; }
+    int rc = 0;
+    for(int i = 0; i < connections && ! rc; ++i) {
+        client_t *c = &clients[i];
+        int one = 1;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        c->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        rc = c->fd < 0 || connect(c->fd, (const struct sockaddr *)addr, sizeof(*addr))
+          || setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one))
+          || epoll_ctl(epoll, EPOLL_CTL_ADD, c->fd, &ev) ? -1 : 0;
+    }
+    uint64_t start = nowNs(), end = start + (uint64_t)(seconds * 1e9);
+    for(int i = 0; i < connections && ! rc; ++i) { rc = sendRequest(&clients[i]); }
+
+    struct epoll_event events[256];
+    while( ! rc && nowNs() < end) {
+        int n = epoll_wait(epoll, events, 256, 100);
+        if(n < 0 && errno != EINTR) { rc = -1; }
+        for(int i = 0; i < n && ! rc; ++i) {
+            client_t *c = events[i].data.ptr;
+            ssize_t r = recv(c->fd, c->in + c->inLen, sizeof(c->in) - c->inLen, 0);
+            if(r <= 0) {
+                rc = r < 0 && errno == EAGAIN ? 0 : -1;
+                continue;
+            }
+            c->inLen += r;
+            size_t len = responseLength(c->in, c->inLen);
+            if( ! len) { continue; }
+            if(memcmp(c->in, "HTTP/1.1 200 ", 13)) { rc = -1; }
+            if(count == cap) {
+                uint64_t *p = realloc(latencies, (cap *= 2) * sizeof(uint64_t));
+                if( ! p) { rc = -1; break; }
+                latencies = p;
+            }
+            latencies[count++] = nowNs() - c->sent;
+            memmove(c->in, c->in + len, c->inLen - len);
+            c->inLen -= len;
+            if( ! rc) { rc = sendRequest(c); }
+        }
+    }
+    double elapsed = (nowNs() - start) / 1e9;
+    if( ! rc && count) {
+        qsort(latencies, count, sizeof(uint64_t), byValue);
+        printf("%5d connections: %9.0f requests/s, latency us p50 %7.1f p99 %7.1f p999 %7.1f\n",
+               connections, count / elapsed, latencies[count / 2] / 1000.0,
+               latencies[count * 99 / 100] / 1000.0, latencies[count * 999 / 1000] / 1000.0);
+    }
+    for(int i = 0; i < connections; ++i) {
+        if(clients[i].fd > 0) { close(clients[i].fd); }
+    }
+    close(epoll);
+    free(clients);
+    free(latencies);
+    return rc || ! count ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int counts[] = { 1, 64, 1024 };
+    const char *host = "127.0.0.1";
+    int port = 0, only = 0, threads = 0, c;
+    double seconds = 2;
+    while((c = getopt(argc, argv, "H:P:c:t:d:h")) != -1) {
+        switch(c) {
+            case 'H': host = optarg; break;
+            case 'P': port = atoi(optarg); break;
+            case 'c': only = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-H host -P port of a greeterd -w] [-c connections]"
+                                " [-t server threads] [-d seconds]\n", argv[0]);
+                return c == 'h' ? 0 : 2;
+        }
+    }
+    // 1024 connections take twice as many descriptors when served in-process
+    struct rlimit nofile;
+    if( ! getrlimit(RLIMIT_NOFILE, &nofile)) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+
+    greet_server_t *server = NULL;
+    pthread_t thread;
+    if( ! port) {
+        greet_server_options_t opt = { .greeting = "Hello", .host = host, .http = 1,
+                                       .threads = threads ? threads : sysconf(_SC_NPROCESSORS_ONLN) };
+        if( ! (server = greetServerCreate(&opt))) {
+            perror("greetServerCreate");
+            return 1;
+        }
+        port = greetServerPort(server);
+        pthread_create(&thread, NULL, serverRun, server);
+    }
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int rc = inet_pton(AF_INET, host, &addr.sin_addr) == 1 ? 0 : -1;
+    for(size_t i = 0; i < sizeof(counts) / sizeof(counts[0]) && ! rc; ++i) {
+        if(only && counts[i] != only) { continue; }
+        rc = run(&addr, counts[i], seconds);
+    }
+    if(only && only != 1 && only != 64 && only != 1024 && ! rc) { rc = run(&addr, only, seconds); }
+    if(server) {
+        greetServerStop(server);
+        pthread_join(thread, NULL);
+        greetServerDestroy(&server);
+    }
+    if(rc) { fprintf(stderr, "greet_http_bench: requests failed\n"); }
+    return rc ? 1 : 0;
+}
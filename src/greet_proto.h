@@ -0,0 +1,36 @@
+// greet_proto.h
+// Length-prefixed greeting protocol of greeterd, pipelining allowed:
+//   request:  u32 length | name             (empty name greets the World)
+//   response: u32 length | u8 status | greeting
+// Lengths are big-endian and count the bytes that follow them.
+#ifndef GREET_PROTO_H_
+#define GREET_PROTO_H_
+
+#include <stdint.h>
+
+#define GREET_PROTO_MAX_NAME 4096
+#define GREET_PROTO_HEADER 4
+
+typedef enum greet_status_t
+{
+    GREET_OK = 0,
+    GREET_ERROR = 1, // the request could not be served
+    GREET_OVERLOADED = 2, // shed by admission control; worth retrying later
+
+} greet_status_t;
+
+static inline void greetProtoPutU32(char *p, uint32_t v)
+{
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+static inline uint32_t greetProtoGetU32(const char *p)
+{
+    const unsigned char *u = (const unsigned char *)p;
+    return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+#endif // GREET_PROTO_H_
@@ -0,0 +1,588 @@
+// greet_server.c
+#define _GNU_SOURCE // accept4, pthread_attr_setaffinity_np
+#include "greet_server.h"
+#include "greet_proto.h"
+#include "greet_http.h"
+#include "greeter.h"
+#include "logger.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_EVENTS 64
+#define READ_SIZE 16384
+#define MAX_PENDING_OUT (1 << 20) // stop reading a client that does not read
+#define LOG_BUFFER (64 << 10)      // per-core mode: log lines written out at once
+
+typedef struct conn_t
+{
+    struct conn_t *prev, *next;
+    int fd;
+    char *in;
+    size_t inLen, inCap;
+    char *out;
+    size_t outOff, outLen, outCap;
+    int reading; // EPOLLIN is on; off while out is over MAX_PENDING_OUT
+    int writing; // EPOLLOUT is on
+    int closing; // to be closed once out is sent; nothing more is read
+    uint64_t queuedAt; // with admission control: arrival of the oldest unserved bytes
+    // with admission control: where the responses of the admitted requests
+    // end in out; each is in flight until sent
+    size_t *admitted;
+    size_t admittedHead, admittedLen, admittedCap;
+    greet_http_parser_t parser;
+
+} conn_t;
+
+typedef struct
+{
+    greet_server_t *server;
+    greeter_t *greeter;
+    int epoll;
+    int listenFd;  // the shared Unix listener, or this thread's TCP one
+    conn_t *conns; // open connections, closed when stopped
+    int draining;  // not accepting; done once conns is empty
+    int spareFd;   // given up to refuse a connection when out of descriptors
+    // formatted here, with room for the longest name
+    char *greeting;
+    size_t greetingCap;
+    pthread_t thread;
+
+} io_thread_t;
+
+struct greet_server_t
+{
+    greet_server_options_t opt;
+    int listenFd;
+    int bound;  // the socket file is ours to unlink
+    int *portFds; // per-core mode: a SO_REUSEPORT listener per thread
+    int port;
+    int stopFd; // eventfd, readable once stopped
+    int drainFd; // eventfd, readable once draining
+    io_thread_t *threads;
+};
+
+static int reserve(char **buf, size_t *cap, size_t need)
+{
+    if(need <= *cap) { return 0; }
+    size_t n = *cap ? *cap : 4096;
+    while(n < need) { n *= 2; }
+    char *p = realloc(*buf, n);
+    if( ! p) { return -1; }
+    *buf = p;
+    *cap = n;
+    return 0;
+}
+
+// releases the admitted requests whose responses were sent, or all of them
+static void connRelease(io_thread_t *t, conn_t *c, int all)
+{
+    while(c->admittedHead < c->admittedLen && (all || c->admitted[c->admittedHead] <= c->outOff)) {
+        admissionRelease(t->server->opt.admission);
+        ++c->admittedHead;
+    }
+    if(c->admittedHead == c->admittedLen) { c->admittedHead = c->admittedLen = 0; }
+}
+
+static void connClose(io_thread_t *t, conn_t *c)
+{
+    connRelease(t, c, 1);
+    if(c->prev) { c->prev->next = c->next; } else { t->conns = c->next; }
+    if(c->next) { c->next->prev = c->prev; }
+    epoll_ctl(t->epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c->admitted);
+    free(c);
+}
+
+static int connWatch(io_thread_t *t, conn_t *c, int reading, int writing)
+{
+    if(c->reading == reading && c->writing == writing) { return 0; }
+    struct epoll_event ev = {
+        // a half-closed client stays EPOLLRDHUP: only while reading
+        .events = (reading ? EPOLLIN | EPOLLRDHUP : 0) | (writing ? EPOLLOUT : 0),
+        .data.ptr = c,
+    };
+    c->reading = reading;
+    c->writing = writing;
+    return epoll_ctl(t->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// GREET_OK for a request to be served, or GREET_OVERLOADED if admission
+// control sheds it. An admitted request stays in flight until out is sent
+// up to its response, so that pipelined requests count too: the limit
+// bounds the work taken on, not only the greeting being formatted.
+static int admit(io_thread_t *t, conn_t *c)
+{
+    admission_t *admission = t->server->opt.admission;
+    if( ! admission) { return GREET_OK; }
+    if(c->admittedLen == c->admittedCap) {
+        size_t cap = c->admittedCap ? 2 * c->admittedCap : 16;
+        size_t *p = realloc(c->admitted, cap * sizeof(size_t));
+        if( ! p) { return GREET_OVERLOADED; }
+        c->admitted = p;
+        c->admittedCap = cap;
+    }
+    if(admissionAcquire(admission, c->queuedAt, admissionNow()) != ADMISSION_ADMIT) { return GREET_OVERLOADED; }
+    c->admitted[c->admittedLen++] = SIZE_MAX; // until its response is in out
+    return GREET_OK;
+}
+
+// the response just appended to out is that of the request admitted last
+static void responded(conn_t *c)
+{
+    if(c->admittedLen && c->admitted[c->admittedLen - 1] == SIZE_MAX) { c->admitted[c->admittedLen - 1] = c->outLen; }
+}
+
+// drops the served requests from the input buffer
+static void connConsume(io_thread_t *t, conn_t *c, size_t served)
+{
+    memmove(c->in, c->in + served, c->inLen - served);
+    c->inLen -= served;
+    // what is left is only part of a request; it counts from now
+    if(c->inLen && served && t->server->opt.admission) { c->queuedAt = admissionNow(); }
+}
+
+// answers every complete request in the input buffer, in order
+static int connServeProto(io_thread_t *t, conn_t *c)
+{
+    size_t pos = 0;
+    char name[GREET_PROTO_MAX_NAME + 1];
+    while(c->inLen - pos >= GREET_PROTO_HEADER) {
+        uint32_t len = greetProtoGetU32(c->in + pos);
+        if(len > GREET_PROTO_MAX_NAME) { return -1; }
+        if(c->inLen - pos - GREET_PROTO_HEADER < len) { break; }
+        memcpy(name, c->in + pos + GREET_PROTO_HEADER, len);
+        name[len] = '\0';
+        pos += GREET_PROTO_HEADER + len;
+
+        size_t n = 0;
+        const char *greeting = "";
+        int status = admit(t, c);
+        if(status == GREET_OK) {
+            greeting = t->greeting;
+            n = greeterGreetTo(t->greeter, len ? name : NULL, len, t->greeting, t->greetingCap);
+        }
+        if(reserve(&c->out, &c->outCap, c->outLen + GREET_PROTO_HEADER + 1 + n)) { return -1; }
+        char *p = c->out + c->outLen;
+        greetProtoPutU32(p, 1 + n);
+        p[GREET_PROTO_HEADER] = status;
+        memcpy(p + GREET_PROTO_HEADER + 1, greeting, n);
+        c->outLen += GREET_PROTO_HEADER + 1 + n;
+        responded(c);
+    }
+    connConsume(t, c, pos);
+    return 0;
+}
+
+// the same for HTTP; a request the connection cannot survive closes it
+static int connServeHttp(io_thread_t *t, conn_t *c)
+{
+    size_t pos = 0;
+    char name[GREET_PROTO_MAX_NAME + 1];
+    while( ! c->closing && pos < c->inLen) {
+        greet_http_request_t req;
+        int rc = greetHttpParse(&c->parser, c->in + pos, c->inLen - pos, &req);
+        if(rc == GREET_HTTP_INCOMPLETE) { break; }
+
+        greet_http_status_t status = GREET_HTTP_BAD_REQUEST;
+        const char *body = "Bad Request\n";
+        size_t n = sizeof("Bad Request\n") - 1;
+        int keepAlive = 0, len;
+        if(rc != GREET_HTTP_MALFORMED) {
+            pos += req.length;
+            keepAlive = req.keepAlive;
+            if(req.pathLen != 6 || memcmp(req.path, "/greet", 6)) {
+                status = GREET_HTTP_NOT_FOUND;
+                body = "Not Found\n";
+                n = sizeof("Not Found\n") - 1;
+            }
+            else if(req.methodLen != 3 || memcmp(req.method, "GET", 3)) {
+                status = GREET_HTTP_METHOD_NOT_ALLOWED;
+                body = "Method Not Allowed\n";
+                n = sizeof("Method Not Allowed\n") - 1;
+            }
+            else if((len = greetHttpQueryParam(req.query, req.queryLen, "name", name, sizeof(name))) >= -1) {
+                if(admit(t, c) != GREET_OK) {
+                    status = GREET_HTTP_SERVICE_UNAVAILABLE;
+                    body = "Overloaded\n";
+                    n = sizeof("Overloaded\n") - 1;
+                }
+                else {
+                    status = GREET_HTTP_OK;
+                    body = t->greeting;
+                    n = greeterGreetTo(t->greeter, len > 0 ? name : NULL, len < 0 ? 0 : len, t->greeting, t->greetingCap);
+                }
+            }
+        }
+        size_t total = greetHttpResponse(status, keepAlive, body, n, NULL, 0);
+        if(reserve(&c->out, &c->outCap, c->outLen + total)) { return -1; }
+        c->outLen += greetHttpResponse(status, keepAlive, body, n, c->out + c->outLen, total);
+        responded(c);
+        c->closing = ! keepAlive;
+    }
+    connConsume(t, c, pos);
+    return 0;
+}
+
+static int connServe(io_thread_t *t, conn_t *c)
+{
+    return t->server->opt.http ? connServeHttp(t, c) : connServeProto(t, c);
+}
+
+static int connFlush(io_thread_t *t, conn_t *c)
+{
+    int rc = 0;
+    while(c->outOff < c->outLen) {
+        ssize_t n = send(c->fd, c->out + c->outOff, c->outLen - c->outOff, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { break; }
+        if(n < 0) {
+            rc = -1;
+            break;
+        }
+        c->outOff += n;
+    }
+    connRelease(t, c, 0);
+    if(c->outOff == c->outLen) { c->outOff = c->outLen = 0; }
+    return rc;
+}
+
+// 0 when there is nothing more to read for now, 1 once the client has
+// shut down its side, -1 on failure
+static int connRead(io_thread_t *t, conn_t *c)
+{
+    for(;;) {
+        if(reserve(&c->in, &c->inCap, c->inLen + READ_SIZE)) { return -1; }
+        ssize_t n = recv(c->fd, c->in + c->inLen, c->inCap - c->inLen, 0);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { return 0; }
+        if( ! n) { return 1; }
+        if(n < 0) { return -1; }
+        if( ! c->inLen && t->server->opt.admission) { c->queuedAt = admissionNow(); }
+        c->inLen += n;
+        if((size_t)n < READ_SIZE) { return 0; }
+    }
+}
+
+static void connEvent(io_thread_t *t, conn_t *c, uint32_t events)
+{
+    int rc = 0;
+    // not while out is backed up, nor once closing; an EPOLLHUP or
+    // EPOLLERR then comes regardless, and the flush fails
+    if(c->reading && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+        rc = connRead(t, c);
+        if(connServe(t, c)) { rc = -1; }
+        // answer what came before the shutdown, however long it takes
+        if(rc > 0) {
+            c->closing = 1;
+            rc = 0;
+        }
+    }
+    if(connFlush(t, c)) { rc = -1; }
+    size_t pending = c->outLen - c->outOff;
+    if(rc || (c->closing && ! pending)
+       || connWatch(t, c, ! c->closing && pending < MAX_PENDING_OUT, pending > 0)) {
+        connClose(t, c);
+    }
+}
+
+static void acceptAll(io_thread_t *t)
+{
+    for(;;) {
+        int fd = accept4(t->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0 && (errno == EINTR || errno == ECONNABORTED)) { continue; }
+        if(fd < 0 && (errno == EMFILE || errno == ENFILE) && t->spareFd >= 0) {
+            // left queued the connection would wake the loop again at
+            // once: free the spare descriptor to accept and refuse it
+            close(t->spareFd);
+            fd = accept(t->listenFd, NULL, NULL);
+            if(fd >= 0) { close(fd); }
+            t->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if(fd < 0) { return; } // none queued: at the limit accept4 fails regardless
+            continue;
+        }
+        if(fd < 0) { return; } // EAGAIN: another thread was faster, or none left
+        if(t->server->portFds) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        conn_t *c = calloc(1, sizeof(conn_t));
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = c };
+        if( ! c || epoll_ctl(t->epoll, EPOLL_CTL_ADD, fd, &ev)) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->reading = 1;
+        c->next = t->conns;
+        if(t->conns) { t->conns->prev = c; }
+        t->conns = c;
+    }
+}
+
+static void *ioThreadRun(void *arg)
+{
+    io_thread_t *t = arg;
+    struct epoll_event events[MAX_EVENTS];
+    // per-core: nothing shared on the hot path, not even the stderr lock
+    if(t->server->portFds) { loggerBufferStart(LOG_BUFFER); }
+    for(;;) {
+        int n = epoll_wait(t->epoll, events, MAX_EVENTS, -1);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n < 0) { break; }
+        for(int i = 0; i < n; ++i) {
+            void *ptr = events[i].data.ptr;
+            if(ptr == &t->server->stopFd) { goto stopped; }
+            if(ptr == &t->server->drainFd) {
+                epoll_ctl(t->epoll, EPOLL_CTL_DEL, t->listenFd, NULL);
+                epoll_ctl(t->epoll, EPOLL_CTL_DEL, t->server->drainFd, NULL);
+                t->draining = 1;
+            }
+            else if(ptr == &t->listenFd) { acceptAll(t); }
+            else { connEvent(t, ptr, events[i].events); }
+        }
+        loggerFlush();
+        if(t->draining && ! t->conns) { break; }
+    }
+stopped:
+    while(t->conns) { connClose(t, t->conns); }
+    loggerBufferStop();
+    return NULL;
+}
+
+// binds a listener per thread to the same address; the kernel spreads
+// incoming connections among them
+static int listenPerCore(greet_server_t *self)
+{
+    if(self->opt.listenFds) {
+        self->portFds = malloc(self->opt.listenFdCount * sizeof(int));
+        if( ! self->portFds) { return -1; }
+        memcpy(self->portFds, self->opt.listenFds, self->opt.listenFdCount * sizeof(int));
+        self->opt.threads = self->opt.listenFdCount;
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        if(getsockname(self->portFds[0], (struct sockaddr *)&addr, &len)) { return -1; }
+        self->port = ntohs(addr.sin_port);
+        return 0;
+    }
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(self->opt.port) };
+    if(inet_pton(AF_INET, self->opt.host, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    self->portFds = malloc(self->opt.threads * sizeof(int));
+    if( ! self->portFds) { return -1; }
+    for(int i = 0; i < self->opt.threads; ++i) { self->portFds[i] = -1; }
+    for(int i = 0; i < self->opt.threads; ++i) {
+        int fd = self->portFds[i] = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        socklen_t len = sizeof(addr);
+        if(fd < 0
+           || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))
+           || bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+           || listen(fd, SOMAXCONN)
+           || getsockname(fd, (struct sockaddr *)&addr, &len)) {
+            return -1;
+        }
+        self->port = ntohs(addr.sin_port); // the rest bind the port picked first
+    }
+    return 0;
+}
+
+// closes inherited listeners that will not be served
+static void closeListeners(const greet_server_options_t *opt)
+{
+    for(int i = 0; opt->listenFds && i < opt->listenFdCount; ++i) { close(opt->listenFds[i]); }
+}
+
+greet_server_t *greetServerCreate(const greet_server_options_t *opt)
+{
+    if(opt->listenFds && (opt->listenFdCount < 1 || ( ! opt->host && opt->listenFdCount != 1))) {
+        closeListeners(opt);
+        errno = EINVAL;
+        return NULL;
+    }
+    if(opt->host) {
+        greet_server_t *self = calloc(1, sizeof(greet_server_t));
+        if( ! self) {
+            closeListeners(opt);
+            return NULL;
+        }
+        self->opt = *opt;
+        if(self->opt.threads < 1) { self->opt.threads = 1; }
+        self->listenFd = -1;
+        self->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        self->drainFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(self->stopFd < 0 || self->drainFd < 0 || listenPerCore(self)) {
+            if( ! self->portFds) { closeListeners(opt); }
+            int err = errno;
+            greetServerDestroy(&self);
+            errno = err;
+            return NULL;
+        }
+        return self;
+    }
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if( ! opt->path || strlen(opt->path) >= sizeof(addr.sun_path)) {
+        closeListeners(opt);
+        errno = EINVAL;
+        return NULL;
+    }
+    strcpy(addr.sun_path, opt->path);
+
+    greet_server_t *self = calloc(1, sizeof(greet_server_t));
+    if( ! self) {
+        closeListeners(opt);
+        return NULL;
+    }
+    self->opt = *opt;
+    if(self->opt.threads < 1) { self->opt.threads = 1; }
+    self->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->drainFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int listening;
+    if(opt->listenFds) {
+        // the path stays the predecessor's until greetServerAdopt()
+        self->listenFd = opt->listenFds[0];
+        listening = 1;
+    }
+    else {
+        self->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        listening = self->bound = self->listenFd >= 0 && ! bind(self->listenFd, (struct sockaddr *)&addr, sizeof(addr))
+                               && ! listen(self->listenFd, SOMAXCONN);
+    }
+    if(self->stopFd < 0 || self->drainFd < 0 || ! listening) {
+        int err = errno;
+        greetServerDestroy(&self);
+        errno = err;
+        return NULL;
+    }
+    return self;
+}
+
+int greetServerPort(const greet_server_t *self)
+{
+    return self->port;
+}
+
+int greetServerRun(greet_server_t *self)
+{
+    int n = self->opt.threads, rc = 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    self->threads = calloc(n, sizeof(io_thread_t));
+    if( ! self->threads) { return -1; }
+    for(int i = 0; i < n; ++i) {
+        io_thread_t *t = &self->threads[i];
+        t->server = self;
+        t->greeter = greeterCreate(self->opt.greeting);
+        t->epoll = epoll_create1(EPOLL_CLOEXEC);
+        t->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if(t->greeter) {
+            t->greetingCap = greeterFormat(t->greeter, NULL, GREET_PROTO_MAX_NAME, NULL, 0) + 1;
+            t->greeting = malloc(t->greetingCap);
+        }
+        // Unix mode: every thread waits on the one listener, and
+        // EPOLLEXCLUSIVE wakes only one of them; per-core: each its own
+        t->listenFd = self->portFds ? self->portFds[i] : self->listenFd;
+        struct epoll_event listen = {
+            .events = EPOLLIN | (self->portFds ? 0 : EPOLLEXCLUSIVE),
+            .data.ptr = &t->listenFd,
+        };
+        struct epoll_event stop = { .events = EPOLLIN, .data.ptr = &self->stopFd };
+        struct epoll_event drain = { .events = EPOLLIN, .data.ptr = &self->drainFd };
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if(self->portFds && cpus > 0) {
+            cpu_set_t cpu;
+            CPU_ZERO(&cpu);
+            CPU_SET(i % cpus, &cpu);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpu), &cpu);
+        }
+        int failed = ! t->greeter || ! t->greeting || t->epoll < 0
+           || epoll_ctl(t->epoll, EPOLL_CTL_ADD, t->listenFd, &listen)
+           || epoll_ctl(t->epoll, EPOLL_CTL_ADD, self->stopFd, &stop)
+           || epoll_ctl(t->epoll, EPOLL_CTL_ADD, self->drainFd, &drain)
+           || pthread_create(&t->thread, &attr, ioThreadRun, t);
+        pthread_attr_destroy(&attr);
+        if(failed) {
+            greetServerStop(self);
+            rc = -1;
+            n = i;
+            if(t->epoll >= 0) { close(t->epoll); }
+            if(t->spareFd >= 0) { close(t->spareFd); }
+            greeterDestroy(&t->greeter);
+            free(t->greeting);
+            break;
+        }
+    }
+    for(int i = 0; i < n; ++i) {
+        io_thread_t *t = &self->threads[i];
+        pthread_join(t->thread, NULL);
+        close(t->epoll);
+        if(t->spareFd >= 0) { close(t->spareFd); }
+        greeterDestroy(&t->greeter);
+        free(t->greeting);
+    }
+    free(self->threads);
+    self->threads = NULL;
+    return rc;
+}
+
+void greetServerStop(greet_server_t *self)
+{
+    uint64_t one = 1;
+    ssize_t n = write(self->stopFd, &one, sizeof(one));
+    (void)n;
+}
+
+int greetServerListeners(const greet_server_t *self, int *fds, int cap)
+{
+    int n = self->portFds ? self->opt.threads : 1;
+    for(int i = 0; i < n && i < cap; ++i) { fds[i] = self->portFds ? self->portFds[i] : self->listenFd; }
+    return n;
+}
+
+void greetServerAdopt(greet_server_t *self)
+{
+    self->bound = ! self->opt.host;
+}
+
+void greetServerDrain(greet_server_t *self)
+{
+    self->bound = 0;
+    uint64_t one = 1;
+    ssize_t n = write(self->drainFd, &one, sizeof(one));
+    (void)n;
+}
+
+void greetServerDestroy(greet_server_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    if((*self)->listenFd >= 0) { close((*self)->listenFd); }
+    if((*self)->bound) { unlink((*self)->opt.path); }
+    for(int i = 0; (*self)->portFds && i < (*self)->opt.threads; ++i) {
+        if((*self)->portFds[i] >= 0) { close((*self)->portFds[i]); }
+    }
+    free((*self)->portFds);
+    if((*self)->stopFd >= 0) { close((*self)->stopFd); }
+    if((*self)->drainFd >= 0) { close((*self)->drainFd); }
+    free(*self);
+    *self = NULL;
+}
@@ -0,0 +1,52 @@
+// greet_server.h
+#ifndef GREET_SERVER_H_
+#define GREET_SERVER_H_
+
+#include "admission.h"
+
+typedef struct greet_server_t greet_server_t;
+
+typedef struct greet_server_options_t
+{
+    const char *path;     // Unix socket to listen on
+    const char *greeting;
+    int threads;          // I/O threads, each with an epoll loop and a greeter
+    // Per-core TCP mode instead of path when set: every thread is pinned to
+    // a CPU and accepts on its own SO_REUSEPORT socket bound to host:port,
+    // sharing nothing with the others while serving. Port 0 picks a free one.
+    const char *host;
+    int port;
+    int http; // serve HTTP/1.1 GET /greet?name= instead of greet_proto.h
+    // Sheds requests as GREET_OVERLOADED, or 503 over HTTP, when set.
+    // Queue delay counts from the arrival of a request's first bytes.
+    admission_t *admission;
+    // Listening sockets to serve instead of binding new ones, as handed
+    // over by a predecessor: the one of path, or one per thread in
+    // per-core mode. The server owns them even if creation fails, but not
+    // the socket path until greetServerAdopt().
+    const int *listenFds;
+    int listenFdCount;
+
+} greet_server_options_t;
+
+// Binds and listens; returns NULL with errno set on failure.
+greet_server_t *greetServerCreate(const greet_server_options_t *opt);
+// The TCP port listened on in per-core mode, 0 otherwise.
+int greetServerPort(const greet_server_t *self);
+// Serves greet_proto.h requests until greetServerStop(). Returns 0 or -1.
+int greetServerRun(greet_server_t *self);
+// Makes greetServerRun() return; safe from other threads and signal handlers.
+void greetServerStop(greet_server_t *self);
+// Copies up to cap listening sockets to fds, for handing over; returns how
+// many there are.
+int greetServerListeners(const greet_server_t *self, int *fds, int cap);
+// Makes the path of listenFds the server's to unlink on destroy, once the
+// predecessor has let go of it: after greetHandoffCommit() succeeds.
+void greetServerAdopt(greet_server_t *self);
+// Stops accepting, leaving the listeners to a successor, and makes
+// greetServerRun() return once the open connections are closed by their
+// clients. The socket path is no longer unlinked on destroy.
+void greetServerDrain(greet_server_t *self);
+void greetServerDestroy(greet_server_t **self);
+
+#endif // GREET_SERVER_H_
@@ -0,0 +1,120 @@
+// greet_shm.h
+// Shared-memory transport of greeterd: a pair of single-producer
+// single-consumer byte rings in a memfd, one segment per client. Frames are
+// those of greet_proto.h. A consumer spins briefly on an empty ring, then
+// sleeps on a futex; a producer issues FUTEX_WAKE only when the consumer
+// announced it sleeps, i.e. when the ring went from empty to non-empty.
+#ifndef GREET_SHM_H_
+#define GREET_SHM_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define GREET_SHM_MAGIC 0x67726565u // "gree"
+#define GREET_SHM_RING_SIZE 65536   // power of two, holds the largest frame
+#define GREET_SHM_SPIN 4096         // polls of an empty ring before sleeping
+#define GREET_SHM_POLL_MS 100       // how often a sleeper checks its peer
+
+typedef struct greet_shm_ring_t
+{
+    // free-running byte counters; each on its own cache line
+    _Alignas(64) _Atomic uint32_t head; // written by the producer
+    _Alignas(64) _Atomic uint32_t tail; // written by the consumer
+    _Alignas(64) _Atomic uint32_t sleeping; // futex word of the consumer
+    _Alignas(64) char data[GREET_SHM_RING_SIZE];
+
+} greet_shm_ring_t;
+
+typedef struct greet_shm_segment_t
+{
+    uint32_t magic;
+    greet_shm_ring_t request;  // client -> greeterd
+    greet_shm_ring_t response; // greeterd -> client
+
+} greet_shm_segment_t;
+
+static inline void greetShmCpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint32_t greetShmUsed(greet_shm_ring_t *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_acquire)
+         - atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+// copies len bytes in or out of the ring at counter pos, wrapping around
+static inline void greetShmCopyIn(greet_shm_ring_t *r, uint32_t pos, const void *src, uint32_t len)
+{
+    uint32_t off = pos & (GREET_SHM_RING_SIZE - 1), first = GREET_SHM_RING_SIZE - off;
+    if(first > len) { first = len; }
+    memcpy(r->data + off, src, first);
+    memcpy(r->data, (const char *)src + first, len - first);
+}
+
+static inline void greetShmCopyOut(greet_shm_ring_t *r, uint32_t pos, void *dst, uint32_t len)
+{
+    uint32_t off = pos & (GREET_SHM_RING_SIZE - 1), first = GREET_SHM_RING_SIZE - off;
+    if(first > len) { first = len; }
+    memcpy(dst, r->data + off, first);
+    memcpy((char *)dst + first, r->data, len - first);
+}
+
+// Appends a frame of a header and a body; -1 if it does not fit.
+static inline int greetShmPush(greet_shm_ring_t *r, const char *hdr, uint32_t hdrLen,
+                               const char *body, uint32_t bodyLen)
+{
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if(GREET_SHM_RING_SIZE - (head - tail) < hdrLen + bodyLen) { return -1; }
+    greetShmCopyIn(r, head, hdr, hdrLen);
+    greetShmCopyIn(r, head + hdrLen, body, bodyLen);
+    // seq_cst pairs with greetShmWait(): either the consumer sees the new
+    // head, or we see it sleeping and wake it
+    atomic_store(&r->head, head + hdrLen + bodyLen);
+    if(atomic_load(&r->sleeping) && atomic_exchange(&r->sleeping, 0)) {
+        syscall(SYS_futex, &r->sleeping, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+// Polls worth spinning for: none on a single CPU, where the peer cannot
+// make progress while we spin.
+static inline int greetShmSpinLimit(void)
+{
+    return sysconf(_SC_NPROCESSORS_ONLN) > 1 ? GREET_SHM_SPIN : 0;
+}
+
+// Waits up to GREET_SHM_POLL_MS for the ring to be non-empty, polling it
+// spin times first; returns the bytes available, 0 on timeout.
+static inline uint32_t greetShmWait(greet_shm_ring_t *r, int spin)
+{
+    uint32_t used;
+    for(int i = 0; i < spin; ++i) {
+        if((used = greetShmUsed(r))) { return used; }
+        greetShmCpuRelax();
+    }
+    atomic_store(&r->sleeping, 1);
+    if( ! (used = greetShmUsed(r))) {
+        struct timespec timeout = { 0, GREET_SHM_POLL_MS * 1000000L };
+        syscall(SYS_futex, &r->sleeping, FUTEX_WAIT, 1, &timeout, NULL, 0);
+        used = greetShmUsed(r);
+    }
+    atomic_store(&r->sleeping, 0);
+    return used;
+}
+
+static inline void greetShmConsume(greet_shm_ring_t *r, uint32_t len)
+{
+    atomic_fetch_add_explicit(&r->tail, len, memory_order_release);
+}
+
+#endif // GREET_SHM_H_
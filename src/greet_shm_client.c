@@ -0,0 +1,122 @@
+// greet_shm_client.c
+#include "greet_shm_client.h"
+#include "greet_shm.h"
+#include "greet_proto.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+struct greet_shm_client_t
+{
+    int fd; // the handshake socket; its hangup means the server is gone
+    greet_shm_segment_t *seg;
+    int spin;
+    char greeting[GREET_SHM_RING_SIZE]; // the last response, NUL-terminated
+};
+
+static int receiveSegment(int fd)
+{
+    char byte;
+    struct iovec iov = { &byte, 1 };
+    union { struct cmsghdr align; char buf[CMSG_SPACE(sizeof(int))]; } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+    if(recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != 1) { return -1; }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if( ! cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) { return -1; }
+    int mem;
+    memcpy(&mem, CMSG_DATA(cmsg), sizeof(int));
+    return mem;
+}
+
+greet_shm_client_t *greetShmConnect(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if( ! path || strlen(path) >= sizeof(addr.sun_path)) { return NULL; }
+    strcpy(addr.sun_path, path);
+
+    greet_shm_client_t *self = malloc(sizeof(greet_shm_client_t));
+    if( ! self) { return NULL; }
+    self->seg = MAP_FAILED;
+    self->spin = greetShmSpinLimit();
+    self->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int mem = -1;
+    struct stat st;
+    if(self->fd >= 0 && ! connect(self->fd, (struct sockaddr *)&addr, sizeof(addr))
+       && (mem = receiveSegment(self->fd)) >= 0
+       && ! fstat(mem, &st) && st.st_size == sizeof(greet_shm_segment_t)) {
+        self->seg = mmap(NULL, sizeof(greet_shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, mem, 0);
+    }
+    if(mem >= 0) { close(mem); }
+    if(self->seg == MAP_FAILED || self->seg->magic != GREET_SHM_MAGIC) {
+        if(self->seg != MAP_FAILED) { munmap(self->seg, sizeof(greet_shm_segment_t)); }
+        if(self->fd >= 0) { close(self->fd); }
+        free(self);
+        return NULL;
+    }
+    return self;
+}
+
+void greetShmClose(greet_shm_client_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    munmap((*self)->seg, sizeof(greet_shm_segment_t));
+    close((*self)->fd);
+    free(*self);
+    *self = NULL;
+}
+
+static int serverGone(int fd)
+{
+    char b;
+    ssize_t n = recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+const char *greetShmGreet(greet_shm_client_t *self, const char *name)
+{
+    size_t len = name ? strlen(name) : 0;
+    if(len > GREET_PROTO_MAX_NAME) {
+        errno = EINVAL;
+        return NULL;
+    }
+    char hdr[GREET_PROTO_HEADER + 1];
+    greetProtoPutU32(hdr, len);
+    greet_shm_ring_t *out = &self->seg->request, *in = &self->seg->response;
+    // full only if the server stopped taking requests, gone or not
+    if(greetShmPush(out, hdr, GREET_PROTO_HEADER, name, len)) {
+        errno = serverGone(self->fd) ? EPIPE : EAGAIN;
+        return NULL;
+    }
+
+    uint32_t used;
+    while( ! (used = greetShmWait(in, self->spin))) {
+        if(serverGone(self->fd)) {
+            errno = EPIPE;
+            return NULL;
+        }
+    }
+    // the server publishes whole frames and answers one request with one
+    uint32_t tail = atomic_load_explicit(&in->tail, memory_order_relaxed);
+    greetShmCopyOut(in, tail, hdr, sizeof(hdr));
+    uint32_t n = greetProtoGetU32(hdr);
+    if(n < 1 || used < GREET_PROTO_HEADER + n) {
+        errno = EPROTO;
+        return NULL;
+    }
+    greetShmCopyOut(in, tail + sizeof(hdr), self->greeting, n - 1);
+    self->greeting[n - 1] = '\0';
+    greetShmConsume(in, GREET_PROTO_HEADER + n);
+    switch(hdr[GREET_PROTO_HEADER]) {
+        case GREET_OK: return self->greeting;
+        case GREET_OVERLOADED: errno = EAGAIN; return NULL;
+        default: errno = EPROTO; return NULL;
+    }
+}
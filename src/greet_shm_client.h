@@ -0,0 +1,17 @@
+// greet_shm_client.h
+#ifndef GREET_SHM_CLIENT_H_
+#define GREET_SHM_CLIENT_H_
+
+typedef struct greet_shm_client_t greet_shm_client_t;
+
+// Connects to a greet_shm_server and maps the segment it hands over.
+greet_shm_client_t *greetShmConnect(const char *path);
+void greetShmClose(greet_shm_client_t **self);
+
+// Asks greeterd to greet name through shared memory, like greeterGreet().
+// The result lives until the next call; NULL with errno EAGAIN if the
+// server shed the request or is not taking any, EPIPE if it is gone,
+// EINVAL if name is longer than GREET_PROTO_MAX_NAME.
+const char *greetShmGreet(greet_shm_client_t *self, const char *name);
+
+#endif // GREET_SHM_CLIENT_H_
@@ -0,0 +1,334 @@
+// greet_shm_server.c
+#define _GNU_SOURCE // memfd_create
+#include "greet_shm_server.h"
+#include "greet_shm.h"
+#include "greet_proto.h"
+#include "greeter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+typedef struct session_t
+{
+    struct greet_shm_server_t *server;
+    int fd;                   // the handshake socket, kept to notice hangups
+    greet_shm_segment_t *seg;
+    greeter_t *greeter;
+    char *greeting; // formatted here, with room for the longest name
+    size_t greetingCap;
+    pthread_t thread;
+    _Atomic int done;
+    // the verdicts of the requests in the ring, at most one per header
+    uint8_t admitted[GREET_SHM_RING_SIZE / GREET_PROTO_HEADER];
+    struct session_t *next;
+
+} session_t;
+
+struct greet_shm_server_t
+{
+    char *path;
+    char *greeting;
+    int listenFd;
+    int bound;  // the socket file is ours to unlink
+    int stopFd;
+    int drainFd; // eventfd, readable once the listener is left to a successor
+    int reapFd; // eventfd, written by sessions whose client left
+    _Atomic int stopping;
+    int spin;
+    admission_t *admission;
+    session_t *sessions;
+};
+
+static int peerGone(int fd)
+{
+    char b;
+    ssize_t n = recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+// Admits the complete requests among the used bytes at once: they are all
+// in flight from when they were noticed until answered, so that a client
+// queueing many counts against the concurrency limit. Returns how many.
+static uint32_t sessionAdmit(session_t *s, uint32_t used, uint64_t noticedAt)
+{
+    admission_t *admission = s->server->admission;
+    greet_shm_ring_t *in = &s->seg->request;
+    uint32_t pos = atomic_load_explicit(&in->tail, memory_order_relaxed), end = pos + used, k = 0;
+    char hdr[GREET_PROTO_HEADER];
+    while(k < sizeof(s->admitted) && end - pos >= GREET_PROTO_HEADER) {
+        greetShmCopyOut(in, pos, hdr, GREET_PROTO_HEADER);
+        uint32_t len = greetProtoGetU32(hdr);
+        if(len > GREET_PROTO_MAX_NAME || end - pos - GREET_PROTO_HEADER < len) { break; }
+        pos += GREET_PROTO_HEADER + len;
+        s->admitted[k++] = ! admission || admissionAcquire(admission, noticedAt, admissionNow()) == ADMISSION_ADMIT;
+    }
+    return k;
+}
+
+// releases the admitted requests among the k from i on
+static void sessionRelease(session_t *s, uint32_t i, uint32_t k)
+{
+    for(; s->server->admission && i < k; ++i) {
+        if(s->admitted[i]) { admissionRelease(s->server->admission); }
+    }
+}
+
+// serves the complete requests among the used bytes; -1 on a protocol error
+static int sessionServe(session_t *s, uint32_t used, uint64_t noticedAt)
+{
+    greet_shm_ring_t *in = &s->seg->request, *out = &s->seg->response;
+    char name[GREET_PROTO_MAX_NAME + 1], hdr[GREET_PROTO_HEADER + 1];
+    uint32_t k = sessionAdmit(s, used, noticedAt);
+    for(uint32_t i = 0; i < k; ++i) {
+        uint32_t tail = atomic_load_explicit(&in->tail, memory_order_relaxed);
+        greetShmCopyOut(in, tail, hdr, GREET_PROTO_HEADER);
+        uint32_t len = greetProtoGetU32(hdr); // checked by sessionAdmit()
+        greetShmCopyOut(in, tail + GREET_PROTO_HEADER, name, len);
+        name[len] = '\0';
+        greetShmConsume(in, GREET_PROTO_HEADER + len);
+        used -= GREET_PROTO_HEADER + len;
+
+        uint32_t n = 0;
+        int status = GREET_OVERLOADED;
+        if(s->admitted[i]) {
+            n = greeterGreetTo(s->greeter, len ? name : NULL, len, s->greeting, s->greetingCap);
+            status = GREET_OK;
+        }
+        greetProtoPutU32(hdr, 1 + n);
+        hdr[GREET_PROTO_HEADER] = status;
+        int pushed = greetShmPush(out, hdr, sizeof(hdr), s->greeting, n);
+        sessionRelease(s, i, pushed ? k : i + 1);
+        if(pushed) { return -1; }
+    }
+    // a frame left is malformed, or incomplete, which clients never write
+    return used >= GREET_PROTO_HEADER ? -1 : 0;
+}
+
+static void *sessionRun(void *arg)
+{
+    session_t *s = arg;
+    while( ! atomic_load(&s->server->stopping)) {
+        uint32_t used = greetShmWait(&s->seg->request, s->server->spin);
+        if(used > GREET_SHM_RING_SIZE) { break; } // head is the client's to write
+        uint64_t noticedAt = used && s->server->admission ? admissionNow() : 0;
+        if(used ? sessionServe(s, used, noticedAt) : peerGone(s->fd)) { break; }
+    }
+    shutdown(s->fd, SHUT_RDWR); // the client stops waiting for responses
+    atomic_store(&s->done, 1);
+    uint64_t one = 1;
+    ssize_t n = write(s->server->reapFd, &one, sizeof(one));
+    (void)n;
+    return NULL;
+}
+
+static void sessionDestroy(session_t *s)
+{
+    pthread_join(s->thread, NULL);
+    munmap(s->seg, sizeof(greet_shm_segment_t));
+    close(s->fd);
+    greeterDestroy(&s->greeter);
+    free(s->greeting);
+    free(s);
+}
+
+// creates the segment of a new client and passes it over the socket
+static int sessionCreate(greet_shm_server_t *self, int fd)
+{
+    session_t *s = calloc(1, sizeof(session_t));
+    if( ! s) { return -1; }
+    s->server = self;
+    s->fd = fd;
+    int mem = memfd_create("greet_shm", MFD_CLOEXEC);
+    if(mem >= 0 && ! ftruncate(mem, sizeof(greet_shm_segment_t))) {
+        s->seg = mmap(NULL, sizeof(greet_shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, mem, 0);
+    }
+    if( ! s->seg || s->seg == MAP_FAILED) {
+        if(mem >= 0) { close(mem); }
+        free(s);
+        return -1;
+    }
+    s->seg->magic = GREET_SHM_MAGIC; // the rest is zeroed by ftruncate
+
+    char byte = 0;
+    struct iovec iov = { &byte, 1 };
+    union { struct cmsghdr align; char buf[CMSG_SPACE(sizeof(int))]; } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &mem, sizeof(int));
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    close(mem);
+
+    s->greeter = greeterCreate(self->greeting);
+    if(s->greeter) {
+        s->greetingCap = greeterFormat(s->greeter, NULL, GREET_PROTO_MAX_NAME, NULL, 0) + 1;
+        s->greeting = malloc(s->greetingCap);
+    }
+    if(sent != 1 || ! s->greeting || pthread_create(&s->thread, NULL, sessionRun, s)) {
+        munmap(s->seg, sizeof(greet_shm_segment_t));
+        greeterDestroy(&s->greeter);
+        free(s->greeting);
+        free(s);
+        return -1;
+    }
+    s->next = self->sessions;
+    self->sessions = s;
+    return 0;
+}
+
+// joins the sessions whose client left, or all of them
+static void reapSessions(greet_shm_server_t *self, int all)
+{
+    for(session_t **p = &self->sessions; *p;) {
+        session_t *s = *p;
+        if(all || atomic_load(&s->done)) {
+            *p = s->next;
+            sessionDestroy(s);
+        }
+        else {
+            p = &s->next;
+        }
+    }
+}
+
+// serves listenFd if not negative, binds path otherwise
+static greet_shm_server_t *serverCreate(int listenFd, const char *path, const char *greeting,
+                                        admission_t *admission)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    greet_shm_server_t *self = NULL;
+    if( ! path || strlen(path) >= sizeof(addr.sun_path)) { errno = EINVAL; }
+    else { self = calloc(1, sizeof(greet_shm_server_t)); }
+    if( ! self) {
+        if(listenFd >= 0) { close(listenFd); }
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+    self->path = strdup(path);
+    self->greeting = strdup(greeting ?: "Hello");
+    self->spin = greetShmSpinLimit();
+    self->admission = admission;
+    self->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->reapFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->drainFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int listening;
+    if(listenFd >= 0) {
+        // the path stays the predecessor's until greetShmServerAdopt()
+        self->listenFd = listenFd;
+        listening = 1;
+    }
+    else {
+        self->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        listening = self->bound = self->listenFd >= 0 && ! bind(self->listenFd, (struct sockaddr *)&addr, sizeof(addr))
+                               && ! listen(self->listenFd, SOMAXCONN);
+    }
+    if( ! self->path || ! self->greeting || self->stopFd < 0 || self->reapFd < 0 || self->drainFd < 0
+       || ! listening) {
+        int err = errno;
+        greetShmServerDestroy(&self);
+        errno = err;
+        return NULL;
+    }
+    return self;
+}
+
+greet_shm_server_t *greetShmServerCreate(const char *path, const char *greeting, admission_t *admission)
+{
+    return serverCreate(-1, path, greeting, admission);
+}
+
+greet_shm_server_t *greetShmServerInherit(int listenFd, const char *path, const char *greeting,
+                                          admission_t *admission)
+{
+    return serverCreate(listenFd, path, greeting, admission);
+}
+
+int greetShmServerListener(const greet_shm_server_t *self)
+{
+    return self->listenFd;
+}
+
+void greetShmServerAdopt(greet_shm_server_t *self)
+{
+    self->bound = 1;
+}
+
+int greetShmServerRun(greet_shm_server_t *self)
+{
+    struct pollfd fds[4] = {
+        { self->listenFd, POLLIN, 0 }, { self->stopFd, POLLIN, 0 }, { self->reapFd, POLLIN, 0 },
+        { self->drainFd, POLLIN, 0 },
+    };
+    int rc = 0;
+    while(1) {
+        if(poll(fds, 4, -1) < 0) {
+            if(errno == EINTR) { continue; }
+            rc = -1;
+            break;
+        }
+        if(fds[1].revents) { break; }
+        if(fds[2].revents) {
+            // as soon as a client leaves, not when the next one comes
+            uint64_t count;
+            ssize_t n = read(self->reapFd, &count, sizeof(count));
+            (void)n;
+            reapSessions(self, 0);
+        }
+        if(fds[3].revents) {
+            fds[0].fd = fds[3].fd = -1; // ignored by poll() from now on
+            fds[0].revents = 0;
+        }
+        if(fds[0].revents) {
+            int fd = accept4(self->listenFd, NULL, NULL, SOCK_CLOEXEC);
+            if(fd >= 0 && sessionCreate(self, fd)) { close(fd); }
+        }
+    }
+    atomic_store(&self->stopping, 1);
+    for(session_t *s = self->sessions; s; s = s->next) {
+        atomic_store(&s->seg->request.sleeping, 0);
+        syscall(SYS_futex, &s->seg->request.sleeping, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    reapSessions(self, 1);
+    return rc;
+}
+
+void greetShmServerStop(greet_shm_server_t *self)
+{
+    uint64_t one = 1;
+    ssize_t n = write(self->stopFd, &one, sizeof(one));
+    (void)n;
+}
+
+void greetShmServerDrain(greet_shm_server_t *self)
+{
+    self->bound = 0;
+    uint64_t one = 1;
+    ssize_t n = write(self->drainFd, &one, sizeof(one));
+    (void)n;
+}
+
+void greetShmServerDestroy(greet_shm_server_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    if((*self)->listenFd >= 0) { close((*self)->listenFd); }
+    if((*self)->bound) { unlink((*self)->path); }
+    if((*self)->stopFd >= 0) { close((*self)->stopFd); }
+    if((*self)->reapFd >= 0) { close((*self)->reapFd); }
+    if((*self)->drainFd >= 0) { close((*self)->drainFd); }
+    free((*self)->path);
+    free((*self)->greeting);
+    free(*self);
+    *self = NULL;
+}
@@ -0,0 +1,35 @@
+// greet_shm_server.h
+#ifndef GREET_SHM_SERVER_H_
+#define GREET_SHM_SERVER_H_
+
+#include "admission.h"
+
+typedef struct greet_shm_server_t greet_shm_server_t;
+
+// Listens on the Unix socket path only to hand every client a greet_shm.h
+// segment over SCM_RIGHTS; requests then travel through shared memory and
+// are served by a thread per client. A request the admission controller,
+// if any, sheds is answered GREET_OVERLOADED; its queue delay counts from
+// when its thread noticed it. NULL with errno set on failure.
+greet_shm_server_t *greetShmServerCreate(const char *path, const char *greeting, admission_t *admission);
+// Serves the listening socket of path handed over by a predecessor instead
+// of binding one. The server owns listenFd even if creation fails, but not
+// the socket path until greetShmServerAdopt().
+greet_shm_server_t *greetShmServerInherit(int listenFd, const char *path, const char *greeting,
+                                          admission_t *admission);
+// The listening socket, for handing over.
+int greetShmServerListener(const greet_shm_server_t *self);
+// Makes the path of an inherited listener the server's to unlink on
+// destroy, once the predecessor has let go of it: after greetHandoffCommit().
+void greetShmServerAdopt(greet_shm_server_t *self);
+// Accepts clients until greetShmServerStop(). Returns 0 or -1.
+int greetShmServerRun(greet_shm_server_t *self);
+// Makes greetShmServerRun() return; safe from other threads and signal handlers.
+void greetShmServerStop(greet_shm_server_t *self);
+// Stops accepting clients, leaving the socket path to a successor: it is
+// no longer unlinked on destroy. Those connected are served on until
+// greetShmServerStop().
+void greetShmServerDrain(greet_shm_server_t *self);
+void greetShmServerDestroy(greet_shm_server_t **self);
+
+#endif // GREET_SHM_SERVER_H_
@@ -0,0 +1,202 @@
+// greet_udp.c
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#include "greet_udp.h"
+#include "greet_proto.h"
+#include "greeter.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+
+struct greet_udp_server_t
+{
+    greet_udp_options_t opt;
+    int fd;
+    int port;
+    int stopFd; // eventfd, readable once stopped
+    greeter_t *greeter;
+    // a slot per datagram of a batch, for both directions
+    struct mmsghdr *in, *out;
+    struct iovec *inIov, *outIov;
+    struct sockaddr_in *peers;
+    char *inBuf, *outBuf;
+    int admitted; // requests of the batch in flight until its replies are sent
+};
+
+// answers the request frames of a datagram; returns the reply's length
+static size_t serveDatagram(greet_udp_server_t *self, const char *in, size_t len, char *out,
+                            uint64_t receivedAt)
+{
+    admission_t *admission = self->opt.admission;
+    size_t pos = 0, outLen = 0;
+    while(len - pos >= GREET_PROTO_HEADER) {
+        uint32_t n = greetProtoGetU32(in + pos);
+        if(n > GREET_PROTO_MAX_NAME || len - pos - GREET_PROTO_HEADER < n) { break; } // malformed
+        const char *p = in + pos + GREET_PROTO_HEADER;
+        pos += GREET_PROTO_HEADER + n;
+        if(admission && admissionAcquire(admission, receivedAt, admissionNow()) != ADMISSION_ADMIT) {
+            if(outLen + GREET_PROTO_HEADER + 1 > GREET_UDP_SLOT) { break; }
+            greetProtoPutU32(out + outLen, 1);
+            out[outLen + GREET_PROTO_HEADER] = GREET_OVERLOADED;
+            outLen += GREET_PROTO_HEADER + 1;
+            continue;
+        }
+        if(admission) { ++self->admitted; }
+        if(outLen + GREET_PROTO_HEADER + 1 > GREET_UDP_SLOT) { break; }
+        // the NUL greeterGreetTo() adds is left past the frame, in the slot
+        size_t cap = GREET_UDP_SLOT - outLen - GREET_PROTO_HEADER - 1;
+        char *greeting = out + outLen + GREET_PROTO_HEADER + 1;
+        char name[GREET_PROTO_MAX_NAME + 1];
+        memcpy(name, p, n);
+        name[n] = '\0';
+        size_t total = greeterGreetTo(self->greeter, n ? name : NULL, n, greeting, cap);
+        if(total >= cap) { break; }
+        greetProtoPutU32(out + outLen, 1 + total);
+        out[outLen + GREET_PROTO_HEADER] = GREET_OK;
+        outLen += GREET_PROTO_HEADER + 1 + total;
+    }
+    return outLen;
+}
+
+// answers a batch of datagrams; returns how many were received
+static int serveBatch(greet_udp_server_t *self)
+{
+    int batch = self->opt.batch;
+    for(int i = 0; i < batch; ++i) { self->in[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in); }
+    int n = recvmmsg(self->fd, self->in, batch, MSG_DONTWAIT, NULL);
+    if(n <= 0) { return 0; }
+    uint64_t receivedAt = self->opt.admission ? admissionNow() : 0;
+    int m = 0;
+    for(int i = 0; i < n; ++i) {
+        if(self->in[i].msg_hdr.msg_flags & MSG_TRUNC) { continue; }
+        char *out = self->outBuf + (size_t)m * GREET_UDP_SLOT;
+        const char *in = self->inBuf + (size_t)i * GREET_UDP_SLOT;
+        size_t len = serveDatagram(self, in, self->in[i].msg_len, out, receivedAt);
+        if( ! len) { continue; }
+        self->outIov[m].iov_len = len;
+        self->out[m].msg_hdr.msg_name = &self->peers[i];
+        self->out[m].msg_hdr.msg_namelen = self->in[i].msg_hdr.msg_namelen;
+        ++m;
+    }
+    for(int sent = 0; sent < m;) {
+        int k = sendmmsg(self->fd, self->out + sent, m - sent, 0);
+        if(k < 0 && errno == EINTR) { continue; }
+        if(k <= 0) { break; } // replies are best effort
+        sent += k;
+    }
+    for(; self->admitted; --self->admitted) { admissionRelease(self->opt.admission); }
+    loggerFlush();
+    return n;
+}
+
+greet_udp_server_t *greetUdpServerCreate(const greet_udp_options_t *opt)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(opt->port) };
+    if( ! opt->fd && ( ! opt->host || inet_pton(AF_INET, opt->host, &addr.sin_addr) != 1)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    greet_udp_server_t *self = calloc(1, sizeof(greet_udp_server_t));
+    if( ! self) {
+        if(opt->fd) { close(*opt->fd); }
+        return NULL;
+    }
+    self->opt = *opt;
+    if(self->opt.batch < 1) { self->opt.batch = 1; }
+    if(self->opt.batch > GREET_UDP_MAX_BATCH) { self->opt.batch = GREET_UDP_MAX_BATCH; }
+    int batch = self->opt.batch;
+    self->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->fd = opt->fd ? *opt->fd : socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    self->greeter = greeterCreate(opt->greeting);
+    self->in = calloc(batch, sizeof(struct mmsghdr));
+    self->out = calloc(batch, sizeof(struct mmsghdr));
+    self->inIov = calloc(batch, sizeof(struct iovec));
+    self->outIov = calloc(batch, sizeof(struct iovec));
+    self->peers = calloc(batch, sizeof(struct sockaddr_in));
+    self->inBuf = malloc((size_t)batch * GREET_UDP_SLOT);
+    self->outBuf = malloc((size_t)batch * GREET_UDP_SLOT);
+    socklen_t len = sizeof(addr);
+    if(self->stopFd < 0 || self->fd < 0 || ! self->greeter || ! self->in || ! self->out
+       || ! self->inIov || ! self->outIov || ! self->peers || ! self->inBuf || ! self->outBuf
+       || ( ! opt->fd && bind(self->fd, (struct sockaddr *)&addr, sizeof(addr)))
+       || getsockname(self->fd, (struct sockaddr *)&addr, &len)) {
+        int err = errno;
+        greetUdpServerDestroy(&self);
+        errno = err;
+        return NULL;
+    }
+    self->port = ntohs(addr.sin_port);
+    for(int i = 0; i < batch; ++i) {
+        self->inIov[i] = (struct iovec){ self->inBuf + (size_t)i * GREET_UDP_SLOT, GREET_UDP_SLOT };
+        self->in[i].msg_hdr.msg_iov = &self->inIov[i];
+        self->in[i].msg_hdr.msg_iovlen = 1;
+        self->in[i].msg_hdr.msg_name = &self->peers[i];
+        self->outIov[i].iov_base = self->outBuf + (size_t)i * GREET_UDP_SLOT;
+        self->out[i].msg_hdr.msg_iov = &self->outIov[i];
+        self->out[i].msg_hdr.msg_iovlen = 1;
+    }
+    return self;
+}
+
+int greetUdpServerPort(const greet_udp_server_t *self)
+{
+    return self->port;
+}
+
+int greetUdpServerSocket(const greet_udp_server_t *self)
+{
+    return self->fd;
+}
+
+int greetUdpServerRun(greet_udp_server_t *self)
+{
+    struct pollfd fds[2] = { { self->fd, POLLIN, 0 }, { self->stopFd, POLLIN, 0 } };
+    // a batch's log lines, written out at once; a line is never longer
+    // than the response frame it goes with
+    loggerBufferStart((size_t)self->opt.batch * GREET_UDP_SLOT * 2);
+    int rc = 0;
+    for(;;) {
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) { continue; }
+            rc = -1;
+            break;
+        }
+        if(fds[1].revents) { break; }
+        while(serveBatch(self) == self->opt.batch) {} // more may be queued
+    }
+    loggerBufferStop();
+    return rc;
+}
+
+void greetUdpServerStop(greet_udp_server_t *self)
+{
+    uint64_t one = 1;
+    ssize_t n = write(self->stopFd, &one, sizeof(one));
+    (void)n;
+}
+
+void greetUdpServerDestroy(greet_udp_server_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    if((*self)->fd >= 0) { close((*self)->fd); }
+    if((*self)->stopFd >= 0) { close((*self)->stopFd); }
+    greeterDestroy(&(*self)->greeter);
+    free((*self)->in);
+    free((*self)->out);
+    free((*self)->inIov);
+    free((*self)->outIov);
+    free((*self)->peers);
+    free((*self)->inBuf);
+    free((*self)->outBuf);
+    free(*self);
+    *self = NULL;
+}
@@ -0,0 +1,44 @@
+// greet_udp.h
+// UDP front end of greeterd for fire-and-forget traffic. A datagram holds
+// one or more greet_proto.h request frames back to back; the reply holds
+// their response frames, as many as fit in GREET_UDP_SLOT bytes. Datagrams
+// are received and answered in batches with recvmmsg/sendmmsg, in buffers
+// allocated up front; greetings are logged a batch at a time.
+#ifndef GREET_UDP_H_
+#define GREET_UDP_H_
+
+#include "admission.h"
+
+#define GREET_UDP_SLOT 8192      // largest datagram taken or sent
+#define GREET_UDP_MAX_BATCH 256
+
+typedef struct greet_udp_server_t greet_udp_server_t;
+
+typedef struct greet_udp_options_t
+{
+    const char *host; // IPv4 address to bind
+    int port;         // 0 picks a free one, see greetUdpServerPort()
+    const char *greeting;
+    int batch;        // datagrams per recvmmsg/sendmmsg, up to GREET_UDP_MAX_BATCH
+    // Answers names GREET_OVERLOADED when it sheds them, if set; queue
+    // delay counts from the receipt of their batch.
+    admission_t *admission;
+    // A bound socket to answer on instead of binding one, as handed over
+    // by a predecessor; host and port are then ignored. The server owns it
+    // even if creation fails.
+    const int *fd;
+
+} greet_udp_options_t;
+
+// Binds the socket; NULL with errno set on failure.
+greet_udp_server_t *greetUdpServerCreate(const greet_udp_options_t *opt);
+int greetUdpServerPort(const greet_udp_server_t *self);
+// The socket answered on, for handing over.
+int greetUdpServerSocket(const greet_udp_server_t *self);
+// Answers datagrams until greetUdpServerStop(). Returns 0 or -1.
+int greetUdpServerRun(greet_udp_server_t *self);
+// Makes greetUdpServerRun() return; safe from other threads and signal handlers.
+void greetUdpServerStop(greet_udp_server_t *self);
+void greetUdpServerDestroy(greet_udp_server_t **self);
+
+#endif // GREET_UDP_H_
@@ -0,0 +1,122 @@
+// greet_udp_bench.c
+// Loopback benchmark of the UDP front end: for each batch size, serves
+// from a thread and has a client exchange datagrams with it in batches of
+// the same size; reports answered datagrams and names per second.
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#include "greet_udp.h"
+#include "greet_proto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *serverRun(void *arg)
+{
+    greetUdpServerRun(arg);
+    return NULL;
+}
+
+// exchanges batches for the given time; returns datagrams answered
+static long exchange(int fd, int batch, int names, double seconds, long *sent)
+{
+    struct mmsghdr out[GREET_UDP_MAX_BATCH], in[GREET_UDP_MAX_BATCH];
+    struct iovec outIov[GREET_UDP_MAX_BATCH], inIov[GREET_UDP_MAX_BATCH];
+    static char outBuf[GREET_UDP_MAX_BATCH][GREET_UDP_SLOT], inBuf[GREET_UDP_MAX_BATCH][GREET_UDP_SLOT];
+    memset(out, 0, sizeof(out));
+    memset(in, 0, sizeof(in));
+    for(int i = 0; i < batch; ++i) {
+        size_t len = 0;
+        for(int k = 0; k < names; ++k) {
+            int n = snprintf(outBuf[i] + len + GREET_PROTO_HEADER, 32, "user%d.%d", i, k);
+            greetProtoPutU32(outBuf[i] + len, n);
+            len += GREET_PROTO_HEADER + n;
+        }
+        outIov[i] = (struct iovec){ outBuf[i], len };
+        out[i].msg_hdr.msg_iov = &outIov[i];
+        out[i].msg_hdr.msg_iovlen = 1;
+        inIov[i] = (struct iovec){ inBuf[i], GREET_UDP_SLOT };
+        in[i].msg_hdr.msg_iov = &inIov[i];
+        in[i].msg_hdr.msg_iovlen = 1;
+    }
+    long answered = 0;
+    *sent = 0;
+    double end = now() + seconds;
+    while(now() < end) {
+        for(int done = 0; done < batch;) {
+            int k = sendmmsg(fd, out + done, batch - done, 0);
+            if(k < 0 && errno == EINTR) { continue; }
+            if(k <= 0) { return -1; }
+            done += k;
+        }
+        *sent += batch;
+        // replies that do not come within the timeout count as lost
+        struct pollfd p = { fd, POLLIN, 0 };
+        for(int got = 0; got < batch && poll(&p, 1, 20) > 0;) {
+            int k = recvmmsg(fd, in, batch - got, MSG_DONTWAIT, NULL);
+            if(k > 0) { got += k; answered += k; }
+        }
+    }
+    return answered;
+}
+
+int main(int argc, char *argv[])
+{
+    int batches[] = { 1, 4, 16, 64, 256 };
+    int names = 1, c;
+    double seconds = 1;
+    while((c = getopt(argc, argv, "k:d:h")) != -1) {
+        switch(c) {
+            case 'k': names = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-k names per datagram] [-d seconds per batch size]\n", argv[0]);
+                return c == 'h' ? 0 : 2;
+        }
+    }
+    if(names < 1 || names > 64 || seconds <= 0) { return 2; }
+
+    for(size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b) {
+        greet_udp_options_t opt = { .host = "127.0.0.1", .greeting = "Hello", .batch = batches[b] };
+        greet_udp_server_t *server = greetUdpServerCreate(&opt);
+        if( ! server) {
+            perror("greetUdpServerCreate");
+            return 1;
+        }
+        pthread_t thread;
+        pthread_create(&thread, NULL, serverRun, server);
+
+        struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(greetUdpServerPort(server)) };
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        long sent = 0, answered = -1;
+        if(fd >= 0 && ! connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+            answered = exchange(fd, batches[b], names, seconds, &sent);
+        }
+        if(fd >= 0) { close(fd); }
+        greetUdpServerStop(server);
+        pthread_join(thread, NULL);
+        greetUdpServerDestroy(&server);
+        if(answered < 0) {
+            perror("exchange");
+            return 1;
+        }
+        printf("batch %3d: %9.0f datagrams/s %10.0f names/s, %.2f%% lost\n", batches[b],
+               answered / seconds, answered * names / seconds,
+               sent ? 100.0 * (sent - answered) / sent : 0.0);
+    }
+    return 0;
+}
@@ -5,29 +5,78 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdatomic.h>
 
 struct greeter_t
 {
     char *greeting; // "Hello", "Hola", "Bonjour", "Ciao", "Üdv", etc
+    size_t greetingLen;
+    unsigned id;
     char buffer[100]; // output goes here
 };
 
+static atomic_uint nextId;
+static _Atomic(greeter_trace_fn *) trace;
+
 greeter_t *greeterCreate(const char *greeting)
 {
     if( ! greeting) { return NULL; }
     greeter_t *self = malloc(sizeof(greeter_t));
     self->greeting = strdup(greeting);
+    self->greetingLen = strlen(greeting);
+    self->id = atomic_fetch_add_explicit(&nextId, 1, memory_order_relaxed);
     return self;
 }
 
 const char *greeterGreet(greeter_t *self, const char *name)
 {
     if( ! self) { return NULL; }
+    greeter_trace_fn *traced = atomic_load_explicit(&trace, memory_order_acquire);
+    if(traced) { traced(self, name); }
     snprintf(self->buffer, sizeof(self->buffer), "%s, %s!", self->greeting, name ?: "World");
     loggerWriteLog(self->buffer); // external dependency
     return self->buffer;
 }
 
+const char *greeterGreeting(const greeter_t *self)
+{
+    return self ? self->greeting : NULL;
+}
+
+unsigned greeterId(const greeter_t *self)
+{
+    return self->id;
+}
+
+void greeterSetTrace(greeter_trace_fn *fn)
+{
+    atomic_store_explicit(&trace, fn, memory_order_release);
+}
+
+size_t greeterFormat(const greeter_t *self, const char *name, size_t len, char *out, size_t cap)
+{
+    size_t total = self->greetingLen + 2 + len + 1;
+    if(total > cap) { return total; }
+    memcpy(out, self->greeting, self->greetingLen);
+    out += self->greetingLen;
+    *out++ = ',';
+    *out++ = ' ';
+    memcpy(out, name, len);
+    out[len] = '!';
+    return total;
+}
+
+size_t greeterGreetTo(greeter_t *self, const char *name, size_t len, char *out, size_t cap)
+{
+    size_t total = greeterFormat(self, name ? name : "World", name ? len : 5, out, cap ? cap - 1 : 0);
+    if(total >= cap) { return total; }
+    out[total] = '\0';
+    greeter_trace_fn *traced = atomic_load_explicit(&trace, memory_order_acquire);
+    if(traced) { traced(self, name); }
+    loggerWriteLog(out); // external dependency
+    return total;
+}
+
 void greeterDestroy(greeter_t **self)
 {
     assert(self);
@@ -2,10 +2,32 @@
 #ifndef GREETER_H_
 #define GREETER_H_
 
+#include <stddef.h>
+
 typedef struct greeter_t greeter_t;
 
 greeter_t *greeterCreate(const char *greeting);
 const char *greeterGreet(greeter_t *self, const char *name);
 void greeterDestroy(greeter_t **self);
+const char *greeterGreeting(const greeter_t *self);
+
+// Writes the greeting of the len long name to out without a terminating
+// NUL or logging, for batch use. Returns its length; nothing is written
+// if that exceeds cap.
+size_t greeterFormat(const greeter_t *self, const char *name, size_t len, char *out, size_t cap);
+// As greeterGreet(), but into out and not truncated: formats the greeting
+// of name, len long and NUL-terminated, or World if NULL, as
+// greeterFormat() does plus a NUL, then traces and logs it. Returns its
+// length; nothing is written, traced or logged if that is cap or more.
+size_t greeterGreetTo(greeter_t *self, const char *name, size_t len, char *out, size_t cap);
+
+// Identifies the greeter among those created by the process, from 0 up.
+unsigned greeterId(const greeter_t *self);
+
+// Called by greeterGreet() and greeterGreetTo() with every greeting while
+// set; NULL to unset. Used by greeter_capture.h. Safe to call while other
+// threads greet.
+typedef void greeter_trace_fn(const greeter_t *self, const char *name);
+void greeterSetTrace(greeter_trace_fn *trace);
 
 #endif // GREETER_H_
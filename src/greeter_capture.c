@@ -0,0 +1,336 @@
+// greeter_capture.c
+#include "greeter_capture.h"
+#include "greeter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAGIC "GRCAP2"
+#define MAGIC_V1 "GRCAP1" // no 'T' records: one thread's, or serialized
+#define MAX_TIME (1 + 10) // a 'T' record
+#define MAX_RECORD (1 + 3 * 10 + GREETER_CAPTURE_MAX_TEXT) // type, varints, text
+#define BUFFER (MAX_TIME + 2 * MAX_RECORD)
+
+// The records of one greeting thread, appended to the file a buffer at a
+// time. Locked by its thread while it records and by greeterCaptureStop()
+// to flush it; never contended otherwise.
+typedef struct buffer_t
+{
+    pthread_mutex_t lock;
+    struct buffer_t *prev, *next; // among those of capture.buffers
+    uint64_t generation;  // of the capture its records and seen are for
+    uint64_t last;        // ns of the previous record, 0 for none yet
+    unsigned char *seen;  // greeter ids described by this thread
+    size_t seenCap;
+    size_t len;
+    unsigned char buf[BUFFER];
+
+} buffer_t;
+
+// lock order: registry, a buffer's lock, file
+static struct
+{
+    pthread_mutex_t registry; // buffers, generation and active
+    pthread_mutex_t file;     // fd and failed
+    pthread_once_t once;
+    pthread_key_t key;        // flushes and frees the buffer of an exiting thread
+    buffer_t *buffers;
+    uint64_t generation;      // of the current or last capture
+    _Atomic int active;
+    uint64_t start;           // ns when the capture started
+    int fd;                   // -1 while stopped
+    int failed;               // a write, or the buffer of a thread, failed
+
+} capture = {
+    .registry = PTHREAD_MUTEX_INITIALIZER, .file = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT, .fd = -1,
+};
+
+static __thread buffer_t *mine;
+
+struct greeter_capture_reader_t
+{
+    FILE *f;
+    uint64_t time;
+    char text[GREETER_CAPTURE_MAX_TEXT + 1];
+};
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void putVarint(buffer_t *b, uint64_t v)
+{
+    for(; v >= 0x80; v >>= 7) { b->buf[b->len++] = (unsigned char)v | 0x80; }
+    b->buf[b->len++] = (unsigned char)v;
+}
+
+static void putText(buffer_t *b, const char *text, size_t len)
+{
+    memcpy(b->buf + b->len, text, len);
+    b->len += len;
+}
+
+static void writeAll(const unsigned char *buf, size_t len)
+{
+    for(size_t off = 0; off < len; ) {
+        ssize_t n = write(capture.fd, buf + off, len - off);
+        if(n < 0 && errno == EINTR) { continue; }
+        if(n <= 0) {
+            capture.failed = 1;
+            break;
+        }
+        off += n;
+    }
+}
+
+// appends the records of b to the file, the one step threads take in turn
+static void flush(buffer_t *b)
+{
+    if( ! b->len) { return; }
+    pthread_mutex_lock(&capture.file);
+    if(capture.fd >= 0) { writeAll(b->buf, b->len); }
+    pthread_mutex_unlock(&capture.file);
+    b->len = 0;
+}
+
+// makes room for a record at ns now; the records of a buffer follow those
+// of other threads in the file, so each buffer starts from the time of its
+// first record since the capture started
+static void reserve(buffer_t *b, uint64_t now)
+{
+    if(b->len + MAX_TIME + MAX_RECORD > BUFFER) { flush(b); }
+    if( ! b->len) {
+        b->buf[b->len++] = 'T';
+        putVarint(b, now - capture.start);
+        b->last = now;
+    }
+}
+
+// describes greeter id, unless this thread did already; 0 or -1
+static int describe(buffer_t *b, const greeter_t *g, unsigned id, uint64_t now)
+{
+    if(id < b->seenCap && b->seen[id]) { return 0; }
+    if(id >= b->seenCap) {
+        size_t cap = b->seenCap ? b->seenCap : 64;
+        while(cap <= id) { cap *= 2; }
+        unsigned char *seen = realloc(b->seen, cap);
+        if( ! seen) { return -1; }
+        memset(seen + b->seenCap, 0, cap - b->seenCap);
+        b->seen = seen;
+        b->seenCap = cap;
+    }
+    b->seen[id] = 1;
+    const char *greeting = greeterGreeting(g);
+    size_t len = strnlen(greeting, GREETER_CAPTURE_MAX_TEXT);
+    reserve(b, now);
+    b->buf[b->len++] = 'G';
+    putVarint(b, id);
+    putVarint(b, len);
+    putText(b, greeting, len);
+    return 0;
+}
+
+static void bufferDestroy(void *arg)
+{
+    buffer_t *b = arg;
+    pthread_mutex_lock(&capture.registry);
+    if(b->prev) { b->prev->next = b->next; } else { capture.buffers = b->next; }
+    if(b->next) { b->next->prev = b->prev; }
+    pthread_mutex_lock(&b->lock);
+    if(capture.active && b->generation == capture.generation) { flush(b); }
+    pthread_mutex_unlock(&b->lock);
+    pthread_mutex_unlock(&capture.registry);
+    pthread_mutex_destroy(&b->lock);
+    free(b->seen);
+    free(b);
+}
+
+static void createKey(void)
+{
+    pthread_key_create(&capture.key, bufferDestroy);
+}
+
+// the buffer of the calling thread, created on its first greeting
+static buffer_t *buffer(void)
+{
+    if(mine) { return mine; }
+    buffer_t *b = calloc(1, sizeof(buffer_t));
+    if( ! b) { return NULL; }
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_setspecific(capture.key, b);
+    pthread_mutex_lock(&capture.registry);
+    b->next = capture.buffers;
+    if(b->next) { b->next->prev = b; }
+    capture.buffers = b;
+    pthread_mutex_unlock(&capture.registry);
+    return mine = b;
+}
+
+static void captureGreet(const greeter_t *g, const char *name)
+{
+    unsigned id = greeterId(g);
+    size_t len = name ? strnlen(name, GREETER_CAPTURE_MAX_TEXT) : 0;
+    buffer_t *b = buffer();
+    if( ! b) {
+        pthread_mutex_lock(&capture.file);
+        capture.failed = 1;
+        pthread_mutex_unlock(&capture.file);
+        return;
+    }
+    uint64_t now = nowNs();
+    pthread_mutex_lock(&b->lock);
+    // checked under the lock that greeterCaptureStop() flushes under, so
+    // that what is recorded is flushed
+    if(atomic_load_explicit(&capture.active, memory_order_acquire)) {
+        if(b->generation != capture.generation) { // left from an earlier capture
+            b->generation = capture.generation;
+            b->len = 0;
+            if(b->seen) { memset(b->seen, 0, b->seenCap); }
+        }
+        if( ! describe(b, g, id, now)) {
+            reserve(b, now);
+            b->buf[b->len++] = 'N';
+            putVarint(b, now - b->last);
+            putVarint(b, id);
+            putVarint(b, name ? len + 1 : 0);
+            if(name) { putText(b, name, len); }
+            b->last = now;
+        }
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+int greeterCaptureStart(const char *path)
+{
+    pthread_once(&capture.once, createKey);
+    pthread_mutex_lock(&capture.registry);
+    pthread_mutex_lock(&capture.file);
+    if(capture.fd >= 0) {
+        pthread_mutex_unlock(&capture.file);
+        pthread_mutex_unlock(&capture.registry);
+        errno = EBUSY;
+        return -1;
+    }
+    capture.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(capture.fd >= 0) {
+        capture.failed = 0;
+        writeAll((const unsigned char *)MAGIC, sizeof(MAGIC) - 1);
+        capture.start = nowNs();
+        ++capture.generation;
+        atomic_store_explicit(&capture.active, 1, memory_order_release);
+    }
+    int rc = capture.fd >= 0 ? 0 : -1;
+    pthread_mutex_unlock(&capture.file);
+    pthread_mutex_unlock(&capture.registry);
+    if( ! rc) { greeterSetTrace(captureGreet); }
+    return rc;
+}
+
+int greeterCaptureStop(void)
+{
+    greeterSetTrace(NULL);
+    pthread_mutex_lock(&capture.registry);
+    atomic_store_explicit(&capture.active, 0, memory_order_release);
+    for(buffer_t *b = capture.buffers; b; b = b->next) {
+        pthread_mutex_lock(&b->lock);
+        if(b->generation == capture.generation) { flush(b); }
+        pthread_mutex_unlock(&b->lock);
+    }
+    pthread_mutex_lock(&capture.file);
+    int rc = 0;
+    if(capture.fd >= 0) {
+        rc = close(capture.fd) || capture.failed ? -1 : 0;
+        capture.fd = -1;
+    }
+    pthread_mutex_unlock(&capture.file);
+    pthread_mutex_unlock(&capture.registry);
+    return rc;
+}
+
+greeter_capture_reader_t *greeterCaptureOpen(const char *path)
+{
+    greeter_capture_reader_t *self = malloc(sizeof(greeter_capture_reader_t));
+    if( ! self) { return NULL; }
+    self->time = 0;
+    char magic[sizeof(MAGIC) - 1];
+    if( ! (self->f = fopen(path, "rb"))) {
+        free(self);
+        return NULL;
+    }
+    if(fread(magic, 1, sizeof(magic), self->f) != sizeof(magic)
+       || (memcmp(magic, MAGIC, sizeof(magic)) && memcmp(magic, MAGIC_V1, sizeof(magic)))) {
+        greeterCaptureClose(&self);
+        errno = EPROTO;
+        return NULL;
+    }
+    return self;
+}
+
+// 0, or -1 at the end of the file or on an overlong varint
+static int getVarint(FILE *f, uint64_t *v)
+{
+    *v = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        int c = getc(f);
+        if(c == EOF) { return -1; }
+        *v |= (uint64_t)(c & 0x7f) << shift;
+        if( ! (c & 0x80)) { return 0; }
+    }
+    return -1;
+}
+
+static int getText(greeter_capture_reader_t *self, uint64_t len)
+{
+    if(len > GREETER_CAPTURE_MAX_TEXT || fread(self->text, 1, len, self->f) != len) { return -1; }
+    self->text[len] = '\0';
+    return 0;
+}
+
+int greeterCaptureNext(greeter_capture_reader_t *self, greeter_capture_record_t *record)
+{
+    int type;
+    while((type = getc(self->f)) == 'T') { // the time the records of a thread go on from
+        if(getVarint(self->f, &self->time)) { return -1; }
+    }
+    if(type == EOF) { return 0; }
+    uint64_t delta = 0, id, len;
+    if(type == 'G') {
+        if(getVarint(self->f, &id) || getVarint(self->f, &len) || getText(self, len)) { return -1; }
+        record->type = GREETER_CAPTURE_GREETER;
+        record->text = self->text;
+        record->len = len;
+    }
+    else if(type == 'N') {
+        if(getVarint(self->f, &delta) || getVarint(self->f, &id) || getVarint(self->f, &len)
+           || (len && getText(self, len - 1))) { return -1; }
+        record->type = GREETER_CAPTURE_GREET;
+        record->text = len ? self->text : NULL;
+        record->len = len ? len - 1 : 0;
+    }
+    else { return -1; }
+    if(id > UINT32_MAX) { return -1; }
+    self->time += delta;
+    record->time = self->time;
+    record->greeter = id;
+    return 1;
+}
+
+void greeterCaptureClose(greeter_capture_reader_t **self)
+{
+    assert(self);
+    if( ! *self) { return; }
+    fclose((*self)->f);
+    free(*self);
+    *self = NULL;
+}
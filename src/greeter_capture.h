@@ -0,0 +1,57 @@
+// greeter_capture.h
+// Records what greeterGreet() is asked, for replaying real traffic; see
+// greeter_replay.c. While started, every greeting appends a compact binary
+// record to the capture file: after the "GRCAP2" header, each greeter is
+// described once by each thread greeting with it, before its first
+// greeting there, then each greeting is
+//   'N' varint(ns since the previous record) varint(greeter id)
+//       varint(name length + 1, 0 for NULL) name bytes
+// and a greeter description is
+//   'G' varint(greeter id) varint(greeting length) greeting bytes
+// Each thread records into a buffer of its own, appended to the file when
+// it fills, so that greeting threads only take turns to write(2). Records
+// of different threads are thus not in time order: the records of each
+// buffer start with
+//   'T' varint(ns since the capture started)
+// which the times of those that follow count from. "GRCAP1" files, from
+// before, are read as well. Greeting costs one atomic load while stopped.
+#ifndef GREETER_CAPTURE_H_
+#define GREETER_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GREETER_CAPTURE_MAX_TEXT 65536 // longer names and greetings are cut
+
+// Starts capturing the greetings of every greeter to path, truncating it.
+// 0, or -1 with errno set.
+int greeterCaptureStart(const char *path);
+// Stops capturing and flushes the file. 0, or -1 if writing it failed.
+int greeterCaptureStop(void);
+
+typedef enum greeter_capture_type_t
+{
+    GREETER_CAPTURE_GREETER, // greeter is described with text, its greeting
+    GREETER_CAPTURE_GREET,   // greeter greeted text, NULL for no name, at time
+
+} greeter_capture_type_t;
+
+typedef struct greeter_capture_record_t
+{
+    greeter_capture_type_t type;
+    uint64_t time;   // ns since the capture started
+    unsigned greeter;
+    const char *text; // NUL-terminated; valid until the next record
+    size_t len;
+
+} greeter_capture_record_t;
+
+typedef struct greeter_capture_reader_t greeter_capture_reader_t;
+
+// NULL with errno set if path cannot be read or is not a capture.
+greeter_capture_reader_t *greeterCaptureOpen(const char *path);
+// Reads the next record: 1, 0 at the end, -1 if the file is malformed.
+int greeterCaptureNext(greeter_capture_reader_t *self, greeter_capture_record_t *record);
+void greeterCaptureClose(greeter_capture_reader_t **self);
+
+#endif // GREETER_CAPTURE_H_
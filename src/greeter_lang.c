@@ -0,0 +1,16 @@
+// greeter_lang.c
+#include "greeter_lang.h"
+#include "greetings_mph.h" // generated from greetings.txt by mphgen
+#include <string.h>
+
+const char *greeterLangGreeting(const char *lang)
+{
+    if( ! lang) { return NULL; }
+    int slot = greetingsIndex(lang, strlen(lang));
+    return slot < 0 ? NULL : greetingsValues[slot];
+}
+
+greeter_t *greeterCreateForLang(const char *lang)
+{
+    return greeterCreate(greeterLangGreeting(lang));
+}
@@ -0,0 +1,12 @@
+// greeter_lang.h
+#ifndef GREETER_LANG_H_
+#define GREETER_LANG_H_
+
+#include "greeter.h"
+
+// Greeting of a language code from greetings.txt ("fr" -> "Bonjour"),
+// or NULL if the language is not supported.
+const char *greeterLangGreeting(const char *lang);
+greeter_t *greeterCreateForLang(const char *lang);
+
+#endif // GREETER_LANG_H_
@@ -0,0 +1,173 @@
+// greeter_replay.c
+// Replays a greeter_capture.h file through greeterGreet(): at the
+// original pace, scaled by a speed factor, measuring each latency from
+// when the greeting was due as loadgen does; or as fast as possible.
+// Reports throughput and latency percentiles.
+#include "greeter.h"
+#include "greeter_capture.h"
+#include "histogram.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+typedef struct
+{
+    uint64_t time; // ns since the capture started
+    unsigned greeter;
+    char *name;    // NULL for none
+
+} greet_t;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void sleepUntil(uint64_t ns)
+{
+    struct timespec ts = { ns / 1000000000u, ns % 1000000000u };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {}
+}
+
+static int byTime(const void *a, const void *b)
+{
+    uint64_t x = ((const greet_t *)a)->time, y = ((const greet_t *)b)->time;
+    return (x > y) - (x < y);
+}
+
+// reads the capture into greets, in time order across the threads that
+// recorded them, and creates its greeters, indexed by id
+static int load(const char *path, greet_t **greets, size_t *n, greeter_t ***greeters, size_t *greeterCap)
+{
+    greeter_capture_reader_t *r = greeterCaptureOpen(path);
+    if( ! r) { return -1; }
+    size_t cap = 0;
+    greeter_capture_record_t rec;
+    int rc;
+    while((rc = greeterCaptureNext(r, &rec)) == 1) {
+        if(rec.greeter >= *greeterCap) {
+            size_t grown = *greeterCap ? *greeterCap : 16;
+            while(grown <= rec.greeter) { grown *= 2; }
+            greeter_t **more = realloc(*greeters, grown * sizeof(greeter_t *));
+            if( ! more) { break; }
+            memset(more + *greeterCap, 0, (grown - *greeterCap) * sizeof(greeter_t *));
+            *greeters = more;
+            *greeterCap = grown;
+        }
+        if(rec.type == GREETER_CAPTURE_GREETER) {
+            greeterDestroy(&(*greeters)[rec.greeter]);
+            if( ! ((*greeters)[rec.greeter] = greeterCreate(rec.text))) { break; }
+            continue;
+        }
+        if( ! (*greeters)[rec.greeter]) {
+            rc = -1; // greeted before being described
+            break;
+        }
+        if(*n == cap) {
+            cap = cap ? 2 * cap : 1024;
+            greet_t *more = realloc(*greets, cap * sizeof(greet_t));
+            if( ! more) { break; }
+            *greets = more;
+        }
+        greet_t *g = &(*greets)[(*n)++];
+        g->time = rec.time;
+        g->greeter = rec.greeter;
+        g->name = rec.text ? strdup(rec.text) : NULL;
+        if(rec.text && ! g->name) { break; }
+    }
+    greeterCaptureClose(&r);
+    if( ! rc) { qsort(*greets, *n, sizeof(greet_t), byTime); }
+    return rc;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-f | -x speed] [-c csv] capture\n"
+        "  -f        replay as fast as possible\n"
+        "  -x speed  replay speed times faster than captured (default: 1)\n"
+        "  -c csv    write the latency histogram buckets as CSV\n"
+        "The logger writes every greeting to stderr; redirect it.\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int fast = 0, c;
+    double speed = 1;
+    const char *csv = NULL;
+    while((c = getopt(argc, argv, "fx:c:h")) != -1) {
+        switch(c) {
+            case 'f': fast = 1; break;
+            case 'x': speed = atof(optarg); break;
+            case 'c': csv = optarg; break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+    if(optind != argc - 1 || speed <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    const char *path = argv[optind];
+    greet_t *greets = NULL;
+    greeter_t **greeters = NULL;
+    size_t n = 0, greeterCap = 0;
+    int rc = load(path, &greets, &n, &greeters, &greeterCap);
+    histogram_t *latencies = histogramCreate();
+    if(rc || ! latencies) {
+        fprintf(stderr, "greeter_replay: cannot load %s%s\n", path, rc < 0 ? ": malformed capture" : "");
+        return 1;
+    }
+
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0); // wake up when due, not 50 us later
+    uint64_t start = nowNs();
+    for(size_t i = 0; i < n; ++i) {
+        uint64_t sent = nowNs();
+        if( ! fast) {
+            uint64_t due = start + (uint64_t)(greets[i].time / speed);
+            if(due > sent) { sleepUntil(due); }
+            sent = due;
+        }
+        greeterGreet(greeters[greets[i].greeter], greets[i].name);
+        histogramRecord(latencies, nowNs() - sent);
+    }
+    double seconds = (nowNs() - start) / 1e9;
+
+    double captured = n ? greets[n - 1].time / 1e9 : 0;
+    printf("%zu greetings captured over %.3f s, replayed %s in %.3f s\n", n, captured,
+           fast ? "as fast as possible" : "at pace", seconds);
+    printf("throughput: %.0f greetings/s\n", seconds > 0 ? n / seconds : 0.0);
+    printf("latency ns: min %llu  p50 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+           (unsigned long long)histogramMin(latencies), (unsigned long long)histogramPercentile(latencies, 50),
+           (unsigned long long)histogramPercentile(latencies, 99),
+           (unsigned long long)histogramPercentile(latencies, 99.9), (unsigned long long)histogramMax(latencies));
+    if(csv) {
+        FILE *f = fopen(csv, "w");
+        if(f) {
+            fprintf(f, "lowest_ns,highest_ns,count\n");
+            for(size_t i = 0; i < histogramBuckets(latencies); ++i) {
+                uint64_t lowest, highest, count = histogramBucket(latencies, i, &lowest, &highest);
+                if(count) {
+                    fprintf(f, "%llu,%llu,%llu\n", (unsigned long long)lowest, (unsigned long long)highest,
+                            (unsigned long long)count);
+                }
+            }
+        }
+        if( ! f || fclose(f)) {
+            perror(csv);
+            rc = 1;
+        }
+    }
+
+    for(size_t i = 0; i < n; ++i) { free(greets[i].name); }
+    free(greets);
+    for(size_t i = 0; i < greeterCap; ++i) { greeterDestroy(&greeters[i]); }
+    free(greeters);
+    histogramDestroy(&latencies);
+    return rc;
+}
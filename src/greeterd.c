@@ -0,0 +1,302 @@
+// greeterd.c
+// Greeting service: greet_proto.h over a Unix socket or per-core TCP, or
+// HTTP; optionally also over shared memory and UDP. Restarts without
+// refusing connections by handing the listeners over to a successor.
+#include "greet_handoff.h"
+#include "greet_server.h"
+#include "greet_shm_server.h"
+#include "greet_udp.h"
+#include "greeter_capture.h"
+#include "greeter_lang.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static greet_server_t *server;
+static greet_shm_server_t *shmServer;
+static greet_udp_server_t *udpServer;
+static greet_handoff_t *handoff;
+
+#define GREETERD_SNAPSHOT_VERSION 2
+
+// the warm state a successor starts from
+typedef struct greeterd_snapshot_t
+{
+    uint32_t version;
+    int32_t limit; // of the admission controller; 0 without one
+    // the fds handed over: the listeners of server, then the one of
+    // shmServer and the socket of udpServer if these are set
+    int32_t listeners, shm, udp;
+
+} greeterd_snapshot_t;
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    greetServerStop(server);
+    if(shmServer) { greetShmServerStop(shmServer); }
+    if(udpServer) { greetUdpServerStop(udpServer); }
+    if(handoff) { greetHandoffStop(handoff); }
+}
+
+static void *shmRun(void *arg)
+{
+    (void)arg;
+    if(greetShmServerRun(shmServer)) { greetServerStop(server); }
+    return NULL;
+}
+
+static void *udpRun(void *arg)
+{
+    (void)arg;
+    if(greetUdpServerRun(udpServer)) { greetServerStop(server); }
+    return NULL;
+}
+
+typedef struct handoff_state_t
+{
+    admission_t *admission;
+    greeterd_snapshot_t snapshot; // but the limit, known once handing over
+
+} handoff_state_t;
+
+static size_t snapshotTake(void *arg, void *buf)
+{
+    handoff_state_t *state = arg;
+    greeterd_snapshot_t *snapshot = buf;
+    *snapshot = state->snapshot;
+    if(state->admission) {
+        admission_stats_t st;
+        admissionStats(state->admission, &st);
+        snapshot->limit = st.limit;
+    }
+    return sizeof(*snapshot);
+}
+
+// hands the listeners over to the first successor, then drains
+static void *handoffRun(void *arg)
+{
+    handoff_state_t state = { .admission = arg, .snapshot = { .version = GREETERD_SNAPSHOT_VERSION } };
+    int fds[GREET_HANDOFF_MAX_FDS];
+    int n = greetServerListeners(server, fds, GREET_HANDOFF_MAX_FDS);
+    state.snapshot.listeners = n;
+    state.snapshot.shm = !! shmServer;
+    state.snapshot.udp = !! udpServer;
+    if(n + state.snapshot.shm + state.snapshot.udp > GREET_HANDOFF_MAX_FDS) {
+        fprintf(stderr, "handoff: %d listeners, more than the %d that can be handed over\n",
+                n + state.snapshot.shm + state.snapshot.udp, GREET_HANDOFF_MAX_FDS);
+        return NULL;
+    }
+    if(shmServer) { fds[n++] = greetShmServerListener(shmServer); }
+    if(udpServer) { fds[n++] = greetUdpServerSocket(udpServer); }
+    int rc = greetHandoffAccept(handoff, fds, n, snapshotTake, &state);
+    if( ! rc) {
+        greetServerDrain(server);
+        if(shmServer) { greetShmServerDrain(shmServer); }
+        // datagrams still queued stay on the socket, for the successor
+        if(udpServer) { greetUdpServerStop(udpServer); }
+    }
+    else if(rc < 0) { perror("handoff"); }
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-s socket | -p port] [-H host] [-w] [-m socket] [-u port]\n"
+        "          [-l lang | -g greeting] [-t threads] [-a ms] [-C socket [-R]]\n"
+        "          [-T capture]\n"
+        "  -s socket    Unix socket path (default: /tmp/greeterd.sock)\n"
+        "  -p port      per-core mode: a thread per CPU, each with its own\n"
+        "               SO_REUSEPORT listener on TCP port\n"
+        "  -H host      IPv4 address to listen on (default: 127.0.0.1)\n"
+        "  -w           serve HTTP/1.1 GET /greet?name= on socket or port\n"
+        "  -m socket    also serve shared-memory clients that connect here\n"
+        "  -u port      also answer datagrams on UDP port of host\n"
+        "  -l lang      greeting of a language from greetings.txt\n"
+        "  -g greeting  greeting to use (default: Hello)\n"
+        "  -t threads   I/O threads (default: 1, per-core mode: online CPUs)\n"
+        "  -a ms        shed requests under overload, with a queue delay\n"
+        "               target of ms milliseconds; counters go to stderr at exit\n"
+        "  -C socket    hand the listeners of -s or -p, -m and -u, and the\n"
+        "               admission limit, over to a successor that connects\n"
+        "               here, then drain\n"
+        "  -R           be that successor to the greeterd on the -C socket\n"
+        "  -T capture   record the names greeted to capture, for greeter_replay\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    greet_server_options_t opt = { .path = "/tmp/greeterd.sock", .greeting = "Hello" };
+    const char *shmPath = NULL, *host = "127.0.0.1";
+    const char *ctlPath = NULL, *capturePath = NULL;
+    int udpPort = -1, takeOver = 0, c;
+    double targetMs = 0;
+    while((c = getopt(argc, argv, "s:p:H:wm:u:l:g:t:a:C:RT:h")) != -1) {
+        switch(c) {
+            case 's': opt.path = optarg; break;
+            case 'p': opt.host = host; opt.port = atoi(optarg); break;
+            case 'H': host = optarg; break;
+            case 'w': opt.http = 1; break;
+            case 'm': shmPath = optarg; break;
+            case 'u': udpPort = atoi(optarg); break;
+            case 'l':
+                if( ! (opt.greeting = greeterLangGreeting(optarg))) {
+                    fprintf(stderr, "unsupported language: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'g': opt.greeting = optarg; break;
+            case 't': opt.threads = atoi(optarg); break;
+            case 'a': targetMs = atof(optarg); break;
+            case 'C': ctlPath = optarg; break;
+            case 'R': takeOver = 1; break;
+            case 'T': capturePath = optarg; break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+
+    if(takeOver && ! ctlPath) {
+        usage(argv[0]);
+        return 2;
+    }
+    int fds[GREET_HANDOFF_MAX_FDS], conn = -1, shmFd = -1, udpFd = -1;
+    greeterd_snapshot_t snapshot = { 0 };
+    if(takeOver) {
+        int n = GREET_HANDOFF_MAX_FDS;
+        size_t len = sizeof(snapshot);
+        if((conn = greetHandoffReceive(ctlPath, fds, &n, &snapshot, &len)) < 0) {
+            perror(ctlPath);
+            return 1;
+        }
+        if(len != sizeof(snapshot) || snapshot.version != GREETERD_SNAPSHOT_VERSION
+           || (uint32_t)snapshot.shm > 1 || (uint32_t)snapshot.udp > 1
+           || snapshot.listeners + snapshot.shm + snapshot.udp != n) {
+            // start cold, on what are then all listeners of an older version
+            snapshot = (greeterd_snapshot_t){ .listeners = n };
+        }
+        if(snapshot.shm) { shmFd = fds[snapshot.listeners]; }
+        if(snapshot.udp) { udpFd = fds[snapshot.listeners + snapshot.shm]; }
+        // without -m or -u the successor stops serving those
+        if(shmFd >= 0 && ! shmPath) { close(shmFd); }
+        if(udpFd >= 0 && udpPort < 0) { close(udpFd); }
+        opt.listenFds = fds;
+        opt.listenFdCount = snapshot.listeners;
+    }
+    if(targetMs > 0) {
+        admission_options_t admission = { .target = targetMs * 1e6, .interval = targetMs * 20e6,
+                                          .initialLimit = snapshot.limit };
+        if( ! (opt.admission = admissionCreate(&admission))) { return 1; }
+    }
+    if(opt.host) {
+        opt.host = host;
+        if( ! opt.threads) { opt.threads = sysconf(_SC_NPROCESSORS_ONLN); }
+    }
+    else if( ! takeOver) {
+        unlink(opt.path); // a socket left behind by an earlier run
+    }
+    if( ! (server = greetServerCreate(&opt))) {
+        perror(opt.host ? opt.host : opt.path);
+        return 1;
+    }
+    // Whatever can fail is set up before a successor commits: the
+    // predecessor drains from then on, and nothing would serve.
+    pthread_t shmThread, udpThread, handoffThread;
+    int rc = 0, shmStarted = 0, udpStarted = 0, handoffStarted = 0;
+    if(capturePath && greeterCaptureStart(capturePath)) {
+        perror(capturePath);
+        rc = -1;
+    }
+    if(shmPath && shmFd >= 0) {
+        if( ! (shmServer = greetShmServerInherit(shmFd, shmPath, opt.greeting, opt.admission))) {
+            perror(shmPath);
+            rc = -1;
+        }
+    }
+    else if(shmPath) {
+        unlink(shmPath);
+        if( ! (shmServer = greetShmServerCreate(shmPath, opt.greeting, opt.admission))) {
+            perror(shmPath);
+            rc = -1;
+        }
+    }
+    if(udpPort >= 0) {
+        greet_udp_options_t udp = { .host = host, .port = udpPort, .greeting = opt.greeting, .batch = 64,
+                                    .admission = opt.admission, .fd = udpFd >= 0 ? &udpFd : NULL };
+        if( ! (udpServer = greetUdpServerCreate(&udp))) {
+            perror(host);
+            rc = -1;
+        }
+    }
+    if(takeOver) {
+        // on failure the predecessor goes on serving its paths: leave them be
+        if( ! rc && greetHandoffCommit(conn)) {
+            perror(ctlPath);
+            rc = -1;
+        }
+        else if(rc) {
+            close(conn);
+        }
+        else {
+            greetServerAdopt(server);
+            if(shmServer && shmFd >= 0) { greetShmServerAdopt(shmServer); }
+        }
+    }
+    if(ctlPath && ! rc) {
+        unlink(ctlPath); // left behind by an earlier run, or by the predecessor
+        if( ! (handoff = greetHandoffCreate(ctlPath))) {
+            perror(ctlPath);
+            // a successor serves on all the same, only not handing over again
+            if( ! takeOver) { rc = -1; }
+        }
+    }
+    struct sigaction sa = { .sa_handler = onSignal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if(handoff && ! rc) {
+        rc = (handoffStarted = ! pthread_create(&handoffThread, NULL, handoffRun, opt.admission)) ? 0 : -1;
+    }
+    if(shmServer && ! rc) {
+        rc = (shmStarted = ! pthread_create(&shmThread, NULL, shmRun, NULL)) ? 0 : -1;
+    }
+    if(udpServer && ! rc) {
+        rc = (udpStarted = ! pthread_create(&udpThread, NULL, udpRun, NULL)) ? 0 : -1;
+    }
+    if( ! rc) { rc = greetServerRun(server); }
+    if(shmStarted) {
+        greetShmServerStop(shmServer);
+        pthread_join(shmThread, NULL);
+    }
+    if(udpStarted) {
+        greetUdpServerStop(udpServer);
+        pthread_join(udpThread, NULL);
+    }
+    if(handoffStarted) {
+        greetHandoffStop(handoff);
+        pthread_join(handoffThread, NULL);
+    }
+    greetHandoffDestroy(&handoff);
+    greetShmServerDestroy(&shmServer);
+    greetUdpServerDestroy(&udpServer);
+    greetServerDestroy(&server);
+    if(capturePath && greeterCaptureStop()) {
+        perror(capturePath);
+        rc = -1;
+    }
+    if(opt.admission) {
+        admission_stats_t st;
+        admissionStats(opt.admission, &st);
+        uint64_t seen = st.admitted + st.shedQueue + st.shedLimit;
+        fprintf(stderr, "greeterd: %llu admitted, %llu shed (%llu queue delay, %llu limit),"
+                        " queue delay avg %.3f ms max %.3f ms, limit %d\n",
+                (unsigned long long)st.admitted, (unsigned long long)(st.shedQueue + st.shedLimit),
+                (unsigned long long)st.shedQueue, (unsigned long long)st.shedLimit,
+                seen ? st.queueDelaySum / 1e6 / seen : 0.0, st.queueDelayMax / 1e6, st.limit);
+        admissionDestroy(&opt.admission);
+    }
+    return rc ? 1 : 0;
+}
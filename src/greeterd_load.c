@@ -0,0 +1,163 @@
+// greeterd_load.c
+// Load test for greeterd: every connection keeps a pipeline of requests in
+// flight from its own thread (one at a time over shared memory); reports throughput and latency percentiles.
+#include "greet_client.h"
+#include "greet_shm_client.h"
+#include "greet_proto.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+    const char *path; // or the host of port
+    int port;
+    int requests; // per connection
+    int depth;    // requests in flight per connection
+    int shm;      // path is a greet_shm_server
+    uint64_t *latencies; // ns, one per request
+    int failed;
+    int shed;  // answered GREET_OVERLOADED
+    pthread_t thread;
+
+} conn_load_t;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void *shmRun(conn_load_t *l)
+{
+    greet_shm_client_t *c = greetShmConnect(l->path);
+    char name[32];
+    int i = 0;
+    for(; c && i < l->requests; ++i) {
+        snprintf(name, sizeof(name), "user%d", i);
+        uint64_t sent = nowNs();
+        if( ! greetShmGreet(c, name)) {
+            if(errno != EAGAIN) { break; }
+            ++l->shed;
+        }
+        l->latencies[i] = nowNs() - sent;
+    }
+    l->failed = i < l->requests;
+    greetShmClose(&c);
+    return NULL;
+}
+
+static void *connRun(void *arg)
+{
+    conn_load_t *l = arg;
+    if(l->shm) { return shmRun(l); }
+    greet_client_t *c = l->port ? greetClientConnectTcp(l->path, l->port) : greetClientConnect(l->path);
+    uint64_t *sent = malloc(l->depth * sizeof(uint64_t));
+    if( ! c || ! sent) {
+        l->failed = 1;
+        free(sent);
+        greetClientClose(&c);
+        return NULL;
+    }
+    char name[32];
+    int issued = 0, done = 0;
+    while(done < l->requests) {
+        for(; issued < l->requests && issued - done < l->depth; ++issued) {
+            snprintf(name, sizeof(name), "user%d", issued);
+            sent[issued % l->depth] = nowNs();
+            if(greetClientSend(c, name)) { goto failed; }
+        }
+        if(greetClientFlush(c)) { goto failed; }
+        const char *greeting;
+        int status = greetClientRecv(c, &greeting);
+        if(status == GREET_OVERLOADED) { ++l->shed; }
+        else if(status != GREET_OK) { goto failed; }
+        l->latencies[done] = nowNs() - sent[done % l->depth];
+        ++done;
+    }
+    free(sent);
+    greetClientClose(&c);
+    return NULL;
+failed:
+    l->failed = 1;
+    free(sent);
+    greetClientClose(&c);
+    return NULL;
+}
+
+static int byValue(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const uint64_t *sorted, size_t n, double p)
+{
+    size_t i = (size_t)(p / 100 * n);
+    return sorted[i < n ? i : n - 1] / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "/tmp/greeterd.sock";
+    const char *host = "127.0.0.1";
+    int connections = 4, requests = 100000, depth = 16, shm = 0, port = 0, c;
+    while((c = getopt(argc, argv, "s:m:P:H:c:n:p:h")) != -1) {
+        switch(c) {
+            case 's': path = optarg; break;
+            case 'P': port = atoi(optarg); break;
+            case 'H': host = optarg; break;
+            case 'm': path = optarg; shm = 1; break;
+            case 'c': connections = atoi(optarg); break;
+            case 'n': requests = atoi(optarg); break;
+            case 'p': depth = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s socket | -m shm socket | -P port [-H host]] [-c connections] [-n requests per connection]"
+                                " [-p pipeline depth]\n", argv[0]);
+                return c == 'h' ? 0 : 2;
+        }
+    }
+    if(connections < 1 || requests < 1 || depth < 1) { return 2; }
+    if(port) { path = host; }
+
+    conn_load_t *loads = calloc(connections, sizeof(conn_load_t));
+    uint64_t *latencies = malloc((size_t)connections * requests * sizeof(uint64_t));
+    if( ! loads || ! latencies) { return 1; }
+    uint64_t start = nowNs();
+    for(int i = 0; i < connections; ++i) {
+        loads[i] = (conn_load_t){ .path = path, .port = port, .shm = shm,
+                                  .requests = requests, .depth = depth,
+                                  .latencies = latencies + (size_t)i * requests };
+        pthread_create(&loads[i].thread, NULL, connRun, &loads[i]);
+    }
+    int failed = 0;
+    long shed = 0;
+    for(int i = 0; i < connections; ++i) {
+        pthread_join(loads[i].thread, NULL);
+        failed |= loads[i].failed;
+        shed += loads[i].shed;
+    }
+    double seconds = (nowNs() - start) / 1e9;
+    if(failed) {
+        fprintf(stderr, "greeterd_load: requests to %s failed\n", path);
+        return 1;
+    }
+
+    size_t n = (size_t)connections * requests;
+    qsort(latencies, n, sizeof(uint64_t), byValue);
+    if(shm) { printf("%d connections x %d requests, shared memory\n", connections, requests); }
+    else { printf("%d connections x %d requests, pipeline depth %d\n", connections, requests, depth); }
+    printf("throughput: %.0f requests/s, %ld shed as overloaded\n", n / seconds, shed);
+    printf("latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+           percentile(latencies, n, 50), percentile(latencies, n, 99),
+           percentile(latencies, n, 99.9), latencies[n - 1] / 1000.0);
+    free(latencies);
+    free(loads);
+    return 0;
+}
@@ -0,0 +1,124 @@
+// histogram.c
+#include "histogram.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SUB (1u << HISTOGRAM_SUB_BITS)
+// a bucket index per sub-bucket of each power of two up to 2^63
+#define BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * SUB)
+
+struct histogram_t
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t counts[BUCKETS];
+};
+
+// values below SUB map to themselves; above, to a bucket of width 2^shift
+// in the power of two of their top bit
+static size_t bucketOf(uint64_t value)
+{
+    if(value < SUB) { return value; }
+    int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+    return (size_t)shift * SUB + (value >> shift);
+}
+
+histogram_t *histogramCreate(void)
+{
+    histogram_t *self = malloc(sizeof(histogram_t));
+    if(self) { histogramReset(self); }
+    return self;
+}
+
+void histogramDestroy(histogram_t **self)
+{
+    assert(self);
+    free(*self);
+    *self = NULL;
+}
+
+void histogramReset(histogram_t *self)
+{
+    memset(self, 0, sizeof(*self));
+    self->min = UINT64_MAX;
+}
+
+void histogramRecord(histogram_t *self, uint64_t value)
+{
+    ++self->counts[bucketOf(value)];
+    ++self->count;
+    self->sum += value;
+    if(value < self->min) { self->min = value; }
+    if(value > self->max) { self->max = value; }
+}
+
+void histogramAdd(histogram_t *self, const histogram_t *other)
+{
+    for(size_t i = 0; i < BUCKETS; ++i) { self->counts[i] += other->counts[i]; }
+    self->count += other->count;
+    self->sum += other->sum;
+    if(other->min < self->min) { self->min = other->min; }
+    if(other->max > self->max) { self->max = other->max; }
+}
+
+uint64_t histogramCount(const histogram_t *self)
+{
+    return self->count;
+}
+
+uint64_t histogramMin(const histogram_t *self)
+{
+    return self->count ? self->min : 0;
+}
+
+uint64_t histogramMax(const histogram_t *self)
+{
+    return self->max;
+}
+
+double histogramMean(const histogram_t *self)
+{
+    return self->count ? self->sum / self->count : 0;
+}
+
+uint64_t histogramPercentile(const histogram_t *self, double p)
+{
+    if( ! self->count) { return 0; }
+    uint64_t rank = (uint64_t)(p / 100 * self->count + 0.5);
+    if(rank < 1) { rank = 1; }
+    if(rank > self->count) { rank = self->count; }
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        seen += self->counts[i];
+        if(seen >= rank) {
+            uint64_t lowest, highest;
+            histogramBucket(self, i, &lowest, &highest);
+            if(highest > self->max) { highest = self->max; }
+            return highest < self->min ? self->min : highest;
+        }
+    }
+    return self->max;
+}
+
+size_t histogramBuckets(const histogram_t *self)
+{
+    (void)self;
+    return BUCKETS;
+}
+
+uint64_t histogramBucket(const histogram_t *self, size_t i, uint64_t *lowest, uint64_t *highest)
+{
+    if(i < SUB) {
+        *lowest = *highest = i;
+    }
+    else {
+        int shift = i / SUB - 1;
+        uint64_t mantissa = i % SUB + SUB;
+        *lowest = mantissa << shift;
+        *highest = *lowest + ((uint64_t)1 << shift) - 1;
+    }
+    return self->counts[i];
+}
@@ -0,0 +1,38 @@
+// histogram.h
+// Log-linear latency histogram, HdrHistogram style: values below
+// 2^HISTOGRAM_SUB_BITS are counted exactly, larger ones in buckets no wider
+// than 1/2^HISTOGRAM_SUB_BITS of their value (under 0.8% error), over the
+// whole uint64_t range in fixed memory. Recording is a few instructions;
+// merge per-thread histograms with histogramAdd() rather than sharing one.
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS 7
+
+typedef struct histogram_t histogram_t;
+
+histogram_t *histogramCreate(void);
+void histogramDestroy(histogram_t **self);
+void histogramReset(histogram_t *self);
+
+void histogramRecord(histogram_t *self, uint64_t value);
+// adds the counts of other to self
+void histogramAdd(histogram_t *self, const histogram_t *other);
+
+uint64_t histogramCount(const histogram_t *self);
+uint64_t histogramMin(const histogram_t *self);
+uint64_t histogramMax(const histogram_t *self);
+double histogramMean(const histogram_t *self);
+// The highest value counted with the lowest p percent of the values, up
+// to the precision of its bucket; 0 if empty.
+uint64_t histogramPercentile(const histogram_t *self, double p);
+
+// Buckets for dumping: their number, and the count and value range of
+// bucket i.
+size_t histogramBuckets(const histogram_t *self);
+uint64_t histogramBucket(const histogram_t *self, size_t i, uint64_t *lowest, uint64_t *highest);
+
+#endif // HISTOGRAM_H_
@@ -0,0 +1,268 @@
+// loadgen.c
+// Load generator for greeter and its logger, in process: every thread
+// greets names of configurable length with a weighted mix of greetings.
+// Closed loop greets back to back for maximum throughput; open loop greets
+// at a fixed total rate, and measures each latency from when the request
+// was due rather than when it was sent, so a stall is charged to every
+// request it delayed (no coordinated omission).
+#include "greeter.h"
+#include "histogram.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#define MAX_GREETINGS 16
+#define NAMES 1024 // per thread, generated before timing
+
+typedef struct
+{
+    const char *greeting;
+    unsigned weight;
+
+} greeting_mix_t;
+
+typedef struct
+{
+    const greeting_mix_t *mix;
+    int mixLen;
+    unsigned totalWeight;
+    int minLen, maxLen;
+    uint64_t start, end;   // ns
+    uint64_t interval;     // ns between requests of this thread; 0 for closed loop
+    uint64_t offset;       // ns of the first due time after start
+    uint64_t seed;
+    histogram_t *latencies;
+    uint64_t requests;
+    int failed;
+    pthread_t thread;
+
+} thread_load_t;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void sleepUntil(uint64_t ns)
+{
+    struct timespec ts = { ns / 1000000000u, ns % 1000000000u };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {}
+}
+
+static uint64_t xorshift(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void *threadRun(void *arg)
+{
+    thread_load_t *l = arg;
+    greeter_t *greeters[MAX_GREETINGS] = { 0 };
+    char *names = malloc((size_t)NAMES * (l->maxLen + 1));
+    uint8_t *picks = malloc(NAMES);
+    l->failed = ! names || ! picks;
+    for(int i = 0; i < l->mixLen && ! l->failed; ++i) {
+        l->failed = ! (greeters[i] = greeterCreate(l->mix[i].greeting));
+    }
+    for(int i = 0; i < NAMES && ! l->failed; ++i) {
+        char *name = names + (size_t)i * (l->maxLen + 1);
+        int len = l->minLen + xorshift(&l->seed) % (l->maxLen - l->minLen + 1);
+        for(int j = 0; j < len; ++j) { name[j] = 'a' + xorshift(&l->seed) % 26; }
+        name[len] = '\0';
+        unsigned w = xorshift(&l->seed) % l->totalWeight;
+        int g = 0;
+        while(w >= l->mix[g].weight) { w -= l->mix[g++].weight; }
+        picks[i] = g;
+    }
+
+    // wake up on time, not up to the default 50 us late, which open loop
+    // would count as latency
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+    uint64_t due = l->start + l->offset;
+    sleepUntil(l->start);
+    for(uint64_t i = 0; ! l->failed; ++i) {
+        uint64_t sent;
+        if(l->interval) {
+            if(due >= l->end) { break; }
+            if(due > nowNs()) { sleepUntil(due); } // else behind: catch up
+            sent = due;
+            due += l->interval;
+        }
+        else if((sent = nowNs()) >= l->end) { break; }
+        int n = i % NAMES;
+        if( ! greeterGreet(greeters[picks[n]], names + (size_t)n * (l->maxLen + 1))) { l->failed = 1; }
+        histogramRecord(l->latencies, nowNs() - sent);
+        ++l->requests;
+    }
+
+    for(int i = 0; i < l->mixLen; ++i) { greeterDestroy(&greeters[i]); }
+    free(names);
+    free(picks);
+    return NULL;
+}
+
+// "Hello:3,Hola,Bonjour:2": greetings with optional weights, default 1
+static int parseMix(char *spec, greeting_mix_t *mix)
+{
+    int n = 0;
+    for(char *save = NULL, *item = strtok_r(spec, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if(n == MAX_GREETINGS) { return -1; }
+        char *colon = strrchr(item, ':');
+        mix[n].weight = 1;
+        if(colon) {
+            *colon = '\0';
+            mix[n].weight = atoi(colon + 1);
+            if( ! mix[n].weight) { return -1; }
+        }
+        mix[n++].greeting = item;
+    }
+    return n;
+}
+
+static const double kPercentiles[] = { 50, 90, 99, 99.9, 99.99, 100 };
+
+static int writeCsv(const char *path, const histogram_t *h)
+{
+    FILE *f = fopen(path, "w");
+    if( ! f) { return -1; }
+    fprintf(f, "lowest_ns,highest_ns,count,cumulative\n");
+    uint64_t seen = 0;
+    for(size_t i = 0; i < histogramBuckets(h); ++i) {
+        uint64_t lowest, highest, count = histogramBucket(h, i, &lowest, &highest);
+        if( ! count) { continue; }
+        seen += count;
+        fprintf(f, "%llu,%llu,%llu,%.6f\n", (unsigned long long)lowest, (unsigned long long)highest,
+                (unsigned long long)count, (double)seen / histogramCount(h));
+    }
+    return fclose(f);
+}
+
+static int writeJson(const char *path, const histogram_t *h, int threads, double rate, double seconds)
+{
+    FILE *f = fopen(path, "w");
+    if( ! f) { return -1; }
+    uint64_t n = histogramCount(h);
+    fprintf(f, "{\n  \"mode\": \"%s\",\n  \"threads\": %d,\n  \"rate\": %.0f,\n  \"seconds\": %.3f,\n"
+               "  \"requests\": %llu,\n  \"throughput\": %.1f,\n  \"latency_ns\": {\n"
+               "    \"min\": %llu,\n    \"mean\": %.1f,\n",
+            rate > 0 ? "open" : "closed", threads, rate, seconds, (unsigned long long)n, n / seconds,
+            (unsigned long long)histogramMin(h), histogramMean(h));
+    for(size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); ++i) {
+        fprintf(f, "    \"p%g\": %llu,\n", kPercentiles[i], (unsigned long long)histogramPercentile(h, kPercentiles[i]));
+    }
+    fprintf(f, "    \"max\": %llu\n  },\n  \"buckets\": [", (unsigned long long)histogramMax(h));
+    const char *sep = "";
+    for(size_t i = 0; i < histogramBuckets(h); ++i) {
+        uint64_t lowest, highest, count = histogramBucket(h, i, &lowest, &highest);
+        if( ! count) { continue; }
+        fprintf(f, "%s\n    [%llu, %llu, %llu]", sep, (unsigned long long)lowest, (unsigned long long)highest,
+                (unsigned long long)count);
+        sep = ",";
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-t threads] [-d seconds] [-r rate] [-l min[-max]] [-g mix] [-c csv] [-j json]\n"
+        "  -t threads   greeting threads (default: 1)\n"
+        "  -d seconds   duration (default: 5)\n"
+        "  -r rate      open loop at rate requests/s in total; 0 for closed loop (default)\n"
+        "  -l min-max   name lengths, uniformly distributed (default: 3-12)\n"
+        "  -g mix       greetings with weights, e.g. Hello:3,Hola,Bonjour:2 (default: Hello)\n"
+        "  -c csv       write the latency histogram buckets as CSV\n"
+        "  -j json      write the results and histogram buckets as JSON\n"
+        "The logger writes every greeting to stderr; redirect it.\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 1, minLen = 3, maxLen = 12, c;
+    double seconds = 5, rate = 0;
+    char defaultMix[] = "Hello", *mixSpec = defaultMix;
+    const char *csv = NULL, *json = NULL;
+    while((c = getopt(argc, argv, "t:d:r:l:g:c:j:h")) != -1) {
+        switch(c) {
+            case 't': threads = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 'l':
+                if(sscanf(optarg, "%d-%d", &minLen, &maxLen) == 1) { maxLen = minLen; }
+                break;
+            case 'g': mixSpec = optarg; break;
+            case 'c': csv = optarg; break;
+            case 'j': json = optarg; break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+    greeting_mix_t mix[MAX_GREETINGS];
+    int mixLen = parseMix(mixSpec, mix);
+    if(threads < 1 || seconds <= 0 || rate < 0 || minLen < 0 || maxLen < minLen || mixLen < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    unsigned totalWeight = 0;
+    for(int i = 0; i < mixLen; ++i) { totalWeight += mix[i].weight; }
+
+    thread_load_t *loads = calloc(threads, sizeof(thread_load_t));
+    histogram_t *all = histogramCreate();
+    if( ! loads || ! all) { return 1; }
+    // leave the threads time to generate their names before the start
+    uint64_t start = nowNs() + 100000000u, end = start + (uint64_t)(seconds * 1e9);
+    uint64_t interval = rate > 0 ? (uint64_t)(threads * 1e9 / rate) : 0;
+    for(int i = 0; i < threads; ++i) {
+        loads[i] = (thread_load_t){ .mix = mix, .mixLen = mixLen, .totalWeight = totalWeight,
+                                    .minLen = minLen, .maxLen = maxLen, .start = start, .end = end,
+                                    .interval = interval, .offset = interval * i / threads,
+                                    .seed = 0x9e3779b97f4a7c15u * (i + 1), .latencies = histogramCreate() };
+        if( ! loads[i].latencies || pthread_create(&loads[i].thread, NULL, threadRun, &loads[i])) { return 1; }
+    }
+    int failed = 0;
+    for(int i = 0; i < threads; ++i) {
+        pthread_join(loads[i].thread, NULL);
+        failed |= loads[i].failed;
+        histogramAdd(all, loads[i].latencies);
+        histogramDestroy(&loads[i].latencies);
+    }
+    // open loop behind schedule finishes late
+    double elapsed = (nowNs() - start) / 1e9;
+    if(failed) {
+        fprintf(stderr, "loadgen: greeting failed\n");
+        return 1;
+    }
+
+    uint64_t n = histogramCount(all);
+    if(rate > 0) { printf("open loop at %.0f requests/s, %d threads, %.1f s\n", rate, threads, seconds); }
+    else { printf("closed loop, %d threads, %.1f s\n", threads, seconds); }
+    printf("requests: %llu in %.2f s, throughput: %.0f requests/s\n", (unsigned long long)n, elapsed, n / elapsed);
+    printf("latency ns: min %llu  mean %.0f", (unsigned long long)histogramMin(all), histogramMean(all));
+    for(size_t i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]) - 1; ++i) {
+        printf("  p%g %llu", kPercentiles[i], (unsigned long long)histogramPercentile(all, kPercentiles[i]));
+    }
+    printf("  max %llu\n", (unsigned long long)histogramMax(all));
+    int rc = 0;
+    if(csv && writeCsv(csv, all)) {
+        perror(csv);
+        rc = 1;
+    }
+    if(json && writeJson(json, all, threads, rate, elapsed)) {
+        perror(json);
+        rc = 1;
+    }
+    histogramDestroy(&all);
+    free(loads);
+    return rc;
+}
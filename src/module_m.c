@@ -1,9 +1,107 @@
 // module_m.c
 #include "greeter.h"
+#include "greeter_lang.h"
+#include "batch.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-int main()
+static void usage(const char *prog)
 {
-    greeter_t *g __attribute__((cleanup(greeterDestroy))) = greeterCreate("Hellloooo");
+    fprintf(stderr,
+        "usage: %s [-l lang | -g greeting | lang]\n"
+        "       %s [-l lang | -g greeting] -s [-f lines|nul|len] [-b bytes] [-j threads] [-e engine [-d depth]] [-q] [file]\n"
+        "  -l lang      greeting of a language from greetings.txt; also as the argument without -s\n"
+        "  -g greeting  greeting to use (default: Hellloooo)\n"
+        "  -s           stream: greet every line of file (default: stdin) to stdout\n"
+        "  -f framing   output framing: lines, nul or len (32-bit big-endian prefix)\n"
+        "  -b bytes     output buffer size\n"
+        "  -j threads   greet a regular file with this many worker threads\n"
+        "  -e engine    regular file I/O: mmap, pread or uring (pread without io_uring)\n"
+        "  -d depth     io_uring reads in flight\n"
+        "  -q           no progress and throughput on stderr\n", prog, prog);
+}
+
+static int parseFraming(const char *s, batch_framing_t *framing)
+{
+    if( ! strcmp(s, "lines")) { *framing = BATCH_LINES; }
+    else if( ! strcmp(s, "nul")) { *framing = BATCH_NUL; }
+    else if( ! strcmp(s, "len")) { *framing = BATCH_LENGTH; }
+    else { return -1; }
+    return 0;
+}
+
+static int parseEngine(const char *s, batch_io_t *io)
+{
+    if( ! strcmp(s, "mmap")) { *io = BATCH_IO_MMAP; }
+    else if( ! strcmp(s, "pread")) { *io = BATCH_IO_PREAD; }
+    else if( ! strcmp(s, "uring")) { *io = BATCH_IO_URING; }
+    else { return -1; }
+    return 0;
+}
+
+static int stream(const greeter_t *g, const char *path, const batch_options_t *opt)
+{
+    int in = (path && strcmp(path, "-")) ? open(path, O_RDONLY) : STDIN_FILENO;
+    if(in < 0) {
+        perror(path);
+        return 1;
+    }
+    batch_stats_t stats = { 0 }; // batchGreet can fail before filling it
+    int rc = batchGreet(g, in, STDOUT_FILENO, opt, &stats);
+    if(rc) { perror("module_m"); }
+    if(in != STDIN_FILENO) { close(in); }
+    if(opt->progress) {
+        static const char *engines[] = { "mmap", "pread", "uring" };
+        fprintf(stderr, "module_m: %s, %llu names, %llu bytes in, %llu bytes out, %.3f s, %.2f GB/s out\n",
+                engines[stats.io], (unsigned long long)stats.names, (unsigned long long)stats.bytesIn,
+                (unsigned long long)stats.bytesOut, stats.seconds,
+                stats.seconds > 0 ? stats.bytesOut / stats.seconds / 1e9 : 0.0);
+    }
+    return rc ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *lang = NULL, *greeting = "Hellloooo";
+    batch_options_t opt = { .framing = BATCH_LINES, .progress = 1 };
+    int streaming = 0, c;
+    while((c = getopt(argc, argv, "l:g:sf:b:j:e:d:qh")) != -1) {
+        switch(c) {
+            case 'l': lang = optarg; break;
+            case 'g': greeting = optarg; break;
+            case 's': streaming = 1; break;
+            case 'f':
+                if(parseFraming(optarg, &opt.framing)) { usage(argv[0]); return 2; }
+                break;
+            case 'b': opt.bufferSize = strtoull(optarg, NULL, 0); break;
+            case 'j': opt.threads = strtoul(optarg, NULL, 0); break;
+            case 'e':
+                if(parseEngine(optarg, &opt.io)) { usage(argv[0]); return 2; }
+                break;
+            case 'd': opt.queueDepth = strtoul(optarg, NULL, 0); break;
+            case 'q': opt.progress = 0; break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+
+    // without -s, the argument is the language, as before the options
+    if( ! streaming && optind < argc && ! lang) { lang = argv[optind++]; }
+    if(optind < argc - streaming) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    greeter_t *g __attribute__((cleanup(greeterDestroy))) =
+        lang ? greeterCreateForLang(lang) : greeterCreate(greeting);
+    if( ! g) {
+        fprintf(stderr, "unsupported language: %s\n", lang);
+        return 1;
+    }
+    if(streaming) {
+        return stream(g, optind < argc ? argv[optind] : NULL, &opt);
+    }
     printf("%s\n", greeterGreet(g, "Woooorld"));
 }
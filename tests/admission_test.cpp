@@ -0,0 +1,283 @@
+// admission_test.cpp
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+extern "C" {
+#include "admission.h"
+#include "greet_server.h"
+#include "greet_client.h"
+#include "greet_proto.h"
+}
+#include "logger_mock.hpp"
+
+using ::testing::_;
+using ::testing::Invoke;
+
+static const uint64_t MS = 1000000;
+static const uint64_t T0 = 1000 * MS; // any start will do, the clock is ours
+
+class AdmissionTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        admission_options_t opt = { 5 * MS, 100 * MS, 2, 1, 4 };
+        a_ = admissionCreate(&opt);
+        ASSERT_NE(a_, nullptr);
+    }
+
+    void TearDown() override {
+        admissionDestroy(&a_);
+        EXPECT_EQ(a_, nullptr);
+    }
+
+    admission_stats_t Stats() {
+        admission_stats_t stats;
+        admissionStats(a_, &stats);
+        return stats;
+    }
+
+    // a request that waited delay, served at once
+    admission_verdict_t Serve(uint64_t now, uint64_t delay) {
+        admission_verdict_t v = admissionAcquire(a_, now - delay, now);
+        if(v == ADMISSION_ADMIT) { admissionRelease(a_); }
+        return v;
+    }
+
+    admission_t *a_ = nullptr;
+};
+
+// the server releases a request once its response is sent, which may be
+// after the client has it
+static admission_stats_t SettledStats(admission_t *admission)
+{
+    admission_stats_t stats;
+    for(int i = 0; i < 100; ++i) {
+        admissionStats(admission, &stats);
+        if( ! stats.inflight) { break; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return stats;
+}
+
+TEST_F(AdmissionTest, AdmitsFreshRequests)
+{
+    EXPECT_EQ(Serve(T0, 0), ADMISSION_ADMIT);
+    EXPECT_EQ(Serve(T0, 3 * MS), ADMISSION_ADMIT);
+    admission_stats_t s = Stats();
+    EXPECT_EQ(s.admitted, 2u);
+    EXPECT_EQ(s.shedQueue + s.shedLimit, 0u);
+    EXPECT_EQ(s.queueDelaySum, 3 * MS);
+    EXPECT_EQ(s.queueDelayMax, 3 * MS);
+    EXPECT_EQ(s.inflight, 0);
+}
+
+TEST_F(AdmissionTest, ShedsOnlyVeryLongWaitsWhileNotOverloaded)
+{
+    EXPECT_EQ(Serve(T0, 50 * MS), ADMISSION_ADMIT);
+    EXPECT_EQ(Serve(T0, 150 * MS), ADMISSION_SHED_QUEUE);
+    EXPECT_EQ(Stats().overloaded, 0);
+}
+
+TEST_F(AdmissionTest, AStandingQueueMeansOverload)
+{
+    // 10 ms of delay, above target, for a whole interval
+    uint64_t now = T0;
+    for(; now < T0 + 100 * MS; now += 10 * MS) {
+        EXPECT_EQ(Serve(now, 10 * MS), ADMISSION_ADMIT);
+    }
+    EXPECT_EQ(Serve(now, 10 * MS), ADMISSION_SHED_QUEUE);
+    EXPECT_EQ(Stats().overloaded, 1);
+    EXPECT_EQ(Serve(now, 4 * MS), ADMISSION_ADMIT); // under target
+
+    // the queue drained below target within the next interval
+    now += 100 * MS;
+    EXPECT_EQ(Serve(now, 10 * MS), ADMISSION_ADMIT);
+    EXPECT_EQ(Stats().overloaded, 0);
+}
+
+TEST_F(AdmissionTest, LimitsConcurrency)
+{
+    EXPECT_EQ(admissionAcquire(a_, T0, T0), ADMISSION_ADMIT);
+    EXPECT_EQ(admissionAcquire(a_, T0, T0), ADMISSION_ADMIT);
+    EXPECT_EQ(admissionAcquire(a_, T0, T0), ADMISSION_SHED_LIMIT);
+    EXPECT_EQ(Stats().inflight, 2);
+    admissionRelease(a_);
+    EXPECT_EQ(admissionAcquire(a_, T0, T0), ADMISSION_ADMIT);
+    admissionRelease(a_);
+    admissionRelease(a_);
+    EXPECT_EQ(Stats().shedLimit, 1u);
+}
+
+TEST_F(AdmissionTest, LimitGrowsAdditivelyAndShrinksMultiplicatively)
+{
+    // fills the limit, then lets everything complete
+    auto saturate = [this] {
+        int admitted = 0;
+        while(admissionAcquire(a_, T0, T0) == ADMISSION_ADMIT) { ++admitted; }
+        while(admitted--) { admissionRelease(a_); }
+    };
+    saturate(); // 2 -> 2.5
+    saturate(); // 2.5 -> 2.9
+    EXPECT_EQ(Stats().limit, 2);
+    saturate();
+    EXPECT_EQ(Stats().limit, 3);
+    for(int i = 0; i < 20; ++i) { saturate(); }
+    EXPECT_EQ(Stats().limit, 4); // capped at maxLimit
+
+    // overloaded: down by a tenth, once per interval; the first request
+    // closes the interval of the saturation above
+    const uint64_t t1 = T0 + 1000 * MS;
+    uint64_t now = t1;
+    for(; now <= t1 + 100 * MS; now += 10 * MS) { Serve(now, 10 * MS); }
+    EXPECT_EQ(Stats().overloaded, 1);
+    EXPECT_EQ(Stats().limit, 3);
+    Serve(now + 50 * MS, 10 * MS);
+    EXPECT_EQ(Stats().limit, 3);
+    now += 100 * MS;
+    for(; now <= t1 + 400 * MS; now += 10 * MS) { Serve(now, 10 * MS); }
+    EXPECT_EQ(Stats().limit, 2);
+}
+
+TEST(AdmissionClockTest, ANowLaggingAnotherThreadsCutsNoMore)
+{
+    admission_options_t opt = { 5 * MS, 100 * MS, 90, 1, 1024 };
+    admission_t *a = admissionCreate(&opt);
+    ASSERT_NE(a, nullptr);
+    uint64_t now = T0;
+    for(; now <= T0 + 100 * MS; now += 10 * MS) {
+        if(admissionAcquire(a, now - 10 * MS, now) == ADMISSION_ADMIT) { admissionRelease(a); }
+    }
+    admission_stats_t s;
+    admissionStats(a, &s);
+    EXPECT_EQ(s.overloaded, 1);
+    EXPECT_EQ(s.limit, 81);
+    // other threads, their now read a few ns before the decrease above
+    now -= 10 * MS;
+    for(uint64_t lag = 1; lag <= 4; ++lag) {
+        if(admissionAcquire(a, now - lag - 10 * MS, now - lag) == ADMISSION_ADMIT) { admissionRelease(a); }
+    }
+    admissionStats(a, &s);
+    EXPECT_EQ(s.overloaded, 1);
+    EXPECT_EQ(s.limit, 81);
+    admissionDestroy(&a);
+}
+
+// A logger that takes 2 ms per line drives a greeterd thread into overload
+// with a burst of pipelined requests.
+TEST(AdmissionOverloadTest, ShedsUnderASlowLogger)
+{
+    LoggerMock logger;
+    EXPECT_CALL(logger, LoggerWriteLog(_)).WillRepeatedly(Invoke([](const char *) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return 0;
+    }));
+    admission_options_t aopt = { 1 * MS, 20 * MS, 0, 0, 0 };
+    admission_t *admission = admissionCreate(&aopt);
+    ASSERT_NE(admission, nullptr);
+    std::string path = "/tmp/admission_test." + std::to_string(getpid()) + ".sock";
+    greet_server_options_t opt = {};
+    opt.path = path.c_str();
+    opt.greeting = "Hello";
+    opt.threads = 1;
+    opt.admission = admission;
+    greet_server_t *server = greetServerCreate(&opt);
+    ASSERT_NE(server, nullptr);
+    std::thread thread([server] { greetServerRun(server); });
+
+    greet_client_t *c = greetClientConnect(path.c_str());
+    ASSERT_NE(c, nullptr);
+    const int n = 200;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < n; ++i) { ASSERT_EQ(greetClientSend(c, std::to_string(i).c_str()), 0); }
+    ASSERT_EQ(greetClientFlush(c), 0);
+    int ok = 0, overloaded = 0;
+    for(int i = 0; i < n; ++i) {
+        const char *greeting;
+        int status = greetClientRecv(c, &greeting);
+        if(status == GREET_OK) {
+            EXPECT_EQ(greeting, "Hello, " + std::to_string(i) + "!");
+            ++ok;
+        }
+        else {
+            EXPECT_EQ(status, GREET_OVERLOADED);
+            EXPECT_STREQ(greeting, "");
+            ++overloaded;
+        }
+        if(i == 0) { EXPECT_EQ(status, GREET_OK); }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GT(ok, 0);
+    EXPECT_GT(overloaded, n / 2);
+    // shedding is fast: half the 2 ms per request of serving everyone
+    EXPECT_LT(elapsed, std::chrono::milliseconds(n));
+
+    admission_stats_t stats = SettledStats(admission);
+    EXPECT_EQ(stats.admitted, (uint64_t)ok);
+    EXPECT_EQ(stats.shedQueue + stats.shedLimit, (uint64_t)overloaded);
+    EXPECT_GE(stats.queueDelayMax, 20 * MS);
+    EXPECT_EQ(stats.inflight, 0);
+
+    // once the burst is over, requests are served again
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hello, Tom!");
+
+    greetClientClose(&c);
+    greetServerStop(server);
+    thread.join();
+    greetServerDestroy(&server);
+    admissionDestroy(&admission);
+}
+
+// Pipelined requests are in flight until their responses are sent, so a
+// burst over the limit is shed even though a thread greets one at a time.
+TEST(AdmissionOverloadTest, ShedsPipelinedRequestsOverTheLimit)
+{
+    LoggerMock logger;
+    EXPECT_CALL(logger, LoggerWriteLog(_)).WillRepeatedly(::testing::Return(0));
+    // no queue delay shedding within seconds; a limit of 4 that cannot grow
+    admission_options_t aopt = { 1000 * MS, 10000 * MS, 4, 1, 4 };
+    admission_t *admission = admissionCreate(&aopt);
+    ASSERT_NE(admission, nullptr);
+    std::string path = "/tmp/admission_test." + std::to_string(getpid()) + ".limit.sock";
+    greet_server_options_t opt = {};
+    opt.path = path.c_str();
+    opt.greeting = "Hello";
+    opt.threads = 1;
+    opt.admission = admission;
+    greet_server_t *server = greetServerCreate(&opt);
+    ASSERT_NE(server, nullptr);
+    std::thread thread([server] { greetServerRun(server); });
+
+    greet_client_t *c = greetClientConnect(path.c_str());
+    ASSERT_NE(c, nullptr);
+    const int n = 32;
+    for(int i = 0; i < n; ++i) { ASSERT_EQ(greetClientSend(c, std::to_string(i).c_str()), 0); }
+    ASSERT_EQ(greetClientFlush(c), 0);
+    int ok = 0;
+    for(int i = 0; i < n; ++i) {
+        const char *greeting;
+        int status = greetClientRecv(c, &greeting);
+        ASSERT_TRUE(status == GREET_OK || status == GREET_OVERLOADED) << status;
+        ok += status == GREET_OK;
+    }
+    EXPECT_GE(ok, 4);
+    EXPECT_LT(ok, n);
+
+    admission_stats_t stats = SettledStats(admission);
+    EXPECT_EQ(stats.admitted, (uint64_t)ok);
+    EXPECT_EQ(stats.shedLimit, (uint64_t)(n - ok));
+    EXPECT_EQ(stats.shedQueue, 0u);
+    EXPECT_EQ(stats.inflight, 0);
+
+    // one at a time is never over the limit
+    EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hello, Tom!");
+
+    greetClientClose(&c);
+    greetServerStop(server);
+    thread.join();
+    greetServerDestroy(&server);
+    admissionDestroy(&admission);
+}
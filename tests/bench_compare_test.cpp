@@ -0,0 +1,101 @@
+// bench_compare_test.cpp
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <unistd.h>
+#include "bench.hpp"
+#include "bench_compare.hpp"
+
+TEST(MannWhitneyTest, SeparatedSamplesAreSignificant)
+{
+    // scipy.stats.mannwhitneyu(a, b, method="asymptotic"): U 0, p 0.01219
+    bench::MannWhitney r = bench::MannWhitneyU({ 1, 2, 3, 4, 5 }, { 6, 7, 8, 9, 10 });
+    EXPECT_EQ(r.u, 0);
+    EXPECT_LT(r.z, 0);
+    EXPECT_NEAR(r.p, 0.01219, 1e-4);
+    EXPECT_EQ(bench::MannWhitneyU({ 6, 7, 8, 9, 10 }, { 1, 2, 3, 4, 5 }).u, 25);
+}
+
+TEST(MannWhitneyTest, InterleavedSamplesAreNot)
+{
+    bench::MannWhitney r = bench::MannWhitneyU({ 1, 3, 5, 7, 9 }, { 2, 4, 6, 8, 10 });
+    EXPECT_GT(r.p, 0.5);
+}
+
+TEST(MannWhitneyTest, TiesShareRanks)
+{
+    // each tied pair counts half a win
+    bench::MannWhitney r = bench::MannWhitneyU({ 1, 2, 2 }, { 2, 3, 4 });
+    EXPECT_EQ(r.u, 1);
+    EXPECT_GT(r.p, 0.05);
+    EXPECT_EQ(bench::MannWhitneyU({ 5, 5 }, { 5, 5 }).p, 1);
+    EXPECT_EQ(bench::MannWhitneyU({}, { 1 }).p, 1);
+}
+
+TEST(MannWhitneyTest, OneOutlierDoesNotDecide)
+{
+    // a preempted sample moves the mean, not the ranks
+    std::vector<double> base = { 10, 11, 10, 12, 11, 10, 11, 12, 10, 11 };
+    std::vector<double> same = base;
+    same[3] = 500;
+    EXPECT_GT(bench::MannWhitneyU(same, base).p, 0.5);
+    std::vector<double> slower;
+    for(double v : base) { slower.push_back(v + 3); }
+    EXPECT_LT(bench::MannWhitneyU(slower, base).p, 0.01);
+}
+
+TEST(JsonParserTest, ParsesValues)
+{
+    std::string text = R"({"a": [1, -2.5e1, true, false, null], "b": {"c": "x\"\\\nqA"}, "d": {}, "e": []})";
+    bench::Json v;
+    ASSERT_TRUE(bench::JsonParser(text).Parse(&v));
+    ASSERT_EQ(v["a"].items.size(), 5u);
+    EXPECT_EQ(v["a"].items[1].number, -25);
+    EXPECT_EQ(v["a"].items[2].type, bench::Json::Bool);
+    EXPECT_EQ(v["a"].items[2].number, 1);
+    EXPECT_EQ(v["a"].items[3].number, 0);
+    EXPECT_EQ(v["a"].items[4].type, bench::Json::Null);
+    EXPECT_EQ(v["b"]["c"].string, "x\"\\\nqA");
+    EXPECT_EQ(v["d"].type, bench::Json::Object);
+    EXPECT_EQ(v["e"].type, bench::Json::Array);
+    EXPECT_EQ(v["missing"].type, bench::Json::Null);
+}
+
+TEST(JsonParserTest, RejectsMalformed)
+{
+    for(std::string text : { "", "{", "[1,", "{\"a\" 1}", "\"open", "[1] 2", "{1: 2}", "nul" }) {
+        bench::Json v;
+        EXPECT_FALSE(bench::JsonParser(text).Parse(&v)) << text;
+    }
+}
+
+TEST(BenchJsonTest, LoadsWhatBenchWrites)
+{
+    char path[] = "/tmp/bench_compare_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    bench::Result r;
+    r.name = "Quote\"d";
+    r.iterations = 1000;
+    r.samples = { 1.5, 2.25, 3 };
+    r.median = 2.25;
+    ASSERT_TRUE(bench::WriteJson(path, { r }));
+
+    bench::ResultFile file;
+    std::string error;
+    ASSERT_TRUE(bench::LoadResults(path, &file, &error)) << error;
+    unlink(path);
+    ASSERT_EQ(file.names, std::vector<std::string>{ "Quote\"d" });
+    EXPECT_EQ(file.samples["Quote\"d"], (std::vector<double>{ 1.5, 2.25, 3 }));
+    EXPECT_EQ(file.context["compiler"], __VERSION__);
+    EXPECT_FALSE(file.context["cpu"].empty());
+    EXPECT_FALSE(file.context["governor"].empty());
+}
+
+TEST(BenchJsonTest, ReportsUnreadableFiles)
+{
+    bench::ResultFile file;
+    std::string error;
+    EXPECT_FALSE(bench::LoadResults("/nonexistent.json", &file, &error));
+    EXPECT_NE(error.find("cannot open"), std::string::npos);
+}
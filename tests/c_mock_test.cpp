@@ -0,0 +1,85 @@
+// c_mock_test.cpp
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <cstring>
+#include <thread>
+extern "C" {
+#include "greeter.h"
+#include "logger.h"
+
+// an API with no definition but its mocks
+int checksum(const unsigned char *data, size_t size, int seed);
+void tick(void);
+}
+#include "c_mock.hpp"
+
+using ::testing::InSequence;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::StrEq;
+using ::testing::_;
+
+C_MOCK(int, loggerWriteLog, (const char *));
+C_MOCK(int, checksum, (const unsigned char *, size_t, int));
+C_MOCK(void, tick, ());
+
+TEST(CMockTest, MocksTheLoggerOfGreeter)
+{
+    CMock<loggerWriteLog> logger;
+    EXPECT_CALL(logger, loggerWriteLog(StrEq("Hey, You!"))).WillOnce(Return(-1));
+
+    auto gr = greeterCreate("Hey");
+    EXPECT_STREQ(greeterGreet(gr, "You"), "Hey, You!");
+    greeterDestroy(&gr);
+}
+
+TEST(CMockTest, PassesThroughWithoutMock)
+{
+    CMock<loggerWriteLog>::ResetCalls();
+    ASSERT_NE(CMock<loggerWriteLog>::Real(), nullptr); // the logger library
+    EXPECT_EQ(loggerWriteLog("passed through"), int(strlen("[LOG] passed through\n")));
+    EXPECT_EQ(CMock<loggerWriteLog>::Calls(), 1u);
+    {
+        NiceMock<CMock<loggerWriteLog>> logger;
+        loggerWriteLog("mocked");
+    }
+    EXPECT_EQ(CMock<loggerWriteLog>::Calls(), 2u);
+}
+
+TEST(CMockTest, ReturnsDefaultWithoutMockOrDefinition)
+{
+    EXPECT_EQ(CMock<checksum>::Real(), nullptr);
+    CMock<checksum>::ResetCalls();
+    EXPECT_EQ(checksum(nullptr, 0, 7), 0);
+    tick();
+    EXPECT_EQ(CMock<checksum>::Calls(), 1u);
+    EXPECT_EQ(CMock<tick>::Calls(), 1u);
+}
+
+TEST(CMockTest, MocksAnyArity)
+{
+    CMock<checksum> sum;
+    CMock<tick> ticks;
+    const unsigned char data[] = { 1, 2, 3 };
+    {
+        InSequence seq;
+        EXPECT_CALL(ticks, tick());
+        EXPECT_CALL(sum, checksum(data, 3, 7)).WillOnce(Return(13));
+        EXPECT_CALL(ticks, tick());
+    }
+    tick();
+    EXPECT_EQ(checksum(data, sizeof(data), 7), 13);
+    tick();
+}
+
+TEST(CMockTest, ThreadMockOverridesProcessMock)
+{
+    CMock<checksum> sum;
+    EXPECT_CALL(sum, checksum(_, _, _)).WillRepeatedly(Return(1));
+    std::thread([] {
+        CMock<checksum> mine(SingleScope::Thread);
+        EXPECT_CALL(mine, checksum(_, _, _)).WillOnce(Return(2));
+        EXPECT_EQ(checksum(nullptr, 0, 0), 2);
+    }).join();
+    EXPECT_EQ(checksum(nullptr, 0, 0), 1);
+}
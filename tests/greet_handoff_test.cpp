@@ -0,0 +1,215 @@
+// greet_handoff_test.cpp
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+extern "C" {
+#include "greet_handoff.h"
+#include "greet_server.h"
+#include "greet_client.h"
+}
+
+static size_t WriteSnapshot(void *arg, void *buf)
+{
+    const char *text = static_cast<const char *>(arg);
+    memcpy(buf, text, strlen(text));
+    return strlen(text);
+}
+
+class GreetHandoffTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        path_ = "/tmp/greet_handoff_test." + std::to_string(getpid()) + ".sock";
+        ctlPath_ = path_ + ".ctl";
+        greet_server_options_t opt = { path_.c_str(), "Hello", 2 };
+        old_ = greetServerCreate(&opt);
+        ASSERT_NE(old_, nullptr);
+        handoff_ = greetHandoffCreate(ctlPath_.c_str());
+        ASSERT_NE(handoff_, nullptr);
+        oldThread_ = std::thread([this] { oldRc_ = greetServerRun(old_); oldDone_ = true; });
+        handoffThread_ = std::thread([this] {
+            int fds[GREET_HANDOFF_MAX_FDS];
+            int n = greetServerListeners(old_, fds, GREET_HANDOFF_MAX_FDS);
+            handoffRc_ = greetHandoffAccept(handoff_, fds, n, WriteSnapshot, (void *)"warm");
+            if(handoffRc_ == 0) { greetServerDrain(old_); }
+        });
+    }
+
+    void TearDown() override {
+        if(handoffThread_.joinable()) {
+            greetHandoffStop(handoff_);
+            handoffThread_.join();
+        }
+        greetHandoffDestroy(&handoff_);
+        if(handoffRc_ == 0) { unlink(ctlPath_.c_str()); } // left to the successor
+        if(old_) {
+            greetServerStop(old_);
+            oldThread_.join();
+            greetServerDestroy(&old_);
+        }
+        if(new_) {
+            greetServerStop(new_);
+            newThread_.join();
+            greetServerDestroy(&new_);
+        }
+        EXPECT_NE(access(path_.c_str(), F_OK), 0);
+        EXPECT_NE(access(ctlPath_.c_str(), F_OK), 0);
+    }
+
+    // takes over from old_ as a successor process would
+    void TakeOver() {
+        int fds[GREET_HANDOFF_MAX_FDS], n = GREET_HANDOFF_MAX_FDS;
+        char snapshot[16];
+        size_t len = sizeof(snapshot);
+        int conn = greetHandoffReceive(ctlPath_.c_str(), fds, &n, snapshot, &len);
+        ASSERT_GE(conn, 0);
+        ASSERT_EQ(n, 1);
+        EXPECT_EQ(std::string(snapshot, len), "warm");
+        greet_server_options_t opt = { path_.c_str(), "Hi", 2 };
+        opt.listenFds = fds;
+        opt.listenFdCount = n;
+        new_ = greetServerCreate(&opt);
+        ASSERT_NE(new_, nullptr);
+        newThread_ = std::thread([this] { greetServerRun(new_); });
+        ASSERT_EQ(greetHandoffCommit(conn), 0);
+        greetServerAdopt(new_);
+    }
+
+    std::string path_, ctlPath_;
+    greet_server_t *old_ = nullptr, *new_ = nullptr;
+    greet_handoff_t *handoff_ = nullptr;
+    std::thread oldThread_, newThread_, handoffThread_;
+    std::atomic<bool> oldDone_{false};
+    int oldRc_ = -1, handoffRc_ = -1;
+};
+
+TEST_F(GreetHandoffTest, RestartUnderLoadRefusesNothing)
+{
+    std::atomic<bool> running{true};
+    std::atomic<int> errors{0}, byOld{0}, byNew{0};
+    std::vector<std::thread> clients;
+    for(int i = 0; i < 4; ++i) {
+        clients.emplace_back([&] {
+            while(running) {
+                greet_client_t *c = greetClientConnect(path_.c_str());
+                if( ! c) {
+                    ++errors;
+                    continue;
+                }
+                for(int j = 0; j < 10; ++j) {
+                    const char *g = greetClientGreet(c, "Tom");
+                    if(g && ! strcmp(g, "Hello, Tom!")) { ++byOld; }
+                    else if(g && ! strcmp(g, "Hi, Tom!")) { ++byNew; }
+                    else { ++errors; }
+                }
+                greetClientClose(&c);
+            }
+        });
+    }
+    // a connection open across the handoff stays with the old server
+    greet_client_t *held = greetClientConnect(path_.c_str());
+    ASSERT_NE(held, nullptr);
+    EXPECT_STREQ(greetClientGreet(held, "Jerry"), "Hello, Jerry!");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TakeOver();
+    handoffThread_.join();
+    EXPECT_EQ(handoffRc_, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_FALSE(oldDone_);
+    EXPECT_STREQ(greetClientGreet(held, "Jerry"), "Hello, Jerry!");
+    greetClientClose(&held);
+    oldThread_.join(); // drained once its last client is gone
+    EXPECT_EQ(oldRc_, 0);
+    greetServerDestroy(&old_);
+    EXPECT_EQ(access(path_.c_str(), F_OK), 0); // now the successor's
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    running = false;
+    for(auto &t : clients) { t.join(); }
+    EXPECT_EQ(errors, 0);
+    EXPECT_GT(byOld, 0);
+    EXPECT_GT(byNew, 0);
+}
+
+TEST_F(GreetHandoffTest, SuccessorGivingUpLeavesServerServing)
+{
+    int fds[GREET_HANDOFF_MAX_FDS], n = GREET_HANDOFF_MAX_FDS;
+    size_t len = 0;
+    int conn = greetHandoffReceive(ctlPath_.c_str(), fds, &n, nullptr, &len);
+    ASSERT_GE(conn, 0);
+    close(fds[0]);
+    close(conn);
+
+    greet_client_t *c = greetClientConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hello, Tom!");
+    greetClientClose(&c);
+
+    TakeOver();
+    handoffThread_.join();
+    EXPECT_EQ(handoffRc_, 0);
+    oldThread_.join();
+    greetServerDestroy(&old_);
+    c = greetClientConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hi, Tom!");
+    greetClientClose(&c);
+}
+
+TEST_F(GreetHandoffTest, SuccessorFailingToCommitLeavesThePath)
+{
+    int fds[GREET_HANDOFF_MAX_FDS], n = GREET_HANDOFF_MAX_FDS;
+    size_t len = 0;
+    int conn = greetHandoffReceive(ctlPath_.c_str(), fds, &n, nullptr, &len);
+    ASSERT_GE(conn, 0);
+    greet_server_options_t opt = { path_.c_str(), "Hi", 1 };
+    opt.listenFds = fds;
+    opt.listenFdCount = n;
+    greet_server_t *successor = greetServerCreate(&opt);
+    ASSERT_NE(successor, nullptr);
+    // as greeterd when greetHandoffCommit() fails
+    close(conn);
+    greetServerDestroy(&successor);
+
+    EXPECT_EQ(access(path_.c_str(), F_OK), 0);
+    greet_client_t *c = greetClientConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hello, Tom!");
+    greetClientClose(&c);
+}
+
+TEST(GreetHandoffPerCoreTest, HandsOverEveryListener)
+{
+    greet_server_options_t opt = { nullptr, "Hello", 3, "127.0.0.1", 0 };
+    greet_server_t *old = greetServerCreate(&opt);
+    ASSERT_NE(old, nullptr);
+    int fds[GREET_HANDOFF_MAX_FDS];
+    ASSERT_EQ(greetServerListeners(old, fds, GREET_HANDOFF_MAX_FDS), 3);
+
+    greet_server_options_t inherit = { nullptr, "Hi", 0, "127.0.0.1", 0 };
+    inherit.listenFds = fds;
+    inherit.listenFdCount = 3;
+    for(int i = 0; i < 3; ++i) { fds[i] = dup(fds[i]); }
+    greet_server_t *successor = greetServerCreate(&inherit);
+    ASSERT_NE(successor, nullptr);
+    EXPECT_EQ(greetServerPort(successor), greetServerPort(old));
+    std::thread t([&] { greetServerRun(successor); });
+    greetServerDestroy(&old);
+
+    for(int i = 0; i < 6; ++i) {
+        greet_client_t *c = greetClientConnectTcp("127.0.0.1", greetServerPort(successor));
+        ASSERT_NE(c, nullptr);
+        EXPECT_STREQ(greetClientGreet(c, "Tom"), "Hi, Tom!");
+        greetClientClose(&c);
+    }
+    greetServerStop(successor);
+    t.join();
+    greetServerDestroy(&successor);
+}
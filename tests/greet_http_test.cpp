@@ -0,0 +1,200 @@
+// greet_http_test.cpp
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+extern "C" {
+#include "greet_http.h"
+#include "greet_server.h"
+}
+
+static std::string Slice(const char *p, size_t len)
+{
+    return std::string(p, len);
+}
+
+TEST(GreetHttpParse, ParsesARequest)
+{
+    std::string in = "GET /greet?name=Tom HTTP/1.1\r\nHost: x\r\n\r\nGET /";
+    greet_http_parser_t p = {};
+    greet_http_request_t req;
+    ASSERT_EQ(greetHttpParse(&p, in.data(), in.size(), &req), 1);
+    EXPECT_EQ(Slice(req.method, req.methodLen), "GET");
+    EXPECT_EQ(Slice(req.path, req.pathLen), "/greet");
+    EXPECT_EQ(Slice(req.query, req.queryLen), "name=Tom");
+    EXPECT_TRUE(req.keepAlive);
+    EXPECT_EQ(req.length, in.find("GET /", 1));
+    EXPECT_EQ(req.path, in.data() + 4); // points into the buffer
+}
+
+TEST(GreetHttpParse, ResumesWithMoreBytes)
+{
+    std::string in = "GET /greet HTTP/1.1\r\nConnection: close\r\n\r\n";
+    greet_http_parser_t p = {};
+    greet_http_request_t req;
+    for(size_t len = 0; len < in.size(); ++len) {
+        ASSERT_EQ(greetHttpParse(&p, in.data(), len, &req), GREET_HTTP_INCOMPLETE) << len;
+    }
+    ASSERT_EQ(greetHttpParse(&p, in.data(), in.size(), &req), 1);
+    EXPECT_EQ(req.queryLen, 0u);
+    EXPECT_FALSE(req.keepAlive);
+    EXPECT_EQ(p.scanned, 0u);
+}
+
+TEST(GreetHttpParse, FollowsConnectionHeaders)
+{
+    greet_http_parser_t p = {};
+    greet_http_request_t req;
+    std::string in = "GET / HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(greetHttpParse(&p, in.data(), in.size(), &req), 1);
+    EXPECT_FALSE(req.keepAlive);
+    in = "GET / HTTP/1.0\r\nconnection:  Keep-Alive \r\n\r\n";
+    ASSERT_EQ(greetHttpParse(&p, in.data(), in.size(), &req), 1);
+    EXPECT_TRUE(req.keepAlive);
+}
+
+TEST(GreetHttpParse, RejectsMalformedRequests)
+{
+    const char *bad[] = {
+        "GET\r\n\r\n",
+        "GET /greet\r\n\r\n",
+        "GET /greet HTTP/2.0\r\n\r\n",
+        " /greet HTTP/1.1\r\n\r\n",
+        "POST /greet HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc",
+        "POST /greet HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+    };
+    for(const char *in : bad) {
+        greet_http_parser_t p = {};
+        greet_http_request_t req;
+        EXPECT_EQ(greetHttpParse(&p, in, strlen(in), &req), GREET_HTTP_MALFORMED) << in;
+    }
+    std::string endless = "GET /greet HTTP/1.1\r\n" + std::string(GREET_HTTP_MAX_HEAD, 'x');
+    greet_http_parser_t p = {};
+    greet_http_request_t req;
+    EXPECT_EQ(greetHttpParse(&p, endless.data(), endless.size(), &req), GREET_HTTP_MALFORMED);
+}
+
+TEST(GreetHttpQueryParam, DecodesValues)
+{
+    char out[16];
+    std::string q = "a=1&name=J%C3%B3zsef+A&b";
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "name", out, sizeof(out)), 9);
+    EXPECT_STREQ(out, "J\xC3\xB3zsef A");
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "a", out, sizeof(out)), 1);
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "b", out, sizeof(out)), -1);
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "nam", out, sizeof(out)), -1);
+    q = "name=%4";
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "name", out, sizeof(out)), -2);
+    q = "name=0123456789abcdef";
+    EXPECT_EQ(greetHttpQueryParam(q.data(), q.size(), "name", out, sizeof(out)), -2);
+}
+
+TEST(GreetHttpResponse, FormatsHeadersAndBody)
+{
+    char out[256];
+    size_t ok = greetHttpResponse(GREET_HTTP_OK, 1, "Hello, Tom!", 11, out, sizeof(out)), n = ok;
+    EXPECT_EQ(std::string(out, n), "HTTP/1.1 200 OK\r\nServer: greeterd\r\n"
+                                   "Content-Type: text/plain; charset=utf-8\r\nContent-Length: 11\r\n"
+                                   "\r\nHello, Tom!");
+    n = greetHttpResponse(GREET_HTTP_NOT_FOUND, 0, "", 0, out, sizeof(out));
+    EXPECT_NE(std::string(out, n).find("404 Not Found"), std::string::npos);
+    EXPECT_NE(std::string(out, n).find("Content-Length: 0\r\nConnection: close\r\n\r\n"), std::string::npos);
+    // too small: the length needed, and nothing written
+    out[0] = '\0';
+    EXPECT_EQ(greetHttpResponse(GREET_HTTP_OK, 1, "Hello", 5, out, 10), ok - 6 - 1); // shorter body and Content-Length
+    EXPECT_EQ(out[0], '\0');
+}
+
+class GreetHttpServerTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        path_ = "/tmp/greet_http_test." + std::to_string(getpid()) + ".sock";
+        greet_server_options_t opt = {};
+        opt.path = path_.c_str();
+        opt.greeting = "Hello";
+        opt.http = 1;
+        server_ = greetServerCreate(&opt);
+        ASSERT_NE(server_, nullptr);
+        thread_ = std::thread([this] { greetServerRun(server_); });
+
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path_.c_str());
+        fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_EQ(connect(fd_, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    }
+
+    void TearDown() override {
+        close(fd_);
+        greetServerStop(server_);
+        thread_.join();
+        greetServerDestroy(&server_);
+    }
+
+    // sends the requests, returns all the server wrote until it closed
+    // the connection or went quiet
+    std::string Exchange(const std::string &requests) {
+        EXPECT_EQ(send(fd_, requests.data(), requests.size(), 0), (ssize_t)requests.size());
+        std::string out;
+        char buf[4096];
+        struct pollfd p = { fd_, POLLIN, 0 };
+        while(poll(&p, 1, 200) == 1) {
+            ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+            if(n <= 0) { break; }
+            out.append(buf, n);
+        }
+        return out;
+    }
+
+    static std::string Ok(const std::string &body) {
+        return "HTTP/1.1 200 OK\r\nServer: greeterd\r\nContent-Type: text/plain; charset=utf-8\r\n"
+               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    std::string path_;
+    greet_server_t *server_ = nullptr;
+    std::thread thread_;
+    int fd_ = -1;
+};
+
+TEST_F(GreetHttpServerTest, GreetsByQuery)
+{
+    EXPECT_EQ(Exchange("GET /greet?name=Tom HTTP/1.1\r\n\r\n"), Ok("Hello, Tom!"));
+    EXPECT_EQ(Exchange("GET /greet HTTP/1.1\r\n\r\n"), Ok("Hello, World!"));
+}
+
+TEST_F(GreetHttpServerTest, AnswersPipelinedRequestsInOrder)
+{
+    std::string requests, expected;
+    for(int i = 0; i < 100; ++i) {
+        requests += "GET /greet?name=" + std::to_string(i) + " HTTP/1.1\r\nHost: x\r\n\r\n";
+        expected += Ok("Hello, " + std::to_string(i) + "!");
+    }
+    EXPECT_EQ(Exchange(requests), expected);
+}
+
+TEST_F(GreetHttpServerTest, ClosesWhenAsked)
+{
+    std::string out = Exchange("GET /greet?name=a HTTP/1.1\r\nConnection: close\r\n\r\n"
+                               "GET /greet?name=b HTTP/1.1\r\n\r\n");
+    EXPECT_NE(out.find("Connection: close\r\n\r\nHello, a!"), std::string::npos);
+    EXPECT_EQ(out.find("Hello, b!"), std::string::npos);
+    char b;
+    EXPECT_EQ(recv(fd_, &b, 1, 0), 0);
+}
+
+TEST_F(GreetHttpServerTest, ReportsErrors)
+{
+    EXPECT_EQ(Exchange("GET /other HTTP/1.1\r\n\r\n").rfind("HTTP/1.1 404 ", 0), 0u);
+    std::string notAllowed = Exchange("PUT /greet HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(notAllowed.rfind("HTTP/1.1 405 ", 0), 0u);
+    EXPECT_NE(notAllowed.find("\r\nAllow: GET\r\n"), std::string::npos); // RFC 9110 15.5.6
+    EXPECT_EQ(Exchange("GET /greet?name=%zz HTTP/1.1\r\n\r\n").rfind("HTTP/1.1 400 ", 0), 0u);
+    std::string out = Exchange("nonsense\r\n\r\n");
+    EXPECT_EQ(out.rfind("HTTP/1.1 400 ", 0), 0u);
+    EXPECT_NE(out.find("Connection: close"), std::string::npos);
+}
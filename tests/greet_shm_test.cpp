@@ -0,0 +1,238 @@
+// greet_shm_test.cpp
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+extern "C" {
+#include "greet_shm_server.h"
+#include "greet_shm_client.h"
+#include "greet_proto.h"
+}
+
+class GreetShmTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        path_ = "/tmp/greet_shm_test." + std::to_string(getpid()) + ".sock";
+        server_ = greetShmServerCreate(path_.c_str(), "Hello", nullptr);
+        ASSERT_NE(server_, nullptr);
+        thread_ = std::thread([this] { rc_ = greetShmServerRun(server_); });
+    }
+
+    void TearDown() override {
+        Stop();
+    }
+
+    void Stop() {
+        if( ! server_) { return; }
+        greetShmServerStop(server_);
+        thread_.join();
+        EXPECT_EQ(rc_, 0);
+        greetShmServerDestroy(&server_);
+        EXPECT_EQ(server_, nullptr);
+        EXPECT_NE(access(path_.c_str(), F_OK) == 0, ownsPath_);
+    }
+
+    std::string path_;
+    greet_shm_server_t *server_ = nullptr;
+    std::thread thread_;
+    int rc_ = -1;
+    bool ownsPath_ = true;
+};
+
+TEST_F(GreetShmTest, GreetsThroughSharedMemory)
+{
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hello, Tom!");
+    EXPECT_STREQ(greetShmGreet(c, "Jerry"), "Hello, Jerry!");
+    EXPECT_STREQ(greetShmGreet(c, ""), "Hello, World!");
+    EXPECT_STREQ(greetShmGreet(c, nullptr), "Hello, World!");
+    greetShmClose(&c);
+    EXPECT_EQ(c, nullptr);
+}
+
+TEST_F(GreetShmTest, FramesWrapAroundTheRings)
+{
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    // 37-byte names do not divide the ring size, so frames straddle its end
+    for(int i = 0; i < 20000; ++i) {
+        std::string name = std::string(30, 'a' + i % 26) + std::to_string(1000000 + i);
+        const char *greeting = greetShmGreet(c, name.c_str());
+        ASSERT_NE(greeting, nullptr);
+        ASSERT_EQ(greeting, "Hello, " + name + "!");
+    }
+    greetShmClose(&c);
+}
+
+TEST_F(GreetShmTest, GreetsTheLongestName)
+{
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    std::string name(GREET_PROTO_MAX_NAME, 'x');
+    EXPECT_EQ(greetShmGreet(c, name.c_str()), "Hello, " + name + "!");
+    greetShmClose(&c);
+}
+
+TEST_F(GreetShmTest, RejectsTooLongNames)
+{
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(greetShmGreet(c, std::string(5000, 'x').c_str()), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hello, Tom!");
+    greetShmClose(&c);
+}
+
+TEST_F(GreetShmTest, ServesClientsConcurrently)
+{
+    std::vector<std::thread> clients;
+    std::vector<int> failures(4);
+    for(size_t t = 0; t < failures.size(); ++t) {
+        clients.emplace_back([this, t, &failures] {
+            greet_shm_client_t *c = greetShmConnect(path_.c_str());
+            for(int i = 0; c && i < 1000; ++i) {
+                std::string name = std::to_string(t) + "." + std::to_string(i);
+                const char *greeting = greetShmGreet(c, name.c_str());
+                failures[t] += ! greeting || greeting != "Hello, " + name + "!";
+            }
+            failures[t] += ! c;
+            greetShmClose(&c);
+        });
+    }
+    for(auto &c : clients) { c.join(); }
+    for(int f : failures) { EXPECT_EQ(f, 0); }
+}
+
+TEST_F(GreetShmTest, ClientNoticesStoppedServer)
+{
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hello, Tom!");
+    Stop();
+    EXPECT_EQ(greetShmGreet(c, "Tom"), nullptr);
+    EXPECT_EQ(errno, EPIPE);
+    greetShmClose(&c);
+    EXPECT_EQ(greetShmConnect(path_.c_str()), nullptr);
+}
+
+static size_t OpenFds()
+{
+    size_t n = 0;
+    for(auto &entry : std::filesystem::directory_iterator("/proc/self/fd")) { (void)entry; ++n; }
+    return n;
+}
+
+TEST_F(GreetShmTest, ReapsSessionsOnceTheirClientLeaves)
+{
+    size_t before = OpenFds();
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hello, Tom!");
+    greetShmClose(&c);
+    // the session closes its end of the handshake socket once reaped,
+    // with no other client connecting to make the server look
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while(OpenFds() > before && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(OpenFds(), before);
+}
+
+TEST_F(GreetShmTest, DropsClientsOverrunningTheRing)
+{
+    // a hostile client, claiming more bytes in its ring than it can hold
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path_.c_str());
+    ASSERT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    char byte;
+    struct iovec iov = { &byte, 1 };
+    union { struct cmsghdr align; char buf[CMSG_SPACE(sizeof(int))]; } control;
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    ASSERT_EQ(recvmsg(fd, &msg, MSG_CMSG_CLOEXEC), 1);
+    int mem;
+    memcpy(&mem, CMSG_DATA(CMSG_FIRSTHDR(&msg)), sizeof(int));
+    size_t size = lseek(mem, 0, SEEK_END);
+    char *seg = (char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mem, 0);
+    ASSERT_NE(seg, MAP_FAILED);
+    close(mem);
+    // the request ring's head counter opens its second cache line; the ring
+    // is zeroed, so every four bytes read as an empty frame
+    __atomic_store_n((uint32_t *)(seg + 64), 0x80000000u, __ATOMIC_RELEASE);
+
+    char b;
+    EXPECT_EQ(recv(fd, &b, 1, 0), 0); // the session hung up
+    munmap(seg, size);
+    close(fd);
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hello, Tom!");
+    greetShmClose(&c);
+}
+
+TEST_F(GreetShmTest, LeavesThePathToASuccessorOnceDrained)
+{
+    greet_shm_client_t *held = greetShmConnect(path_.c_str());
+    ASSERT_NE(held, nullptr);
+    greetShmServerDrain(server_);
+    ownsPath_ = false;
+    unlink(path_.c_str()); // as a successor binding the path anew
+    greet_shm_server_t *successor = greetShmServerCreate(path_.c_str(), "Hi", nullptr);
+    ASSERT_NE(successor, nullptr);
+    std::thread t([&] { greetShmServerRun(successor); });
+
+    EXPECT_STREQ(greetShmGreet(held, "Tom"), "Hello, Tom!");
+    greetShmClose(&held);
+    Stop();
+    EXPECT_EQ(access(path_.c_str(), F_OK), 0);
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hi, Tom!");
+    greetShmClose(&c);
+    greetShmServerStop(successor);
+    t.join();
+    greetShmServerDestroy(&successor);
+    EXPECT_NE(access(path_.c_str(), F_OK), 0);
+}
+
+TEST_F(GreetShmTest, HandsTheListenerOverToASuccessor)
+{
+    greet_shm_client_t *held = greetShmConnect(path_.c_str());
+    ASSERT_NE(held, nullptr);
+    int fd = dup(greetShmServerListener(server_));
+    greet_shm_server_t *successor = greetShmServerInherit(fd, path_.c_str(), "Hi", nullptr);
+    ASSERT_NE(successor, nullptr);
+    std::thread t([&] { greetShmServerRun(successor); });
+    greetShmServerDrain(server_);
+    greetShmServerAdopt(successor);
+    ownsPath_ = false;
+
+    EXPECT_STREQ(greetShmGreet(held, "Tom"), "Hello, Tom!");
+    greet_shm_client_t *c = greetShmConnect(path_.c_str());
+    ASSERT_NE(c, nullptr);
+    EXPECT_STREQ(greetShmGreet(c, "Tom"), "Hi, Tom!");
+    greetShmClose(&c);
+    greetShmClose(&held);
+    Stop();
+    EXPECT_EQ(access(path_.c_str(), F_OK), 0);
+    greetShmServerStop(successor);
+    t.join();
+    greetShmServerDestroy(&successor);
+    EXPECT_NE(access(path_.c_str(), F_OK), 0);
+}
@@ -0,0 +1,164 @@
+// greet_udp_test.cpp
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+extern "C" {
+#include "greeter.h"
+#include "greet_udp.h"
+#include "greet_proto.h"
+}
+
+class GreetUdpTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        greet_udp_options_t opt = { "127.0.0.1", 0, "Hello", 16 };
+        server_ = greetUdpServerCreate(&opt);
+        ASSERT_NE(server_, nullptr);
+        thread_ = std::thread([this] { rc_ = greetUdpServerRun(server_); });
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(greetUdpServerPort(server_));
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_EQ(connect(fd_, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    }
+
+    void TearDown() override {
+        close(fd_);
+        greetUdpServerStop(server_);
+        thread_.join();
+        EXPECT_EQ(rc_, 0);
+        greetUdpServerDestroy(&server_);
+        EXPECT_EQ(server_, nullptr);
+    }
+
+    static std::string Request(const std::vector<std::string> &names) {
+        std::string d;
+        for(const auto &name : names) {
+            char len[GREET_PROTO_HEADER];
+            greetProtoPutU32(len, name.size());
+            d.append(len, sizeof(len)).append(name);
+        }
+        return d;
+    }
+
+    void Send(const std::string &datagram) {
+        ASSERT_EQ(send(fd_, datagram.data(), datagram.size(), 0), (ssize_t)datagram.size());
+    }
+
+    // the greetings of the next reply; empty if none came
+    std::vector<std::string> Receive() {
+        std::vector<std::string> greetings;
+        struct pollfd p = { fd_, POLLIN, 0 };
+        if(poll(&p, 1, 1000) != 1) { return greetings; }
+        char buf[GREET_UDP_SLOT];
+        ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+        for(ssize_t pos = 0; pos + GREET_PROTO_HEADER < n;) {
+            uint32_t len = greetProtoGetU32(buf + pos);
+            EXPECT_EQ(buf[pos + GREET_PROTO_HEADER], GREET_OK);
+            greetings.emplace_back(buf + pos + GREET_PROTO_HEADER + 1, len - 1);
+            pos += GREET_PROTO_HEADER + len;
+        }
+        return greetings;
+    }
+
+    greet_udp_server_t *server_ = nullptr;
+    std::thread thread_;
+    int rc_ = -1;
+    int fd_ = -1;
+};
+
+TEST_F(GreetUdpTest, AnswersADatagram)
+{
+    Send(Request({"Tom"}));
+    EXPECT_EQ(Receive(), std::vector<std::string>({"Hello, Tom!"}));
+}
+
+TEST_F(GreetUdpTest, AnswersEveryNameOfADatagram)
+{
+    Send(Request({"Tom", "", "Jerry"}));
+    EXPECT_EQ(Receive(), std::vector<std::string>({"Hello, Tom!", "Hello, World!", "Hello, Jerry!"}));
+}
+
+TEST_F(GreetUdpTest, StopsAtAMalformedFrame)
+{
+    std::string d = Request({"Tom"});
+    d += std::string("\0\0\1\0Jerry", 9); // claims 256 bytes
+    Send(d);
+    EXPECT_EQ(Receive(), std::vector<std::string>({"Hello, Tom!"}));
+    Send("xy"); // no frame at all: no reply
+    Send(Request({"Jerry"}));
+    EXPECT_EQ(Receive(), std::vector<std::string>({"Hello, Jerry!"}));
+}
+
+TEST_F(GreetUdpTest, RepliesFitInADatagram)
+{
+    std::vector<std::string> names(200, std::string(30, 'x'));
+    Send(Request(names)); // 34 bytes per name in, 43 out
+    auto greetings = Receive();
+    EXPECT_LT(greetings.size(), names.size());
+    EXPECT_EQ(greetings.size(), GREET_UDP_SLOT / (GREET_PROTO_HEADER + 1 + 38));
+    EXPECT_EQ(greetings.back(), "Hello, " + names[0] + "!");
+}
+
+TEST_F(GreetUdpTest, AnswersBatchesOfDatagrams)
+{
+    const int n = 100; // more than a batch of 16
+    for(int i = 0; i < n; ++i) { Send(Request({std::to_string(i)})); }
+    std::vector<int> seen(n);
+    for(int i = 0; i < n; ++i) {
+        auto greetings = Receive();
+        ASSERT_EQ(greetings.size(), 1u);
+        int k = std::stoi(greetings[0].substr(7));
+        ASSERT_GE(k, 0);
+        ASSERT_LT(k, n);
+        ++seen[k];
+    }
+    for(int s : seen) { EXPECT_EQ(s, 1); }
+}
+
+static std::atomic<int> traced{0};
+
+TEST_F(GreetUdpTest, GreetsThroughTheGreeter)
+{
+    // traced and logged as over the other transports
+    traced = 0;
+    greeterSetTrace([](const greeter_t *, const char *name) { traced += name ? 1 : 100; });
+    Send(Request({"Tom", "", std::string(GREET_PROTO_MAX_NAME, 'x')}));
+    EXPECT_EQ(Receive(), (std::vector<std::string>{"Hello, Tom!", "Hello, World!",
+                                                   "Hello, " + std::string(GREET_PROTO_MAX_NAME, 'x') + "!"}));
+    greeterSetTrace(nullptr);
+    EXPECT_EQ(traced, 102);
+}
+
+TEST_F(GreetUdpTest, AnswersOnAHandedOverSocket)
+{
+    int fd = dup(greetUdpServerSocket(server_));
+    greet_udp_options_t opt = { nullptr, 0, "Hi", 16 };
+    opt.fd = &fd;
+    greet_udp_server_t *successor = greetUdpServerCreate(&opt);
+    ASSERT_NE(successor, nullptr);
+    EXPECT_EQ(greetUdpServerPort(successor), greetUdpServerPort(server_));
+    greetUdpServerStop(server_);
+    Send(Request({"Tom"})); // queued before the successor runs
+    std::thread t([&] { greetUdpServerRun(successor); });
+    EXPECT_EQ(Receive(), std::vector<std::string>{"Hi, Tom!"});
+    greetUdpServerStop(successor);
+    t.join();
+    greetUdpServerDestroy(&successor);
+}
+
+TEST(GreetUdp, RejectsBadHost)
+{
+    greet_udp_options_t opt = { "localhost", 0, "Hello", 16 };
+    EXPECT_EQ(greetUdpServerCreate(&opt), nullptr);
+}
@@ -0,0 +1,135 @@
+// greeter_batch_test.cpp
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+extern "C" {
+#include "batch.h"
+}
+
+class GreeterBatchTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        g_ = greeterCreate("Hello");
+        ASSERT_NE(g_, nullptr);
+    }
+
+    void TearDown() override {
+        greeterDestroy(&g_);
+    }
+
+    // runs batchGreet over input given as a regular file or through a pipe
+    std::string Greet(const std::string &input, bool mapped, batch_options_t opt = {}) {
+        int in, pipefd[2];
+        FILE *file = nullptr;
+        if(mapped) {
+            file = tmpfile();
+            fwrite(input.data(), 1, input.size(), file);
+            fflush(file);
+            in = fileno(file);
+        }
+        else {
+            EXPECT_EQ(pipe(pipefd), 0);
+            EXPECT_EQ(write(pipefd[1], input.data(), input.size()), (ssize_t)input.size());
+            close(pipefd[1]);
+            in = pipefd[0];
+        }
+        FILE *out = tmpfile();
+        EXPECT_EQ(batchGreet(g_, in, fileno(out), &opt, &stats_), 0);
+        mapped ? fclose(file) : close(in);
+
+        std::string result(stats_.bytesOut, '\0');
+        rewind(out);
+        EXPECT_EQ(fread(result.data(), 1, result.size(), out), result.size());
+        fclose(out);
+        return result;
+    }
+
+  protected:
+    greeter_t *g_;
+    batch_stats_t stats_;
+};
+
+TEST_F(GreeterBatchTest, GreetsEveryLine)
+{
+    for(bool mapped : { true, false }) {
+        EXPECT_EQ(Greet("Alice\nBob\n", mapped), "Hello, Alice!\nHello, Bob!\n");
+        EXPECT_EQ(stats_.names, 2u);
+        EXPECT_EQ(stats_.bytesIn, 10u);
+        EXPECT_EQ(stats_.bytesOut, 26u);
+    }
+}
+
+TEST_F(GreeterBatchTest, GreetsLastLineWithoutNewline)
+{
+    for(bool mapped : { true, false }) {
+        EXPECT_EQ(Greet("Alice\r\n\nBob", mapped), "Hello, Alice!\nHello, !\nHello, Bob!\n");
+        EXPECT_EQ(Greet("", mapped), "");
+    }
+}
+
+TEST_F(GreeterBatchTest, FramesOutput)
+{
+    batch_options_t nul = { .framing = BATCH_NUL };
+    EXPECT_EQ(Greet("Alice\nBob\n", true, nul), std::string("Hello, Alice!\0Hello, Bob!\0", 26));
+
+    batch_options_t len = { .framing = BATCH_LENGTH };
+    EXPECT_EQ(Greet("Alice\nBob\n", false, len),
+              std::string("\0\0\0\x0dHello, Alice!\0\0\0\x0bHello, Bob!", 32));
+}
+
+TEST_F(GreeterBatchTest, HandlesNamesLongerThanBuffer)
+{
+    std::string name(100, 'x');
+    batch_options_t opt = { .bufferSize = 16 };
+    for(bool mapped : { true, false }) {
+        EXPECT_EQ(Greet("Al\n" + name + "\nBo\n", mapped, opt),
+                  "Hello, Al!\nHello, " + name + "!\nHello, Bo!\n");
+    }
+}
+
+TEST_F(GreeterBatchTest, KeepsInputOrderAcrossThreads)
+{
+    std::string input, expected;
+    for(int i = 0; i < 300000; ++i) { // several chunks per worker
+        input += "user" + std::to_string(i) + "\n";
+        expected += "Hello, user" + std::to_string(i) + "!\n";
+    }
+    input += "last";
+    expected += "Hello, last!\n";
+
+    for(size_t threads : { 2, 3, 8 }) {
+        batch_options_t opt = { .threads = threads };
+        EXPECT_EQ(Greet(input, true, opt), expected) << threads << " threads";
+        EXPECT_EQ(stats_.names, 300001u);
+        EXPECT_EQ(stats_.bytesIn, input.size());
+    }
+}
+
+TEST_F(GreeterBatchTest, EnginesAgree)
+{
+    std::string input = "Al\r\n\n" + std::string(5000, 'x') + "\n";
+    for(int i = 0; i < 20000; ++i) { input += "user" + std::to_string(i) + "\n"; }
+    input += std::string(300, 'y'); // long, unterminated last line
+    std::string expected = Greet(input, true);
+
+    for(size_t bufferSize : { 0, 64, 4096 }) { // small buffers split lines across reads
+        for(batch_io_t io : { BATCH_IO_PREAD, BATCH_IO_URING }) {
+            for(unsigned depth : { 1, 4 }) {
+                batch_options_t opt = { .bufferSize = bufferSize, .io = io, .queueDepth = depth };
+                EXPECT_EQ(Greet(input, true, opt), expected) << io << " " << bufferSize << " " << depth;
+                EXPECT_EQ(stats_.names, 20004u);
+                EXPECT_EQ(stats_.bytesIn, input.size());
+                EXPECT_TRUE(stats_.io == io || (io == BATCH_IO_URING && stats_.io == BATCH_IO_PREAD));
+            }
+        }
+    }
+}
+
+TEST_F(GreeterBatchTest, ReportsNeededSpace)
+{
+    char out[8];
+    EXPECT_EQ(batchFrame(g_, BATCH_LENGTH, "Bob", 3, out, sizeof(out)), 15u);
+    EXPECT_EQ(batchFrame(g_, BATCH_NUL, "", 0, out, sizeof(out)), 9u);
+    EXPECT_EQ(batchFrame(g_, BATCH_LINES, "", 0, out, sizeof(out) + 1), 9u);
+}
@@ -0,0 +1,190 @@
+// greeter_capture_test.cpp
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+extern "C" {
+#include "greeter.h"
+#include "greeter_capture.h"
+}
+
+class GreeterCaptureTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        path_ = "/tmp/greeter_capture_test." + std::to_string(getpid()) + ".bin";
+    }
+
+    void TearDown() override {
+        greeterCaptureStop();
+        unlink(path_.c_str());
+    }
+
+    std::vector<greeter_capture_record_t> ReadAll(std::vector<std::string> *texts) {
+        std::vector<greeter_capture_record_t> records;
+        greeter_capture_reader_t *r = greeterCaptureOpen(path_.c_str());
+        EXPECT_NE(r, nullptr);
+        greeter_capture_record_t rec;
+        int rc;
+        while(r && (rc = greeterCaptureNext(r, &rec)) == 1) {
+            texts->push_back(rec.text ? std::string(rec.text, rec.len) : "(null)");
+            records.push_back(rec);
+        }
+        EXPECT_EQ(rc, 0);
+        greeterCaptureClose(&r);
+        return records;
+    }
+
+    std::string path_;
+};
+
+TEST_F(GreeterCaptureTest, RecordsGreetersAndGreetingsInOrder)
+{
+    greeter_t *hello = greeterCreate("Hello");
+    greeter_t *hola = greeterCreate("Hola");
+    greeterGreet(hello, "before"); // not captured
+    ASSERT_EQ(greeterCaptureStart(path_.c_str()), 0);
+    greeterGreet(hello, "Tom");
+    greeterGreet(hola, "Jerry");
+    greeterGreet(hello, NULL);
+    greeterGreet(hello, "");
+    ASSERT_EQ(greeterCaptureStop(), 0);
+    greeterGreet(hello, "after"); // not captured either
+
+    std::vector<std::string> texts;
+    auto records = ReadAll(&texts);
+    ASSERT_EQ(records.size(), 6u);
+    EXPECT_EQ(texts, (std::vector<std::string>{ "Hello", "Tom", "Hola", "Jerry", "(null)", "" }));
+    EXPECT_EQ(records[0].type, GREETER_CAPTURE_GREETER);
+    EXPECT_EQ(records[0].greeter, greeterId(hello));
+    EXPECT_EQ(records[1].type, GREETER_CAPTURE_GREET);
+    EXPECT_EQ(records[1].greeter, greeterId(hello));
+    EXPECT_EQ(records[2].type, GREETER_CAPTURE_GREETER);
+    EXPECT_EQ(records[3].greeter, greeterId(hola));
+    EXPECT_EQ(records[4].text, nullptr);
+    for(size_t i = 1; i < records.size(); ++i) { EXPECT_GE(records[i].time, records[i - 1].time); }
+    greeterDestroy(&hello);
+    greeterDestroy(&hola);
+}
+
+TEST_F(GreeterCaptureTest, GivesGreetersDistinctIds)
+{
+    greeter_t *a = greeterCreate("A");
+    greeter_t *b = greeterCreate("B");
+    EXPECT_NE(greeterId(a), greeterId(b));
+    greeterDestroy(&a);
+    greeterDestroy(&b);
+}
+
+TEST_F(GreeterCaptureTest, CapturesGreetingsOfManyThreads)
+{
+    ASSERT_EQ(greeterCaptureStart(path_.c_str()), 0);
+    EXPECT_EQ(greeterCaptureStart(path_.c_str()), -1); // one capture at a time
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            greeter_t *g = greeterCreate("Hi");
+            std::string name(300, 'x'); // fills the buffer a few times
+            for(int i = 0; i < 2000; ++i) { greeterGreet(g, name.c_str()); }
+            greeterDestroy(&g);
+        });
+    }
+    for(auto &t : threads) { t.join(); }
+    ASSERT_EQ(greeterCaptureStop(), 0);
+
+    std::vector<std::string> texts;
+    auto records = ReadAll(&texts);
+    size_t greets = 0, greeters = 0;
+    for(const auto &r : records) {
+        if(r.type == GREETER_CAPTURE_GREET) { ++greets; }
+        else { ++greeters; }
+    }
+    EXPECT_EQ(greets, 8000u);
+    EXPECT_EQ(greeters, 4u);
+}
+
+// each thread records into its own buffer: in file order the greetings of
+// a thread are in the order made, and in time order whatever came between
+TEST_F(GreeterCaptureTest, KeepsTheOrderOfEachThread)
+{
+    ASSERT_EQ(greeterCaptureStart(path_.c_str()), 0);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            greeter_t *g = greeterCreate(std::to_string(t).c_str());
+            std::string pad(200, 'x'); // fills the buffer a few times
+            for(int i = 0; i < 2000; ++i) { greeterGreet(g, (std::to_string(i) + pad).c_str()); }
+            greeterDestroy(&g);
+        });
+    }
+    for(auto &t : threads) { t.join(); }
+    ASSERT_EQ(greeterCaptureStop(), 0);
+
+    std::vector<std::string> texts;
+    auto records = ReadAll(&texts);
+    std::map<unsigned, int> next;
+    std::map<unsigned, uint64_t> last;
+    for(size_t i = 0; i < records.size(); ++i) {
+        if(records[i].type != GREETER_CAPTURE_GREET) { continue; }
+        unsigned id = records[i].greeter;
+        ASSERT_EQ(std::stoi(texts[i]), next[id]++) << "greeter " << id;
+        ASSERT_GE(records[i].time, last[id]);
+        last[id] = records[i].time;
+    }
+    EXPECT_EQ(next.size(), 4u);
+    for(auto &n : next) { EXPECT_EQ(n.second, 2000); }
+}
+
+TEST_F(GreeterCaptureTest, StartsAfreshEachCapture)
+{
+    greeter_t *hello = greeterCreate("Hello");
+    ASSERT_EQ(greeterCaptureStart(path_.c_str()), 0);
+    greeterGreet(hello, "Tom");
+    ASSERT_EQ(greeterCaptureStop(), 0);
+    ASSERT_EQ(greeterCaptureStart(path_.c_str()), 0);
+    greeterGreet(hello, "Jerry");
+    ASSERT_EQ(greeterCaptureStop(), 0);
+
+    std::vector<std::string> texts;
+    ReadAll(&texts);
+    EXPECT_EQ(texts, (std::vector<std::string>{ "Hello", "Jerry" })); // described again
+    greeterDestroy(&hello);
+}
+
+TEST_F(GreeterCaptureTest, ReadsVersion1Files)
+{
+    // as written before 'T' records: one time line for all threads
+    const char capture[] = "GRCAP1G\x07\x02HiN\x05\x07\x04TomN\x03\x07\x00";
+    FILE *f = fopen(path_.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    fwrite(capture, 1, sizeof(capture) - 1, f);
+    fclose(f);
+    std::vector<std::string> texts;
+    auto records = ReadAll(&texts);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(texts, (std::vector<std::string>{ "Hi", "Tom", "(null)" }));
+    EXPECT_EQ(records[1].greeter, 7u);
+    EXPECT_EQ(records[1].time, 5u);
+    EXPECT_EQ(records[2].time, 8u);
+}
+
+TEST_F(GreeterCaptureTest, RejectsMalformedFiles)
+{
+    FILE *f = fopen(path_.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    fputs("not a capture", f);
+    fclose(f);
+    EXPECT_EQ(greeterCaptureOpen(path_.c_str()), nullptr);
+
+    f = fopen(path_.c_str(), "w");
+    fputs("GRCAP1G\x01\x09Hel", f); // greeting cut short
+    fclose(f);
+    greeter_capture_reader_t *r = greeterCaptureOpen(path_.c_str());
+    ASSERT_NE(r, nullptr);
+    greeter_capture_record_t rec;
+    EXPECT_EQ(greeterCaptureNext(r, &rec), -1);
+    greeterCaptureClose(&r);
+}
@@ -0,0 +1,94 @@
+// greeter_fake_test.cpp
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+extern "C" {
+#include "greeter.h"
+}
+#include "logger_fake.hpp"
+
+TEST(LoggerFakeTest, RecordsMessagesInOrder)
+{
+    LoggerFake logger;
+    EXPECT_EQ(loggerWriteLog("one"), 10);
+    loggerWriteLog("two");
+    loggerWriteLog("one");
+    ASSERT_EQ(logger.Size(), 3u);
+    EXPECT_EQ(logger.Message(1), "two");
+    EXPECT_EQ(logger.Message(3), "");
+    EXPECT_EQ(logger.Count("one"), 2u);
+    EXPECT_EQ(logger.Count("on"), 0u);
+    EXPECT_EQ(logger.CountContaining("o"), 3u);
+    EXPECT_TRUE(logger.Contains("two"));
+    EXPECT_FALSE(logger.Contains("three"));
+    EXPECT_TRUE(logger.ContainsInOrder({ "one", "one" }));
+    EXPECT_TRUE(logger.ContainsInOrder({ "two", "one" }));
+    EXPECT_FALSE(logger.ContainsInOrder({ "two", "two" }));
+    EXPECT_TRUE(logger.ContainsInOrder({}));
+    logger.Clear();
+    EXPECT_EQ(logger.Size(), 0u);
+}
+
+TEST(LoggerFakeTest, DropsWhatDoesNotFit)
+{
+    LoggerFake logger(10, 3);
+    loggerWriteLog("12345");
+    EXPECT_EQ(loggerWriteLog("123456"), -1); // arena
+    loggerWriteLog("1234");
+    loggerWriteLog("1");
+    EXPECT_EQ(loggerWriteLog(""), -1);       // index
+    EXPECT_EQ(logger.Size(), 3u);
+    EXPECT_EQ(logger.Dropped(), 2u);
+    EXPECT_EQ(logger.Message(1), "1234");
+    EXPECT_EQ(logger.Message(2), "1");
+}
+
+TEST(LoggerFakeTest, ThreadFakeOverridesProcessFake)
+{
+    LoggerFake logger;
+    std::thread([] {
+        LoggerFake mine(1024, 16, SingleScope::Thread);
+        loggerWriteLog("mine");
+        EXPECT_EQ(mine.Size(), 1u);
+    }).join();
+    EXPECT_EQ(logger.Size(), 0u);
+}
+
+TEST(GreeterFakeTest, CallsLoggerWithMessage)
+{
+    LoggerFake logger;
+    auto h = greeterCreate("Welcome");
+    greeterGreet(h, "Ladies");
+    greeterGreet(h, "Bob");
+    greeterDestroy(&h);
+    EXPECT_TRUE(logger.ContainsInOrder({ "Welcome, Ladies!", "Welcome, Bob!" }));
+    EXPECT_FALSE(logger.ContainsInOrder({ "Welcome, Bob!", "Welcome, Ladies!" }));
+}
+
+// what LoggerMock is too slow for: greetings by the hundred thousand
+TEST(GreeterFakeTest, RecordsEveryThreadInOrder)
+{
+    const int threads = 8, greetings = 100000;
+    LoggerFake logger;
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t) {
+        workers.emplace_back([t] {
+            auto g = greeterCreate(std::to_string(t).c_str());
+            for(int i = 0; i < greetings; ++i) { greeterGreet(g, std::to_string(i).c_str()); }
+            greeterDestroy(&g);
+        });
+    }
+    for(std::thread &w : workers) { w.join(); }
+
+    ASSERT_EQ(logger.Dropped(), 0u);
+    ASSERT_EQ(logger.Size(), size_t(threads) * greetings);
+    // "t, i!": the greetings of each thread come in the order it made them
+    std::vector<int> next(threads, 0);
+    for(size_t i = 0; i < logger.Size(); ++i) {
+        int t, n;
+        ASSERT_EQ(sscanf(std::string(logger.Message(i)).c_str(), "%d, %d!", &t, &n), 2);
+        ASSERT_EQ(n, next[t]++) << "thread " << t;
+    }
+    EXPECT_EQ(logger.Count("7, 99999!"), 1u);
+}
@@ -0,0 +1,63 @@
+// greeter_lang_test.cpp
+#include <gtest/gtest.h>
+#include <fstream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+extern "C" {
+#include "greeter_lang.h"
+#include "greetings_mph.h"
+}
+
+// every entry of the word list the perfect hash was generated from
+static std::vector<std::pair<std::string, std::string>> ReadWordList()
+{
+    std::vector<std::pair<std::string, std::string>> words;
+    std::ifstream in(GREETINGS_TXT);
+    std::string line;
+    while(std::getline(in, line)) {
+        if(line.empty() || line[0] == '#') { continue; }
+        auto tab = line.find('\t');
+        words.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+    }
+    return words;
+}
+
+TEST(GreeterLangTest, FindsEveryKeyOfWordList)
+{
+    auto words = ReadWordList();
+    ASSERT_EQ(words.size(), (size_t)greetingsCount);
+
+    std::set<int> slots;
+    for(const auto &[lang, greeting] : words) {
+        int slot = greetingsIndex(lang.data(), lang.size());
+        ASSERT_GE(slot, 0) << lang;
+        ASSERT_LT(slot, greetingsCount) << lang;
+        EXPECT_EQ(greetingsKeys[slot], lang);
+        EXPECT_EQ(greetingsValues[slot], greeting);
+        EXPECT_STREQ(greeterLangGreeting(lang.c_str()), greeting.c_str());
+        slots.insert(slot);
+    }
+    EXPECT_EQ(slots.size(), words.size()); // minimal: a bijection onto the table
+}
+
+TEST(GreeterLangTest, RejectsUnknownKeys)
+{
+    EXPECT_EQ(greeterLangGreeting(NULL), nullptr);
+    for(const char *lang : { "", "e", "EN", "enx", "de", "Hello", "fr " }) {
+        EXPECT_EQ(greetingsIndex(lang, strlen(lang)), -1) << lang;
+        EXPECT_EQ(greeterLangGreeting(lang), nullptr) << lang;
+    }
+    EXPECT_EQ(greetingsIndex("frances", 2), greetingsIndex("fr", 2));
+}
+
+TEST(GreeterLangTest, CreatesGreeterForLang)
+{
+    auto g = greeterCreateForLang("fr");
+    ASSERT_NE(g, nullptr);
+    EXPECT_STREQ(greeterGreet(g, "Alice"), "Bonjour, Alice!");
+    greeterDestroy(&g);
+
+    EXPECT_EQ(greeterCreateForLang("xx"), nullptr);
+}
@@ -1,6 +1,9 @@
 // greeter_mock_test.cpp
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <string>
+#include <thread>
+#include <vector>
 extern "C" {
 #include "greeter.h"
 }
@@ -125,3 +128,43 @@ TEST(GreeterMockTest, IgnoresLoggerError2)
     EXPECT_STREQ(greeterGreet(i, "Honey-Bunny"), "I love you, Honey-Bunny!");
     greeterDestroy(&i);
 }
+
+TEST(LoggerMockTest, OneMockPerScope)
+{
+    LoggerMock logger;
+    EXPECT_THROW(LoggerMock(), std::runtime_error);
+    LoggerMock mine(SingleScope::Thread);
+    EXPECT_THROW(LoggerMock(SingleScope::Thread), std::runtime_error);
+}
+
+TEST(LoggerMockTest, ThreadMockOverridesProcessMock)
+{
+    NiceMock<LoggerMock> logger;
+    EXPECT_CALL(logger, LoggerWriteLog(StrEq("other thread"))).Times(1);
+    {
+        NiceMock<LoggerMock> mine(SingleScope::Thread);
+        EXPECT_CALL(mine, LoggerWriteLog(StrEq("this thread"))).WillOnce(Return(7));
+        EXPECT_EQ(loggerWriteLog("this thread"), 7);
+        std::thread([] { loggerWriteLog("other thread"); }).join();
+    }
+    EXPECT_CALL(logger, LoggerWriteLog(StrEq("this thread again"))).Times(1);
+    loggerWriteLog("this thread again");
+}
+
+// every thread greets with expectations of its own
+TEST(GreeterMockTest, ThreadsHaveTheirOwnMocks)
+{
+    const int threads = 8, greetings = 500;
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t) {
+        workers.emplace_back([t] {
+            std::string name = "Thread" + std::to_string(t);
+            LoggerMock logger(SingleScope::Thread);
+            EXPECT_CALL(logger, LoggerWriteLog(StrEq("Hi, " + name + "!"))).Times(greetings);
+            auto g = greeterCreate("Hi");
+            for(int i = 0; i < greetings; ++i) { greeterGreet(g, name.c_str()); }
+            greeterDestroy(&g);
+        });
+    }
+    for(std::thread &w : workers) { w.join(); }
+}
@@ -1,6 +1,8 @@
 // greeter_test.cpp
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include "alloc_counter.hpp"
+#include "perf_counters.hpp"
 extern "C" {
 #include "greeter.h"
 }
@@ -91,6 +93,64 @@ TEST(GreeterTest, GreetsPersonally)
     greeterDestroy(&g);
 }
 
+TEST(GreeterTest, FormatsIntoBuffer)
+{
+    auto g = greeterCreate("Ciao");
+    char out[32];
+    size_t len = greeterFormat(g, "Bella!", 4, out, sizeof(out));
+    EXPECT_EQ(std::string(out, len), "Ciao, Bell!");
+    EXPECT_EQ(greeterFormat(g, "Bella", 5, out, 8), 12u); // too small: nothing written
+    greeterDestroy(&g);
+}
+
+TEST(GreeterTest, GreetsIntoBuffer)
+{
+    auto g = greeterCreate("Ciao");
+    std::string name(200, 'x'); // longer than greeterGreet() takes
+    char out[256];
+    EXPECT_EQ(greeterGreetTo(g, name.c_str(), name.size(), out, sizeof(out)), 207u);
+    EXPECT_EQ(out, "Ciao, " + name + "!");
+    EXPECT_EQ(greeterGreetTo(g, NULL, 0, out, sizeof(out)), 12u);
+    EXPECT_STREQ(out, "Ciao, World!");
+    EXPECT_EQ(greeterGreetTo(g, "Bella", 5, out, 12), 12u); // no room for the NUL
+    EXPECT_STREQ(out, "Ciao, World!");
+    greeterDestroy(&g);
+}
+
+TEST(GreeterTest, AllocatesOnlyOnCreate)
+{
+    greeter_t *g = nullptr;
+    EXPECT_NO_ALLOC({ g = greeterCreate(NULL); });
+    AllocScope create;
+    g = greeterCreate("Hello");
+    AllocCounts created = create.Delta();
+    EXPECT_EQ(created.allocs, 2u); // the greeter and its greeting, no more or less
+    EXPECT_LE(created.bytes, 200u);
+    EXPECT_EQ(created.frees, 0u);
+    EXPECT_NO_ALLOC({ greeterGreet(g, "Tom"); });
+    EXPECT_NO_ALLOC({ greeterGreet(g, NULL); });
+    char out[32];
+    EXPECT_NO_ALLOC({ greeterFormat(g, "Tom", 3, out, sizeof(out)); });
+    EXPECT_NO_ALLOC({ greeterGreetTo(g, "Tom", 3, out, sizeof(out)); });
+    AllocScope destroy;
+    greeterDestroy(&g);
+    EXPECT_EQ(destroy.Delta().frees, 2u);
+    EXPECT_EQ(destroy.Delta().allocs, 0u);
+}
+
+TEST(GreeterTest, GreetsWithinInstructionBudget)
+{
+    std::string error;
+    if( ! PerfCountersUsable(&error)) { GTEST_SKIP() << error; } // before g, which a skip would leak
+    auto g = greeterCreate("Hello");
+    char out[32];
+    PERF_RECORD("greet", { greeterGreet(g, "Tom"); });
+    PERF_RECORD("format", { greeterFormat(g, "Tom", 3, out, sizeof(out)); });
+    EXPECT_INSTRUCTIONS_LE(500, { greeterFormat(g, "Tom", 3, out, sizeof(out)); });
+    EXPECT_INSTRUCTIONS_LE(20000, { greeterGreet(g, "Tom"); }); // snprintf and an unbuffered fprintf
+    greeterDestroy(&g);
+}
+
 MATCHER_P2(HasCharCount, ch, charCount,
            "String has " + std::to_string(charCount) + " occurrences of '" + std::string(1, ch) + "'") {
     return charCount == std::count(arg, arg + strlen(arg), ch);
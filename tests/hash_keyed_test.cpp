@@ -0,0 +1,51 @@
+// hash_keyed_test.cpp
+#include <gtest/gtest.h>
+#include "hash.hpp"
+
+using testing::ExitedWithCode;
+
+static const uint8_t kKey[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+TEST(HashKeyedTest, SipHashMatchesReferenceVectors)
+{
+    // SipHash-2-4 test vectors from the SipHash paper, appendix A
+    uint8_t msg[15];
+    for(int i = 0; i < 15; ++i) { msg[i] = (uint8_t)i; }
+    uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0f0e0d0c0b0a0908ULL;
+    EXPECT_EQ((hash::siphash<2, 4>(msg, 0, k0, k1)), 0x726fdb47dd0e0e31ULL);
+    EXPECT_EQ((hash::siphash<2, 4>(msg, 15, k0, k1)), 0xa129ca6149be45e5ULL);
+
+    EXPECT_EQ(hash_siphash13(msg, 15, kKey), (hash::siphash<1, 3>(msg, 15, k0, k1)));
+}
+
+TEST(HashKeyedTest, DependsOnKey)
+{
+    uint8_t other[16] = {};
+    EXPECT_NE(hash_siphash13("Joe Black", 9, kKey), hash_siphash13("Joe Black", 9, other));
+    EXPECT_EQ(hash_siphash13("Joe Black", 9, kKey), hash_siphash13("Joe Black", 9, kKey));
+}
+
+TEST(HashKeyedTest, KeyedHashIsStableWithinProcess)
+{
+    EXPECT_EQ(hash_keyed64("Alice", 5), hash_keyed64("Alice", 5));
+    EXPECT_NE(hash_keyed64("Alice", 5), hash_keyed64("Alicf", 5));
+}
+
+TEST(HashKeyedTest, KeyedHashDiffersBetweenProcesses)
+{
+    // the re-executed child draws its own key, but inherits the parent's hash
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    setenv("HASH_KEYED_PARENT", std::to_string(hash_keyed64("Alice", 5)).c_str(), 0);
+    uint64_t parent = std::stoull(getenv("HASH_KEYED_PARENT"));
+    EXPECT_EXIT(exit(hash_keyed64("Alice", 5) == parent), ExitedWithCode(0), "");
+    unsetenv("HASH_KEYED_PARENT");
+}
+
+TEST(HashKeyedTest, SelectsAlgorithm)
+{
+    const char *s = "Hello, C plus C++!";
+    size_t n = strlen(s);
+    EXPECT_EQ(hash_bytes(HASH_STD, s, n), hash_string(s));
+    EXPECT_EQ(hash_bytes(HASH_STABLE, s, n), hash_string64(s));
+    EXPECT_EQ(hash_bytes(HASH_KEYED, s, n), hash_keyed64(s, n));
+}
@@ -0,0 +1,52 @@
+// hash_literal_test.cpp
+#include <gtest/gtest.h>
+#include "hash.hpp"
+extern "C" {
+#include "keys_hash.h"
+}
+
+using namespace hash::literals;
+
+template<uint64_t Key>
+struct Tag { static constexpr uint64_t value = Key; };
+
+static const char *language(const char *greeting)
+{
+    switch(hash_string64(greeting)) {
+        case "Hello"_h64:   return "English";
+        case "Hola"_h64:    return "Spanish";
+        case "Bonjour"_h64: return "French";
+        default:            return "unknown";
+    }
+}
+
+TEST(HashLiteralTest, IsCompileTimeConstant)
+{
+    static_assert("Ciao"_h64 == hash::hash64("Ciao"));
+    static_assert(Tag<"Hello"_h64>::value != Tag<"Hola"_h64>::value);
+    static_assert(hash::hash64("") == hash::fmix64(hash::FNV_OFFSET));
+}
+
+TEST(HashLiteralTest, MatchesRuntimeHash)
+{
+    for(const char *s : { "", "a", "Hello", "Üdv", "Good Morning, Vietnam!" }) {
+        EXPECT_EQ(hash::hash64(s), hash_string64(s)) << s;
+        EXPECT_EQ(hash::hash64(s), hash_bytes64(s, strlen(s))) << s;
+    }
+    EXPECT_EQ("Szia, Szevasz"_h64, hash_string64("Szia, Szevasz"));
+}
+
+TEST(HashLiteralTest, DispatchesOnLiteral)
+{
+    EXPECT_STREQ(language("Hola"), "Spanish");
+    EXPECT_STREQ(language("Bonjour"), "French");
+    EXPECT_STREQ(language("Servus"), "unknown");
+}
+
+TEST(HashLiteralTest, GeneratedHeaderMatchesRuntimeHash)
+{
+    EXPECT_EQ(HASH_LIT(Hello), hash_string64("Hello"));
+    EXPECT_EQ(HASH_LIT(Hola), hash_string64("Hola"));
+    EXPECT_EQ(HASH_LIT(Bonjour), "Bonjour"_h64);
+    EXPECT_EQ(HASH_LIT(Ciao), "Ciao"_h64);
+}
@@ -0,0 +1,182 @@
+// hash_quality.cpp
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+extern "C" {
+#include "hash.h"
+}
+
+typedef struct
+{
+    const char *name;
+    uint64_t (*hash)(const void *data, size_t len);
+
+} HashVariant;
+
+inline void PrintTo(const HashVariant &v, ::std::ostream *os) { *os << v.name; }
+
+// hash_string() hashes a C string with std::hash; HASH_STD gives the same
+// value for any bytes, including embedded NULs.
+static uint64_t StdHash(const void *data, size_t len)
+{
+    return hash_bytes(HASH_STD, data, len);
+}
+
+static const HashVariant kVariants[] = {
+    { "hash_string",  StdHash },
+    { "hash_bytes64", hash_bytes64 },
+    { "hash_keyed64", hash_keyed64 },
+};
+
+// "Firstname Lastname" pairs and numbered user ids, as seen by greeter
+static std::vector<std::string> NameCorpus()
+{
+    static const char *first[] = {
+        "Alice", "Bob", "Clarice", "Dave", "Eve", "Frank", "Grace", "Heidi",
+        "Ivan", "Judy", "Leo", "Mallory", "Niaj", "Olivia", "Peggy", "Rupert",
+        "Sybil", "Trent", "Victor", "Walter", "Zoltán", "Ágnes", "Joe", "Siri",
+    };
+    static const char *last[] = {
+        "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller",
+        "Davis", "Nagy", "Kovács", "Tóth", "Szabó", "Horváth", "Varga", "Kiss",
+        "Molnár", "Black", "White", "Müller", "Schmidt", "Rossi", "Dubois",
+    };
+    std::vector<std::string> names;
+    for(const char *f : first) {
+        for(const char *l : last) {
+            for(int i = 0; i < 20; ++i) {
+                names.push_back(std::string(f) + " " + l + (i ? " " + std::to_string(i) : ""));
+            }
+        }
+    }
+    for(int i = 0; i < 20000; ++i) {
+        names.push_back("user" + std::to_string(i));
+    }
+    return names;
+}
+
+TEST(HashVariantTest, StdHashMatchesHashString)
+{
+    for(const char *s : { "", "Joe Black", "Hello, C plus C++!" }) {
+        EXPECT_EQ(hash_string(s), StdHash(s, strlen(s))) << s;
+    }
+}
+
+class HashQualityTest : public testing::TestWithParam<HashVariant>
+{
+  protected:
+    uint64_t Hash(const std::string &s) { return GetParam().hash(s.data(), s.size()); }
+
+    // chi-square of hashes over buckets, taken as h % buckets
+    double ChiSquare(const std::vector<std::string> &keys, size_t buckets) {
+        std::vector<size_t> count(buckets);
+        for(const auto &k : keys) { ++count[Hash(k) % buckets]; }
+        double expected = (double)keys.size() / buckets;
+        double chi2 = 0;
+        for(size_t c : count) { chi2 += (c - expected) * (c - expected) / expected; }
+        return chi2;
+    }
+
+    std::mt19937_64 rng_{42};
+};
+
+TEST_P(HashQualityTest, Avalanches)
+{
+    const int samples = 2000;
+    for(size_t len : { 2, 4, 8, 16, 64 }) {
+        std::vector<int> flips(len * 8 * 64);
+        std::string key(len, '\0');
+        for(int s = 0; s < samples; ++s) {
+            for(auto &c : key) { c = (char)rng_(); }
+            uint64_t h = Hash(key);
+            for(size_t in = 0; in < len * 8; ++in) {
+                key[in / 8] ^= (char)(1 << (in % 8));
+                uint64_t diff = h ^ Hash(key);
+                key[in / 8] ^= (char)(1 << (in % 8));
+                for(int out = 0; out < 64; ++out) {
+                    flips[in * 64 + out] += (diff >> out) & 1;
+                }
+            }
+        }
+        double worst = 0;
+        for(int f : flips) { worst = std::max(worst, std::fabs((double)f / samples - 0.5)); }
+        RecordProperty("avalanche_bias_len" + std::to_string(len), std::to_string(worst));
+        // 0.5 +- 0.1 is over 8 sigma for 2000 samples
+        EXPECT_LT(worst, 0.1) << "key length " << len;
+    }
+}
+
+TEST_P(HashQualityTest, OutputBitsChangeIndependently)
+{
+    const int samples = 1000;
+    const size_t len = 8;
+    std::string key(len, '\0');
+    double worst = 0;
+    for(size_t in = 0; in < len * 8; in += 7) {
+        std::vector<int> one(64), both(64 * 64);
+        for(int s = 0; s < samples; ++s) {
+            for(auto &c : key) { c = (char)rng_(); }
+            uint64_t h = Hash(key);
+            key[in / 8] ^= (char)(1 << (in % 8));
+            uint64_t diff = h ^ Hash(key);
+            for(int j = 0; j < 64; ++j) {
+                if( ! ((diff >> j) & 1)) { continue; }
+                ++one[j];
+                for(int k = j + 1; k < 64; ++k) { both[j * 64 + k] += (diff >> k) & 1; }
+            }
+        }
+        for(int j = 0; j < 64; ++j) {
+            for(int k = j + 1; k < 64; ++k) {
+                double pj = (double)one[j] / samples, pk = (double)one[k] / samples;
+                double pjk = (double)both[j * 64 + k] / samples;
+                double var = pj * (1 - pj) * pk * (1 - pk);
+                double corr = var > 0 ? (pjk - pj * pk) / std::sqrt(var) : 1;
+                worst = std::max(worst, std::fabs(corr));
+            }
+        }
+    }
+    RecordProperty("bic_max_correlation", std::to_string(worst));
+    // about 6 sigma for 1000 samples over ~18k bit pairs
+    EXPECT_LT(worst, 0.2);
+}
+
+TEST_P(HashQualityTest, DistributesNamesUniformly)
+{
+    auto names = NameCorpus();
+    for(size_t buckets : { 64, 1000, 1024, 4093 }) {
+        double chi2 = ChiSquare(names, buckets);
+        double df = buckets - 1;
+        RecordProperty("chi2_" + std::to_string(buckets), std::to_string(chi2 / df));
+        // chi-square has mean df and variance 2*df
+        EXPECT_LT(chi2, df + 6 * std::sqrt(2 * df)) << buckets << " buckets";
+    }
+}
+
+TEST_P(HashQualityTest, CountsCollisions)
+{
+    auto names = NameCorpus();
+    std::unordered_set<uint64_t> full, low32;
+    size_t fullCollisions = 0, low32Collisions = 0;
+    for(const auto &n : names) {
+        uint64_t h = Hash(n);
+        fullCollisions += ! full.insert(h).second;
+        low32Collisions += ! low32.insert(h & 0xffffffffu).second;
+    }
+    double expected32 = (double)names.size() * names.size() / 2 / 4294967296.0;
+    RecordProperty("collisions_64", std::to_string(fullCollisions));
+    RecordProperty("collisions_32", std::to_string(low32Collisions));
+    EXPECT_EQ(fullCollisions, 0u);
+    EXPECT_LT(low32Collisions, expected32 + 6 * std::sqrt(expected32) + 3);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    HashVariants,
+    HashQualityTest,
+    ::testing::ValuesIn(kVariants),
+    [](const testing::TestParamInfo<HashVariant> &info) { return std::string(info.param.name); }
+);
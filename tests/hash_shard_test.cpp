@@ -0,0 +1,142 @@
+// hash_shard_test.cpp
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+extern "C" {
+#include "hash.h"
+}
+
+class HashShardTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        for(int i = 0; i < 20000; ++i) {
+            names_.push_back("user" + std::to_string(i));
+        }
+    }
+
+    std::vector<int32_t> Jump(int32_t buckets) {
+        std::vector<int32_t> placed;
+        for(const auto &n : names_) { placed.push_back(jump_consistent_hash_string(n.c_str(), buckets)); }
+        return placed;
+    }
+
+    std::vector<int32_t> Rendezvous(const std::vector<uint64_t> &ids, const std::vector<double> &w) {
+        std::vector<int32_t> placed;
+        for(const auto &n : names_) {
+            int32_t i = rendezvous_hash_string(n.c_str(), ids.data(), w.empty() ? nullptr : w.data(), ids.size());
+            placed.push_back(i < 0 ? -1 : (int32_t)ids[i]); // compare shard ids, not indices
+        }
+        return placed;
+    }
+
+    std::vector<std::string> names_;
+};
+
+TEST_F(HashShardTest, JumpStaysInRange)
+{
+    EXPECT_EQ(jump_consistent_hash(42, 0), -1);
+    EXPECT_EQ(jump_consistent_hash(42, 1), 0);
+    for(int32_t buckets : { 1, 2, 7, 100, 1 << 20 }) {
+        for(uint64_t key = 0; key < 1000; ++key) {
+            int32_t b = jump_consistent_hash(key * 0x9e3779b97f4a7c15ULL, buckets);
+            ASSERT_GE(b, 0);
+            ASSERT_LT(b, buckets);
+        }
+    }
+}
+
+TEST_F(HashShardTest, JumpBalancesBuckets)
+{
+    const int32_t buckets = 10;
+    std::vector<int> count(buckets);
+    for(int32_t b : Jump(buckets)) { ++count[b]; }
+    for(int c : count) {
+        EXPECT_NEAR(c, (double)names_.size() / buckets, 0.1 * names_.size() / buckets);
+    }
+}
+
+TEST_F(HashShardTest, JumpMovesOnlyToAddedBucket)
+{
+    for(int32_t buckets : { 1, 4, 10, 31 }) {
+        auto before = Jump(buckets), after = Jump(buckets + 1);
+        size_t moved = 0;
+        for(size_t i = 0; i < names_.size(); ++i) {
+            if(before[i] == after[i]) { continue; }
+            ++moved;
+            EXPECT_EQ(after[i], buckets) << names_[i]; // nothing moves between old buckets
+        }
+        double fraction = (double)moved / names_.size();
+        RecordProperty("jump_moved_" + std::to_string(buckets) + "_to_" + std::to_string(buckets + 1),
+                       std::to_string(fraction));
+        EXPECT_NEAR(fraction, 1.0 / (buckets + 1), 0.2 / (buckets + 1));
+    }
+}
+
+TEST_F(HashShardTest, JumpMovesOnlyFromRemovedBucket)
+{
+    auto before = Jump(8), after = Jump(7);
+    for(size_t i = 0; i < names_.size(); ++i) {
+        if(before[i] != 7) { EXPECT_EQ(before[i], after[i]) << names_[i]; }
+    }
+}
+
+TEST_F(HashShardTest, RendezvousHandlesNoShards)
+{
+    EXPECT_EQ(rendezvous_hash(42, nullptr, nullptr, 0), -1);
+    uint64_t ids[] = { 1, 2 };
+    double none[] = { 0, 0 };
+    EXPECT_EQ(rendezvous_hash(42, ids, none, 2), -1);
+}
+
+TEST_F(HashShardTest, RendezvousFollowsWeights)
+{
+    std::vector<uint64_t> ids = { 11, 22, 33, 44 };
+    std::vector<double> weights = { 1, 2, 3, 4 };
+    std::map<int32_t, int> count;
+    for(int32_t id : Rendezvous(ids, weights)) { ++count[id]; }
+    for(size_t i = 0; i < ids.size(); ++i) {
+        double expected = names_.size() * weights[i] / 10;
+        EXPECT_NEAR(count[ids[i]], expected, 0.1 * expected) << "shard " << ids[i];
+    }
+}
+
+TEST_F(HashShardTest, RendezvousMovesOnlyRemovedShardKeys)
+{
+    std::vector<uint64_t> ids = { 11, 22, 33, 44, 55 };
+    std::vector<double> weights = { 1, 1, 2, 1, 1 };
+    auto before = Rendezvous(ids, weights);
+    ids.erase(ids.begin() + 2); // remove a middle shard
+    weights.erase(weights.begin() + 2);
+    auto after = Rendezvous(ids, weights);
+
+    size_t moved = 0;
+    for(size_t i = 0; i < names_.size(); ++i) {
+        if(before[i] == 33) { ++moved; }
+        else { EXPECT_EQ(before[i], after[i]) << names_[i]; }
+    }
+    double fraction = (double)moved / names_.size();
+    RecordProperty("rendezvous_moved_on_remove", std::to_string(fraction));
+    EXPECT_NEAR(fraction, 2.0 / 6, 0.05);
+}
+
+TEST_F(HashShardTest, RendezvousMovesOnlyToAddedShard)
+{
+    std::vector<uint64_t> ids = { 11, 22, 33 };
+    std::vector<double> weights = { 1, 1, 1 };
+    auto before = Rendezvous(ids, weights);
+    ids.push_back(44);
+    weights.push_back(3);
+    auto after = Rendezvous(ids, weights);
+
+    size_t moved = 0;
+    for(size_t i = 0; i < names_.size(); ++i) {
+        if(before[i] == after[i]) { continue; }
+        ++moved;
+        EXPECT_EQ(after[i], 44) << names_[i];
+    }
+    double fraction = (double)moved / names_.size();
+    RecordProperty("rendezvous_moved_on_add", std::to_string(fraction));
+    EXPECT_NEAR(fraction, 3.0 / 6, 0.05);
+}
@@ -0,0 +1,91 @@
+// histogram_test.cpp
+#include <gtest/gtest.h>
+#include <cstdint>
+extern "C" {
+#include "histogram.h"
+}
+
+class HistogramTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        h_ = histogramCreate();
+        ASSERT_NE(h_, nullptr);
+    }
+
+    void TearDown() override {
+        histogramDestroy(&h_);
+        EXPECT_EQ(h_, nullptr);
+    }
+
+    histogram_t *h_ = nullptr;
+};
+
+TEST_F(HistogramTest, EmptyReportsZeros)
+{
+    EXPECT_EQ(histogramCount(h_), 0u);
+    EXPECT_EQ(histogramMin(h_), 0u);
+    EXPECT_EQ(histogramMax(h_), 0u);
+    EXPECT_EQ(histogramPercentile(h_, 50), 0u);
+    EXPECT_EQ(histogramMean(h_), 0);
+}
+
+TEST_F(HistogramTest, CountsSmallValuesExactly)
+{
+    for(uint64_t v = 0; v < 100; ++v) { histogramRecord(h_, v); }
+    EXPECT_EQ(histogramCount(h_), 100u);
+    EXPECT_EQ(histogramMin(h_), 0u);
+    EXPECT_EQ(histogramMax(h_), 99u);
+    EXPECT_EQ(histogramPercentile(h_, 50), 49u);
+    EXPECT_EQ(histogramPercentile(h_, 100), 99u);
+    EXPECT_DOUBLE_EQ(histogramMean(h_), 49.5);
+}
+
+TEST_F(HistogramTest, BucketsCoverEveryValueWithinPrecision)
+{
+    uint64_t next = 0;
+    for(size_t i = 0; i < histogramBuckets(h_); ++i) {
+        uint64_t lowest, highest;
+        histogramBucket(h_, i, &lowest, &highest);
+        ASSERT_EQ(lowest, next) << "bucket " << i;
+        ASSERT_LE(highest - lowest, lowest >> HISTOGRAM_SUB_BITS) << "bucket " << i;
+        next = highest + 1;
+    }
+    EXPECT_EQ(next, 0u); // wrapped around: the last bucket ends at UINT64_MAX
+}
+
+TEST_F(HistogramTest, PercentilesWithinPrecision)
+{
+    for(uint64_t v = 1; v <= 1000000; ++v) { histogramRecord(h_, v); }
+    for(double p : { 10.0, 50.0, 90.0, 99.0, 99.9 }) {
+        double expected = p / 100 * 1000000;
+        EXPECT_NEAR(histogramPercentile(h_, p), expected, expected / (1 << HISTOGRAM_SUB_BITS)) << "p" << p;
+    }
+    EXPECT_EQ(histogramPercentile(h_, 100), 1000000u);
+}
+
+TEST_F(HistogramTest, RecordsExtremes)
+{
+    histogramRecord(h_, 0);
+    histogramRecord(h_, UINT64_MAX);
+    EXPECT_EQ(histogramMin(h_), 0u);
+    EXPECT_EQ(histogramMax(h_), UINT64_MAX);
+    EXPECT_EQ(histogramPercentile(h_, 100), UINT64_MAX);
+}
+
+TEST_F(HistogramTest, AddsAnotherHistogram)
+{
+    histogram_t *other = histogramCreate();
+    ASSERT_NE(other, nullptr);
+    histogramRecord(h_, 10);
+    histogramRecord(other, 5);
+    histogramRecord(other, 1000);
+    histogramAdd(h_, other);
+    EXPECT_EQ(histogramCount(h_), 3u);
+    EXPECT_EQ(histogramMin(h_), 5u);
+    EXPECT_EQ(histogramMax(h_), 1000u);
+    EXPECT_EQ(histogramPercentile(h_, 50), 10u);
+    histogramReset(h_);
+    EXPECT_EQ(histogramCount(h_), 0u);
+    histogramDestroy(&other);
+}
@@ -0,0 +1,91 @@
+// logger_test.cpp
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+extern "C" {
+#include "logger.h"
+}
+
+// points stderr at a file for the test to read back
+class LoggerTest : public testing::Test
+{
+  protected:
+    void SetUp() override {
+        fflush(stderr);
+        saved_ = dup(STDERR_FILENO);
+        file_ = tmpfile();
+        ASSERT_NE(file_, nullptr);
+        dup2(fileno(file_), STDERR_FILENO);
+    }
+
+    void TearDown() override {
+        loggerBufferStop();
+        fflush(stderr);
+        dup2(saved_, STDERR_FILENO);
+        close(saved_);
+        fclose(file_);
+    }
+
+    std::string Written() {
+        fflush(stderr);
+        std::string text;
+        char buf[4096];
+        size_t n;
+        rewind(file_);
+        while((n = fread(buf, 1, sizeof(buf), file_)) > 0) { text.append(buf, n); }
+        return text;
+    }
+
+    int saved_ = -1;
+    FILE *file_ = nullptr;
+};
+
+TEST_F(LoggerTest, WritesEachLineWithoutBuffer)
+{
+    EXPECT_EQ(loggerWriteLog("Hello, Tom!"), int(sizeof("[LOG] Hello, Tom!\n") - 1));
+    EXPECT_EQ(Written(), "[LOG] Hello, Tom!\n");
+}
+
+TEST_F(LoggerTest, BuffersUntilFlushed)
+{
+    ASSERT_EQ(loggerBufferStart(1024), 0);
+    EXPECT_EQ(loggerWriteLog("Hello, Tom!"), int(sizeof("[LOG] Hello, Tom!\n") - 1));
+    EXPECT_EQ(loggerWriteLog("Hello, Jerry!"), int(sizeof("[LOG] Hello, Jerry!\n") - 1));
+    EXPECT_EQ(Written(), "");
+    EXPECT_EQ(loggerFlush(), 0);
+    EXPECT_EQ(Written(), "[LOG] Hello, Tom!\n[LOG] Hello, Jerry!\n");
+    EXPECT_EQ(loggerFlush(), 0);
+    EXPECT_EQ(Written(), "[LOG] Hello, Tom!\n[LOG] Hello, Jerry!\n");
+}
+
+TEST_F(LoggerTest, FlushesALineThatDoesNotFit)
+{
+    ASSERT_EQ(loggerBufferStart(16), 0);
+    loggerWriteLog("12345678"); // 15 bytes with prefix and newline
+    loggerWriteLog("a");
+    EXPECT_EQ(Written(), "[LOG] 12345678\n");
+    loggerWriteLog(std::string(100, 'x').c_str()); // never fits: straight out
+    EXPECT_EQ(Written(), "[LOG] 12345678\n[LOG] a\n[LOG] " + std::string(100, 'x') + "\n");
+}
+
+TEST_F(LoggerTest, StopFlushes)
+{
+    ASSERT_EQ(loggerBufferStart(1024), 0);
+    loggerWriteLog("Hello, Tom!");
+    loggerBufferStop();
+    EXPECT_EQ(Written(), "[LOG] Hello, Tom!\n");
+    loggerWriteLog("Hello, Jerry!");
+    EXPECT_EQ(Written(), "[LOG] Hello, Tom!\n[LOG] Hello, Jerry!\n");
+}
+
+TEST_F(LoggerTest, BuffersOnlyTheCallingThread)
+{
+    ASSERT_EQ(loggerBufferStart(1024), 0);
+    loggerWriteLog("buffered");
+    std::thread([] { loggerWriteLog("direct"); }).join();
+    EXPECT_EQ(Written(), "[LOG] direct\n");
+    loggerFlush();
+    EXPECT_EQ(Written(), "[LOG] direct\n[LOG] buffered\n");
+}